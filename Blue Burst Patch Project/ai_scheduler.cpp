@@ -0,0 +1,119 @@
+#ifdef PATCH_AI_SCHEDULER
+
+#include <windows.h>
+#include "ai_scheduler.h"
+#include "entity.h"
+#include "entitylist.h"
+#include "hooking.h"
+
+namespace AiScheduler
+{
+    /// Frames between decisions of an enemy that nothing is happening around
+    const uint32_t THINK_INTERVAL = 8;
+    /// Frames between decisions of an enemy near a player
+    const uint32_t NEAR_PLAYER_INTERVAL = 2;
+    const float NEAR_PLAYER_DISTANCE = 150.0f;
+    /// How long an enemy thinks every frame after Boost
+    const uint32_t BOOST_FRAMES = 60;
+    /// Enemies that have waited this long think even if the budget is used up
+    const uint32_t MAX_WAIT = THINK_INTERVAL * 4;
+    /// Time that enemies can spend thinking per frame
+    const double BUDGET_MICROSECONDS = 1000.0;
+
+    /// Starts high so that enemies created on the first frames are overdue right away
+    uint32_t frame = MAX_WAIT;
+    uint64_t spentTicks = 0;
+    uint64_t budgetTicks = 0;
+
+    uint32_t thinks = 0;
+    uint32_t deferrals = 0;
+    uint32_t thinksLastFrame = 0;
+    uint32_t deferralsLastFrame = 0;
+
+    uint64_t Now()
+    {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        return now.QuadPart;
+    }
+
+    bool NearPlayer(const Enemy::EnemyBase& enemy)
+    {
+        for (auto ptr : EntityList::Players())
+        {
+            auto player = Entity::BaseEntityWrapper(ptr);
+            if (DistanceSquaredXZ(player.position(), enemy.xyz2) < Squared(NEAR_PLAYER_DISTANCE)) return true;
+        }
+
+        return false;
+    }
+
+    void Schedule::Boost()
+    {
+        boostedUntilFrame = frame + BOOST_FRAMES;
+    }
+
+    bool Schedule::Due(const Enemy::EnemyBase& enemy)
+    {
+        uint32_t waited = frame - lastThinkFrame;
+        bool boosted = frame < boostedUntilFrame;
+        uint32_t interval = boosted ? 1 : NearPlayer(enemy) ? NEAR_PLAYER_INTERVAL : THINK_INTERVAL;
+
+        bool onSlot = (frame + (uint16_t) enemy.entityIndex) % interval == 0;
+        // Missed its slot because of the budget or because the interval changed
+        bool overdue = waited > interval;
+        if (!onSlot && !overdue) return false;
+
+        if (!boosted && waited < MAX_WAIT && spentTicks >= budgetTicks)
+        {
+            deferrals++;
+            return false;
+        }
+
+        lastThinkFrame = frame;
+        thinks++;
+        return true;
+    }
+
+    ThinkTimer::ThinkTimer(bool active) :
+        active(active),
+        start(active ? Now() : 0)
+    {
+    }
+
+    ThinkTimer::~ThinkTimer()
+    {
+        if (active) spentTicks += Now() - start;
+    }
+
+    uint32_t ThinksLastFrame()
+    {
+        return thinksLastFrame;
+    }
+
+    uint32_t DeferralsLastFrame()
+    {
+        return deferralsLastFrame;
+    }
+
+    void __cdecl OnFrameEnd(void*)
+    {
+        thinksLastFrame = thinks;
+        deferralsLastFrame = deferrals;
+        thinks = 0;
+        deferrals = 0;
+        spentTicks = 0;
+        frame++;
+    }
+
+    void ApplyAiSchedulerPatch()
+    {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        budgetTicks = (uint64_t) (double(frequency.QuadPart) * BUDGET_MICROSECONDS / 1000000.0);
+
+        Hooking::afterSceneUpdate.AddCallback(OnFrameEnd, nullptr, "AI scheduler");
+    }
+};
+
+#endif // PATCH_AI_SCHEDULER
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include "enemy.h"
+
+/**
+ * Spreads the expensive decisions of custom enemies, like searching for a target or asking for a new path, across frames.
+ * Each enemy thinks every few frames on a frame picked by its entity index, so that enemies spawned together don't all
+ * think on the same frame. Enemies near a player think more often and enemies that were just hit think every frame for a while.
+ * Once the time spent thinking during a frame goes over the budget the remaining enemies wait for a later frame,
+ * except for ones that were hit or have waited too long already.
+ * Work that must happen every frame, like animation, movement and collision, should not be put behind the scheduler.
+ */
+namespace AiScheduler
+{
+    /// Per enemy scheduling state, to be kept in a member of an EnemyBase-derived class
+    class Schedule
+    {
+    private:
+        uint32_t lastThinkFrame = 0;
+        uint32_t boostedUntilFrame = 0;
+
+    public:
+        /// Makes the enemy think every frame for a while, e.g. after it was hit
+        void Boost();
+        /**
+         * @brief Whether the enemy should run its expensive decisions this frame.
+         * Time spent until the end of the frame counts towards the budget only when measured with a ThinkTimer.
+         */
+        bool Due(const Enemy::EnemyBase& enemy);
+    };
+
+    /// Counts the time between construction and destruction towards the current frame's budget
+    class ThinkTimer
+    {
+    private:
+        bool active;
+        uint64_t start;
+
+    public:
+        /// Nothing is measured if active is false, so the timer can be created unconditionally
+        explicit ThinkTimer(bool active);
+        ~ThinkTimer();
+    };
+
+    uint32_t ThinksLastFrame();
+    uint32_t DeferralsLastFrame();
+
+    void ApplyAiSchedulerPatch();
+};
@@ -12,12 +12,7 @@ namespace BattleParam
 
     void* paramFileStore = reinterpret_cast<void*>(0x00a8d4e0);
 
-    // Load some functions from the game instead of reimplementing them
-    // TODO: Move these to a separate file
-    typedef uint8_t* (__thiscall *GetParamFileDataFunction)(void* paramFileStore, char* filename);
     GetParamFileDataFunction GetParamFileData = reinterpret_cast<GetParamFileDataFunction>(0x005bc0b0);
-
-    typedef size_t (__thiscall *GetParamFileSizeFunction)(void* paramFileStore, char* filename);
     GetParamFileSizeFunction GetParamFileSize = reinterpret_cast<GetParamFileSizeFunction>(0x005bc050);
 
     char* GetBPFilename(Episode ep, bool solo_mode)
@@ -494,4 +494,11 @@ namespace BattleParam
     };
 
     void* GetBPEntry(Episode ep, bool solo_mode, uint8_t i, BPEntryType entryType);
+
+    // Load some functions from the game instead of reimplementing them
+    typedef uint8_t* (__thiscall *GetParamFileDataFunction)(void* paramFileStore, char* filename);
+    extern GetParamFileDataFunction GetParamFileData;
+
+    typedef size_t (__thiscall *GetParamFileSizeFunction)(void* paramFileStore, char* filename);
+    extern GetParamFileSizeFunction GetParamFileSize;
 };
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Fixed-size queue based on Dmitry Vyukov's bounded MPMC queue, with any number of producers and a single consumer.
+ * Producers never block or allocate. When the queue is full Reserve fails instead.
+ * Sequence numbers are stored relative to the item index so that a zero-initialized queue is ready to use.
+ * Instances should have static storage duration so they work even before dynamic initialization has run.
+ */
+template<typename T, size_t Capacity>
+class BoundedQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+private:
+    std::atomic<size_t> relativeSequences[Capacity];
+    T items[Capacity];
+    std::atomic<size_t> enqueuePos;
+    /// Only touched by the consumer
+    size_t dequeuePos;
+
+    size_t SequenceOf(size_t pos) const
+    {
+        size_t index = pos & (Capacity - 1);
+        return relativeSequences[index].load(std::memory_order_acquire) + index;
+    }
+
+    void SetSequence(size_t pos, size_t sequence)
+    {
+        size_t index = pos & (Capacity - 1);
+        relativeSequences[index].store(sequence - index, std::memory_order_release);
+    }
+
+public:
+    /**
+     * @brief Claims a free item. Returns null if the queue is full.
+     * The item must be filled in and then handed back with Publish.
+     */
+    T* Reserve()
+    {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            intptr_t diff = (intptr_t) SequenceOf(pos) - (intptr_t) pos;
+
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    return &items[pos & (Capacity - 1)];
+                }
+            }
+            else if (diff < 0)
+            {
+                return nullptr;
+            }
+            else
+            {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// Makes a reserved item visible to the consumer
+    void Publish(T* item)
+    {
+        size_t index = item - items;
+        // Until it is published the sequence of a reserved item is the position it was reserved at
+        size_t pos = relativeSequences[index].load(std::memory_order_relaxed) + index;
+        SetSequence(pos, pos + 1);
+    }
+
+    /// Returns the oldest published item or null if there is none. Consumer only.
+    T* Peek()
+    {
+        if (SequenceOf(dequeuePos) != dequeuePos + 1) return nullptr;
+        return &items[dequeuePos & (Capacity - 1)];
+    }
+
+    /// Hands the item returned by Peek back to the producers. Consumer only.
+    void Pop()
+    {
+        SetSequence(dequeuePos, dequeuePos + Capacity);
+        dequeuePos++;
+    }
+};
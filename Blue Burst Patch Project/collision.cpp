@@ -0,0 +1,249 @@
+#ifdef PATCH_COLLISION_BROADPHASE
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "collision.h"
+#include "detour.h"
+#include "entity.h"
+#include "entitylist.h"
+#include "hooking.h"
+#include "keyboard.h"
+#include "patching.h"
+
+namespace Collision
+{
+    /// The game skips pairs that are further apart than this on the XZ plane before testing their collision boxes
+    const float GAME_COLLISION_RANGE = 100.0f;
+    /// How far an entity may move between the hash being built and a pass that uses it within the same frame
+    const float MOVEMENT_MARGIN = 25.0f;
+    /// Anything within the game's range is in the same or a neighboring cell
+    const float CELL_SIZE = GAME_COLLISION_RANGE + MOVEMENT_MARGIN;
+    /// Must be a power of two
+    const uint32_t BUCKET_COUNT = 1024;
+    /// Cell coordinates beyond this would not fit in an int
+    const float MAX_CELL_COORDINATE = 1.0e9f;
+
+    /// The enemy pass of CollideWithEntities
+    const size_t ENEMY_PASS_ADDRESS = 0x007b798c;
+    /// Operands in the enemy pass that hold the address of the entity list and its counts
+    const size_t ENTITY_LIST_OPERANDS[] = {0x007b79d0};
+    const size_t PLAYER_COUNT_OPERANDS[] = {
+        0x007b79a9, 0x007b7ce8, 0x007b7d09, 0x007b7d2a, 0x007b7d4b, 0x007b7d6c, 0x007b7d8d,
+        0x007b7dae, 0x007b7dcf, 0x007b7df0, 0x007b7e0e, 0x007b7e4d, 0x007b7e5b, 0x007b7e69
+    };
+    const size_t ENEMY_COUNT_OPERANDS[] = {
+        0x007b79af, 0x007b7cee, 0x007b7d0f, 0x007b7d30, 0x007b7d51, 0x007b7d72, 0x007b7d93,
+        0x007b7db4, 0x007b7dd5, 0x007b7df6, 0x007b7e14, 0x007b7e53, 0x007b7e61, 0x007b7e6f
+    };
+
+    struct HashEntry
+    {
+        int32_t cellX;
+        int32_t cellZ;
+        /// Index into the entity list
+        uint32_t slot;
+    };
+
+    bool enabled = true;
+
+    /**
+     * The enemy pass reads these instead of the real entity list.
+     * The pass iterates from the player count to the player count plus the enemy count,
+     * so the player count it sees is always zero and the enemy count is the number of candidates.
+     */
+    void* candidates[EntityList::ENTITY_LIST_CAPACITY];
+    uint32_t candidateStart = 0;
+    uint32_t candidateCount = 0;
+
+    bool hashStale = true;
+    uint32_t hashedPlayerCount = 0;
+    uint32_t hashedEnemyCount = 0;
+    /// Where each bucket's entries start, with one extra element for the end of the last bucket
+    std::vector<uint32_t> bucketStart(BUCKET_COUNT + 1);
+    std::vector<HashEntry> entries;
+    /// BuildHash's entries before they're sorted into buckets, kept so that it doesn't allocate every frame
+    std::vector<HashEntry> placed;
+    /// Where BuildHash puts the next entry of each bucket
+    std::vector<uint32_t> bucketCursor(BUCKET_COUNT);
+    /// Enemies whose position can not be put in a cell, the game tests them against everything
+    std::vector<uint32_t> unplaced;
+    std::vector<uint32_t> candidateSlots;
+
+    uint32_t pairTests = 0;
+    uint32_t pairTestsLastFrame = 0;
+
+    uint32_t PairTestsLastFrame()
+    {
+        return pairTestsLastFrame;
+    }
+
+    bool BroadphaseEnabled()
+    {
+        return enabled;
+    }
+
+    uint32_t BucketOf(int32_t cellX, int32_t cellZ)
+    {
+        return ((uint32_t) cellX * 73856093u ^ (uint32_t) cellZ * 19349663u) & (BUCKET_COUNT - 1);
+    }
+
+    bool CellOf(void* entity, int32_t& cellX, int32_t& cellZ)
+    {
+        auto wrapper = Entity::BaseEntityWrapper(entity);
+        float x = std::floor(wrapper.position().x / CELL_SIZE);
+        float z = std::floor(wrapper.position().z / CELL_SIZE);
+
+        // Also false for NaN, which the game's distance check never rejects
+        if (!(std::fabs(x) < MAX_CELL_COORDINATE && std::fabs(z) < MAX_CELL_COORDINATE)) return false;
+
+        cellX = (int32_t) x;
+        cellZ = (int32_t) z;
+        return true;
+    }
+
+    void BuildHash()
+    {
+        hashedPlayerCount = *EntityList::playerCount;
+        hashedEnemyCount = *EntityList::enemyCount;
+        hashStale = false;
+
+        placed.clear();
+        unplaced.clear();
+
+        for (uint32_t slot = hashedPlayerCount; slot < hashedPlayerCount + hashedEnemyCount; slot++)
+        {
+            HashEntry entry;
+            entry.slot = slot;
+            if (CellOf(EntityList::entityList[slot], entry.cellX, entry.cellZ))
+            {
+                placed.push_back(entry);
+            }
+            else
+            {
+                unplaced.push_back(slot);
+            }
+        }
+
+        // Counting sort by bucket
+        std::fill(bucketStart.begin(), bucketStart.end(), 0);
+        for (const auto& entry : placed)
+        {
+            bucketStart[BucketOf(entry.cellX, entry.cellZ) + 1]++;
+        }
+
+        for (uint32_t bucket = 1; bucket <= BUCKET_COUNT; bucket++)
+        {
+            bucketStart[bucket] += bucketStart[bucket - 1];
+        }
+
+        entries.resize(placed.size());
+        std::copy(bucketStart.begin(), bucketStart.end() - 1, bucketCursor.begin());
+        for (const auto& entry : placed)
+        {
+            entries[bucketCursor[BucketOf(entry.cellX, entry.cellZ)]++] = entry;
+        }
+    }
+
+    /// Fills candidateSlots in entity list order, which is the order the game would have tested them in
+    void FindCandidates(void* self)
+    {
+        candidateSlots.clear();
+
+        int32_t cellX, cellZ;
+        if (!CellOf(self, cellX, cellZ))
+        {
+            // Tested against everything by the game
+            for (uint32_t slot = hashedPlayerCount; slot < hashedPlayerCount + hashedEnemyCount; slot++)
+            {
+                candidateSlots.push_back(slot);
+            }
+            return;
+        }
+
+        for (int32_t z = cellZ - 1; z <= cellZ + 1; z++)
+        {
+            for (int32_t x = cellX - 1; x <= cellX + 1; x++)
+            {
+                uint32_t bucket = BucketOf(x, z);
+                for (uint32_t i = bucketStart[bucket]; i < bucketStart[bucket + 1]; i++)
+                {
+                    if (entries[i].cellX == x && entries[i].cellZ == z)
+                    {
+                        candidateSlots.push_back(entries[i].slot);
+                    }
+                }
+            }
+        }
+
+        candidateSlots.insert(candidateSlots.end(), unplaced.begin(), unplaced.end());
+        std::sort(candidateSlots.begin(), candidateSlots.end());
+        candidateSlots.erase(std::unique(candidateSlots.begin(), candidateSlots.end()), candidateSlots.end());
+    }
+
+    typedef void (__fastcall *EnemyPassFunction)(void* self, void* edx);
+    EnemyPassFunction originalEnemyPass = nullptr;
+
+    void __fastcall EnemyPassWithBroadphase(void* self, void* edx)
+    {
+        uint32_t firstEnemy = *EntityList::playerCount;
+        uint32_t enemyCount = *EntityList::enemyCount;
+
+        if (enabled)
+        {
+            // Enemies spawned or destroyed since the hash was built
+            if (hashStale || firstEnemy != hashedPlayerCount || enemyCount != hashedEnemyCount) BuildHash();
+
+            FindCandidates(self);
+
+            candidateCount = 0;
+            for (uint32_t slot : candidateSlots)
+            {
+                candidates[candidateCount++] = EntityList::entityList[slot];
+            }
+        }
+        else
+        {
+            std::copy(EntityList::entityList + firstEnemy, EntityList::entityList + firstEnemy + enemyCount, candidates);
+            candidateCount = enemyCount;
+        }
+
+        pairTests += candidateCount;
+        originalEnemyPass(self, edx);
+    }
+
+    void __cdecl OnFrameEnd(void*)
+    {
+        pairTestsLastFrame = pairTests;
+        pairTests = 0;
+        hashStale = true;
+    }
+
+    void ApplyCollisionBroadphasePatch()
+    {
+        for (size_t operand : ENTITY_LIST_OPERANDS)
+        {
+            Patching::Write(operand, (void*) candidates);
+        }
+
+        for (size_t operand : PLAYER_COUNT_OPERANDS)
+        {
+            Patching::Write(operand, (void*) &candidateStart);
+        }
+
+        for (size_t operand : ENEMY_COUNT_OPERANDS)
+        {
+            Patching::Write(operand, (void*) &candidateCount);
+        }
+
+        originalEnemyPass = Hooking::CreateDetour(ENEMY_PASS_ADDRESS, EnemyPassWithBroadphase);
+
+        Hooking::afterSceneUpdate.AddCallback(OnFrameEnd, nullptr, "Collision broadphase");
+
+        Keyboard::onKeyDown({Keyboard::Keycode::Ctrl, Keyboard::Keycode::B}, []() {
+            enabled = !enabled;
+        });
+    }
+};
+
+#endif // PATCH_COLLISION_BROADPHASE
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Broadphase for the game's enemy-vs-enemy collision pass, which every enemy runs against every other enemy each frame.
+ * Enemies are put into a spatial hash once per frame and each pass only gets to see the enemies in the neighboring cells.
+ * The game's own distance check and collision box tests still run on those, so collisions resolve the same way.
+ * Ctrl+B switches between the broadphase and testing all pairs.
+ */
+namespace Collision
+{
+    /// Number of enemy pairs that the game's collision pass looked at during the last frame
+    uint32_t PairTestsLastFrame();
+    bool BroadphaseEnabled();
+
+    void ApplyCollisionBroadphasePatch();
+};
@@ -47,6 +47,7 @@ decltype(InitEnemyAnimations) InitEnemyAnimations = reinterpret_cast<decltype(In
 decltype(AnimateEntity) AnimateEntity = reinterpret_cast<decltype(AnimateEntity)>(0x007aa094);
 decltype(GetPlayer) GetPlayer = reinterpret_cast<decltype(GetPlayer)>(0x0068d5a8);
 decltype(GetGround) GetGround = reinterpret_cast<decltype(GetGround)>(0x00780630);
+void** collisionMeshes = reinterpret_cast<void**>(0x00aab3f0);
 decltype(CollideWithEntities) CollideWithEntities = reinterpret_cast<decltype(CollideWithEntities)>(0x007b6880);
 decltype(EnableReticle) EnableReticle = reinterpret_cast<decltype(EnableReticle)>(0x006946a8);
 decltype(FreeCollisionBoxes) FreeCollisionBoxes = reinterpret_cast<decltype(FreeCollisionBoxes)>(0x007b9c8c);
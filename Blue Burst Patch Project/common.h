@@ -97,6 +97,8 @@ struct Ground
 
 /// Raycasts down to find the map geometry at the specified position
 extern Ground* (__cdecl *GetGround)(Vec3<float>* position, uint32_t unknown);
+/// List of the collision meshes that GetGround tests against, replaced when a map is loaded
+extern void** collisionMeshes;
 /// Computes collisions with other entities
 extern void (__thiscall *CollideWithEntities)(void* entity);
 /// Allows entity to be targetable by the player. Must be called every frame.
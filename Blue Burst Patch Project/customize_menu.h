@@ -142,5 +142,7 @@ namespace CustomizeMenu
 
     ActionList& GetFleshieActionList();
     ActionList& GetAndroidActionList();
+    /// Pads the list to whole rows and terminates it
+    void FixupActionList(ActionList& actionList);
     void ApplyActionListPatch();
 };
@@ -0,0 +1,205 @@
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include "helpers.h"
+#include "detour.h"
+#include "x86_decoder.h"
+
+namespace Hooking
+{
+    const size_t JMP_SIZE = 5;
+    /// jmp dword ptr [slot]
+    const size_t INDIRECT_JMP_SIZE = 6;
+    const size_t EXECUTABLE_BLOCK_SIZE = 0x10000;
+
+    /// State shared by every detour at the same address
+    struct DetourSite
+    {
+        /// The address patched to jump here. Swapping this pointer is what chains detours.
+        void* volatile slot;
+        /// Relocated original code followed by a jump back
+        uint8_t* trampoline;
+    };
+
+    /// Sites are never removed so the slots stay valid
+    std::unordered_map<size_t, DetourSite*> detourSites;
+
+    uint8_t* executableBlock = nullptr;
+    size_t executableBlockUsed = 0;
+
+    std::string ToHex(size_t addr)
+    {
+        std::stringstream ss;
+        ss << std::hex << addr;
+        return ss.str();
+    }
+
+    uint8_t* AllocateExecutableMemory(size_t size)
+    {
+        // Keep the pieces 16 byte aligned
+        size = (size + 15) & ~size_t(15);
+
+        if (size > EXECUTABLE_BLOCK_SIZE)
+        {
+            throw std::runtime_error("AllocateExecutableMemory: Size is too large");
+        }
+
+        if (executableBlock == nullptr || executableBlockUsed + size > EXECUTABLE_BLOCK_SIZE)
+        {
+            executableBlock = (uint8_t*) VirtualAlloc(nullptr, EXECUTABLE_BLOCK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+            executableBlockUsed = 0;
+
+            if (executableBlock == nullptr)
+            {
+                throw std::runtime_error("AllocateExecutableMemory: VirtualAlloc failed");
+            }
+
+            // Fill with int3 so that running off the end of anything traps immediately
+            memset(executableBlock, 0xcc, EXECUTABLE_BLOCK_SIZE);
+        }
+
+        uint8_t* result = executableBlock + executableBlockUsed;
+        executableBlockUsed += size;
+        return result;
+    }
+
+    void WriteRel32(uint8_t* at, size_t dest)
+    {
+        int32_t rel = (int32_t) (dest - ((size_t) at + 4));
+        memcpy(at, &rel, sizeof(rel));
+    }
+
+    void WriteJump(uint8_t* at, size_t dest)
+    {
+        at[0] = 0xe9;
+        WriteRel32(at + 1, dest);
+    }
+
+    size_t MaxRelocatedSize(size_t length)
+    {
+        // The worst case is a 2 byte jcc rel8 that turns into a 6 byte jcc rel32
+        return length * 3;
+    }
+
+    size_t RelocateCode(size_t from, size_t length, uint8_t* to)
+    {
+        size_t read = 0;
+        uint8_t* out = to;
+
+        while (read < length)
+        {
+            const uint8_t* code = (const uint8_t*) (from + read);
+            auto insn = X86::Decode(code);
+
+            if (!insn.IsValid())
+            {
+                throw std::runtime_error("CreateDetour: Could not decode instruction at " + ToHex(from + read));
+            }
+
+            if (!insn.IsRelativeBranch())
+            {
+                memcpy(out, code, insn.length);
+                out += insn.length;
+                read += insn.length;
+                continue;
+            }
+
+            size_t branchTarget = insn.BranchTarget(code, from + read);
+
+            if (branchTarget > from && branchTarget < from + length)
+            {
+                throw std::runtime_error("CreateDetour: Branch into the overwritten code at " + ToHex(from + read));
+            }
+
+            if (insn.branchType == X86::BranchType::Loop || insn.displacementSize == 2)
+            {
+                throw std::runtime_error("CreateDetour: Cannot relocate branch at " + ToHex(from + read));
+            }
+
+            if (insn.displacementSize == 1)
+            {
+                // Widen rel8 to rel32
+                if (insn.branchType == X86::BranchType::Jump)
+                {
+                    *out++ = 0xe9;
+                }
+                else
+                {
+                    *out++ = 0x0f;
+                    *out++ = 0x80 | (code[insn.opcodeOffset] & 0x0f);
+                }
+            }
+            else
+            {
+                memcpy(out, code, insn.displacementOffset);
+                out += insn.displacementOffset;
+            }
+
+            WriteRel32(out, branchTarget);
+            out += 4;
+            read += insn.length;
+        }
+
+        return out - to;
+    }
+
+    DetourSite& GetDetourSite(size_t address)
+    {
+        auto existing = detourSites.find(address);
+        if (existing != detourSites.end()) return *existing->second;
+
+        size_t length = X86::CoveringLength((const uint8_t*) address, JMP_SIZE);
+        if (length == 0)
+        {
+            throw std::runtime_error("CreateDetour: Could not decode instructions at " + ToHex(address));
+        }
+
+        auto site = new DetourSite;
+        uint8_t* code = AllocateExecutableMemory(MaxRelocatedSize(length) + JMP_SIZE + INDIRECT_JMP_SIZE);
+
+        // Trampoline
+        size_t relocatedSize = RelocateCode(address, length, code);
+        WriteJump(code + relocatedSize, address + length);
+        site->trampoline = code;
+        site->slot = code;
+
+        // The patched address jumps to this stub instead of directly to a detour
+        // so that the address only needs to be written once no matter how many detours are added
+        uint8_t* stub = code + relocatedSize + JMP_SIZE;
+        void* volatile* slotAddr = &site->slot;
+        stub[0] = 0xff;
+        stub[1] = 0x25;
+        memcpy(stub + 2, &slotAddr, sizeof(slotAddr));
+
+        PatchJMP(address, address + length, (int) (size_t) stub);
+
+        detourSites[address] = site;
+        return *site;
+    }
+
+    void* CreateDetour(size_t address, void* detour)
+    {
+        auto& site = GetDetourSite(address);
+        void* previous = site.slot;
+        site.slot = detour;
+        return previous;
+    }
+
+    void CreateMidFunctionHook(size_t address, void (__cdecl *func)())
+    {
+        auto& site = GetDetourSite(address);
+        uint8_t* thunk = AllocateExecutableMemory(16);
+
+        thunk[0] = 0x60; // pushad
+        thunk[1] = 0x9c; // pushfd
+        thunk[2] = 0xfc; // cld, the calling convention requires it
+        thunk[3] = 0xe8; // call func
+        WriteRel32(thunk + 4, (size_t) func);
+        thunk[8] = 0x9d; // popfd
+        thunk[9] = 0x61; // popad
+        WriteJump(thunk + 10, (size_t) site.slot);
+
+        site.slot = thunk;
+    }
+};
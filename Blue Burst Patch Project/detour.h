@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Hooking
+{
+    /**
+     * @brief Redirects execution at the address to the given function.
+     * The instructions overwritten at the address are relocated into a trampoline so they do not need to be
+     * reimplemented by the detour. The only requirement is that no other code jumps into the first 5 bytes after the address.
+     * Multiple detours can be created at the same address. The latest one is executed first.
+     * Returns a pointer to code that continues as if this detour did not exist,
+     * i.e. the previously created detour or the relocated original code.
+     */
+    void* CreateDetour(size_t address, void* detour);
+
+    template<typename F>
+    F CreateDetour(size_t address, F detour)
+    {
+        return reinterpret_cast<F>(CreateDetour(address, reinterpret_cast<void*>(detour)));
+    }
+
+    /**
+     * @brief Calls the function every time execution reaches the address and then continues with the original code.
+     * All registers and flags are preserved.
+     */
+    void CreateMidFunctionHook(size_t address, void (__cdecl *func)());
+
+    /// Returns memory that can be written to and executed. The memory is never freed.
+    uint8_t* AllocateExecutableMemory(size_t size);
+
+    /// Upper bound for the size of the code written by RelocateCode
+    size_t MaxRelocatedSize(size_t length);
+
+    /**
+     * @brief Copies whole instructions from the address to the destination, fixing up relative branches.
+     * Short jumps and conditional jumps are widened to rel32 so they can reach their target from anywhere.
+     * Throws if a branch goes into the copied code or cannot be relocated.
+     * Returns the number of bytes written.
+     */
+    size_t RelocateCode(size_t from, size_t length, uint8_t* to);
+};
@@ -1,4 +1,5 @@
 // dllmain.cpp : Defines the entry point for the DLL application.
+#include "logger.h"
 #include "psobb.h"
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -15,7 +16,11 @@ BOOL APIENTRY DllMain(HMODULE hModule,
         break;
         case DLL_THREAD_ATTACH:
         case DLL_THREAD_DETACH:
+        break;
         case DLL_PROCESS_DETACH:
+        // When the process is exiting the writer thread has already been killed, possibly while holding the queue,
+        // and the file can't safely be written anymore. Only an unload with FreeLibrary gets the last messages out.
+        if (lpReserved == nullptr) Logging::TryFlush();
         break;
     }
     return TRUE;
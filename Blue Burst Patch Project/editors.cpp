@@ -6,6 +6,7 @@
 
 #include "editors.h"
 #include "helpers.h"
+#include "patching.h"
 #include "keyboard.h"
 #include "psobb_functions.h"
 
@@ -207,7 +208,7 @@ void ReplaceTEditorRenderMethods(uint32_t *addrs, uint32_t num_addrs)
 {
 #if DELAYED_RENDERING==1
     for (uint32_t i = 0; i < num_addrs; ++i)
-        *(uint32_t *)addrs[i] = (uint32_t)&RenderEditorDrawList;
+        Patching::Write<uint32_t>(addrs[i], (uint32_t)&RenderEditorDrawList);
 #endif
 }
 
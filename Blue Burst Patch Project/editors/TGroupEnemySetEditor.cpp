@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include "helpers.h"
 #include "editors.h"
+#include "patching.h"
 #include "psobb_functions.h"
 
 static byte *TGroupEnemySetEditor_instance = NULL;
@@ -106,13 +107,13 @@ void ApplyTGroupEnemySetEditorPatches()
     PatchJMP(0x4f849c, 0x4f84a3, (int)&FreeBuffer);
 
     // Fix crashes when doing CLEAR or CLEAR(ALL) options in the menu...
-    *(uint32_t *)(0x4fb74a + 1) = bufferSize;
-    *(uint32_t *)(0x4fb75f + 1) = bufferSize;
-    *(uint32_t *)(0x4fb7ac + 1) = bufferSize;
+    Patching::Write<uint32_t>(0x4fb74a + 1, bufferSize);
+    Patching::Write<uint32_t>(0x4fb75f + 1, bufferSize);
+    Patching::Write<uint32_t>(0x4fb7ac + 1, bufferSize);
 
     // Allow our messagebox to run for errors
-    *(uint8_t *)(0x4f9de3 + 1) = 0x8E;
-    *(uint8_t *)(0x4f9dff + 1) = 0x8E;
+    Patching::Write<uint8_t>(0x4f9de3 + 1, 0x8E);
+    Patching::Write<uint8_t>(0x4f9dff + 1, 0x8E);
 
     // Fix the error file names
     PatchJMP(0x04fa0e8, 0x4fa0f1, (int)&FixFile1);
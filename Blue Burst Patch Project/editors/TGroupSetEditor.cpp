@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include "helpers.h"
 #include "editors.h"
+#include "patching.h"
 #include "psobb_functions.h"
 
 static byte *TGroupSetEditor_instance = NULL;
@@ -159,8 +160,8 @@ void ApplyTGroupSetEditorPatches()
     PatchJMP(0x4fbc1d, 0x4fbc24, (int)&FreeBuffer);
 
     // Fix message boxes
-    *(uint8_t *)(0x4fd93f + 1) = 0x8E;
-    *(uint8_t *)(0x4fd95b + 1) = 0x8E;
+    Patching::Write<uint8_t>(0x4fd93f + 1, 0x8E);
+    Patching::Write<uint8_t>(0x4fd95b + 1, 0x8E);
 
     // Patches to fix the filename selection. Looks like there was a way
     // to enter filename for saving/loading, but it doesn't exist in DC
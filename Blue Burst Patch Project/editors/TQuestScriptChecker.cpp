@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include "helpers.h"
 #include "editors.h"
+#include "patching.h"
 
 static byte *TQuestScriptChecker_instance = NULL;
 
@@ -181,7 +182,7 @@ void ApplyTQuestScriptCheckerPatches()
     // Add label number which was missing. Also change the text to be about labels
     // and not events.
     PatchJMP(0x6bad6a, 0x6bad6f, (int)&FixFunctionDisplay);
-    *(uint8_t *)(0x6bad79 + 2) = 0xC; // added an extra argument so fix stack
+    Patching::Write<uint8_t>(0x6bad79 + 2, 0xC); // added an extra argument so fix stack
 
     // Show how much the label input will increase by
     PatchJMP(0x6bad7c, 0x6bad81, (int)&ShowChange1);
@@ -2,6 +2,7 @@
 #include "enemy.h"
 #include "map.h"
 #include "object_extension.h"
+#include "patching.h"
 
 namespace Enemy
 {
@@ -87,7 +88,7 @@ namespace Enemy
             // Copy to heap (deliberate leak) and write new list to table
             TaggedEnemyConstructor* copy = new TaggedEnemyConstructor[enemyList.size()];
             std::copy(enemyList.begin(), enemyList.end(), copy);
-            mapEnemyTable[(size_t) map] = copy;
+            Patching::Write((size_t) &mapEnemyTable[(size_t) map], copy);
         }
     }
 
@@ -0,0 +1,262 @@
+#ifdef PATCH_ENTITY_SNAPSHOT
+
+#include <cmath>
+#include <limits>
+#include <xmmintrin.h>
+#include "entity_snapshot.h"
+#include "entitylist.h"
+#include "hooking.h"
+#include "map.h"
+
+namespace EntitySnapshot
+{
+    /// Room after the last element of the position arrays for reading 4 at a time
+    const size_t PADDING = 4;
+    /// Cells are at least this large in game units
+    const float GRID_CELL_SIZE = 50.0f;
+    /// Cells get larger instead of the grid getting wider than this, so that a huge map does not make the grid huge
+    const size_t MAX_GRID_SIZE = 64;
+
+    Snapshot snapshot;
+
+    /// Uniform XZ grid over the snapshot, rows of cells are stored one after another
+    struct Grid
+    {
+        float minX = 0.0f;
+        float minZ = 0.0f;
+        float cellSize = GRID_CELL_SIZE;
+        size_t width = 0;
+        size_t height = 0;
+        /// Where each cell's entities start in the arrays below, with one extra element for the end of the last cell
+        std::vector<size_t> cellStart;
+        /// Positions and snapshot slots sorted by cell, so that a row of cells is contiguous
+        std::vector<float> x;
+        std::vector<float> z;
+        std::vector<size_t> slot;
+    } grid;
+
+    std::vector<size_t> cellOfSlot;
+    std::vector<float> distanceScratch;
+    std::vector<Hit> hitScratch;
+
+    size_t Snapshot::Begin(Category category) const
+    {
+        switch (category)
+        {
+            case Category::Enemies:
+                return playerCount;
+            case Category::Objects:
+                return playerCount + enemyCount;
+            default:
+                return 0;
+        }
+    }
+
+    size_t Snapshot::End(Category category) const
+    {
+        switch (category)
+        {
+            case Category::Players:
+                return playerCount;
+            case Category::Enemies:
+            case Category::PlayersAndEnemies:
+                return playerCount + enemyCount;
+            default:
+                return Count();
+        }
+    }
+
+    const Snapshot& Current()
+    {
+        return snapshot;
+    }
+
+    void DistancesSquaredXZ(const float* xs, const float* zs, size_t count, float originX, float originZ, float* out)
+    {
+        __m128 ox = _mm_set1_ps(originX);
+        __m128 oz = _mm_set1_ps(originZ);
+
+        for (size_t i = 0; i < count; i += 4)
+        {
+            __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), ox);
+            __m128 dz = _mm_sub_ps(_mm_loadu_ps(zs + i), oz);
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)));
+        }
+    }
+
+    const float* CategoryDistances(Category category, const Vec3f& origin)
+    {
+        size_t begin = snapshot.Begin(category);
+        size_t count = snapshot.End(category) - begin;
+
+        distanceScratch.resize(count + PADDING);
+        DistancesSquaredXZ(snapshot.x.data() + begin, snapshot.z.data() + begin, count, origin.x, origin.z, distanceScratch.data());
+
+        return distanceScratch.data();
+    }
+
+    const std::vector<Hit>& HitsWithinRadius(const Vec3f& origin, float radius)
+    {
+        hitScratch.clear();
+        if (grid.width == 0) return hitScratch;
+
+        // Cell coordinates of the circle's bounding box, which may be partially or completely outside the grid
+        float left = std::floor((origin.x - radius - grid.minX) / grid.cellSize);
+        float right = std::floor((origin.x + radius - grid.minX) / grid.cellSize);
+        float top = std::floor((origin.z - radius - grid.minZ) / grid.cellSize);
+        float bottom = std::floor((origin.z + radius - grid.minZ) / grid.cellSize);
+
+        if (right < 0.0f || bottom < 0.0f || left >= float(grid.width) || top >= float(grid.height)) return hitScratch;
+
+        size_t firstColumn = left < 0.0f ? 0 : size_t(left);
+        size_t lastColumn = std::min(size_t(right), grid.width - 1);
+        size_t firstRow = top < 0.0f ? 0 : size_t(top);
+        size_t lastRow = std::min(size_t(bottom), grid.height - 1);
+        float radiusSquared = radius * radius;
+
+        for (size_t row = firstRow; row <= lastRow; row++)
+        {
+            size_t begin = grid.cellStart[row * grid.width + firstColumn];
+            size_t end = grid.cellStart[row * grid.width + lastColumn + 1];
+            size_t count = end - begin;
+
+            distanceScratch.resize(count + PADDING);
+            DistancesSquaredXZ(grid.x.data() + begin, grid.z.data() + begin, count, origin.x, origin.z, distanceScratch.data());
+
+            for (size_t i = 0; i < count; i++)
+            {
+                if (distanceScratch[i] <= radiusSquared)
+                {
+                    hitScratch.push_back(Hit{grid.slot[begin + i], distanceScratch[i]});
+                }
+            }
+        }
+
+        return hitScratch;
+    }
+
+    void BuildGrid()
+    {
+        size_t count = snapshot.Count();
+
+        grid.width = 0;
+        grid.height = 0;
+        if (count == 0) return;
+
+        float minX = snapshot.x[0];
+        float maxX = snapshot.x[0];
+        float minZ = snapshot.z[0];
+        float maxZ = snapshot.z[0];
+        for (size_t i = 1; i < count; i++)
+        {
+            minX = std::min(minX, snapshot.x[i]);
+            maxX = std::max(maxX, snapshot.x[i]);
+            minZ = std::min(minZ, snapshot.z[i]);
+            maxZ = std::max(maxZ, snapshot.z[i]);
+        }
+
+        float extent = std::max(maxX - minX, maxZ - minZ);
+        // Positions that are not finite would leave nothing sensible to grid by
+        if (!std::isfinite(extent)) return;
+
+        grid.minX = minX;
+        grid.minZ = minZ;
+        grid.cellSize = std::max(GRID_CELL_SIZE, extent / float(MAX_GRID_SIZE - 1));
+        grid.width = size_t((maxX - minX) / grid.cellSize) + 1;
+        grid.height = size_t((maxZ - minZ) / grid.cellSize) + 1;
+
+        // Counting sort by cell
+        grid.cellStart.assign(grid.width * grid.height + 1, 0);
+        cellOfSlot.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t column = std::min(size_t((snapshot.x[i] - minX) / grid.cellSize), grid.width - 1);
+            size_t row = std::min(size_t((snapshot.z[i] - minZ) / grid.cellSize), grid.height - 1);
+            cellOfSlot[i] = row * grid.width + column;
+            grid.cellStart[cellOfSlot[i] + 1]++;
+        }
+
+        for (size_t cell = 1; cell < grid.cellStart.size(); cell++)
+        {
+            grid.cellStart[cell] += grid.cellStart[cell - 1];
+        }
+
+        grid.x.assign(count + PADDING, std::numeric_limits<float>::infinity());
+        grid.z.assign(count + PADDING, std::numeric_limits<float>::infinity());
+        grid.slot.resize(count);
+
+        // cellStart is used as the insertion cursor and is shifted back by one cell in the process
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t to = grid.cellStart[cellOfSlot[i]]++;
+            grid.x[to] = snapshot.x[i];
+            grid.z[to] = snapshot.z[i];
+            grid.slot[to] = i;
+        }
+
+        for (size_t cell = grid.cellStart.size() - 1; cell > 0; cell--)
+        {
+            grid.cellStart[cell] = grid.cellStart[cell - 1];
+        }
+        grid.cellStart[0] = 0;
+    }
+
+    void Capture()
+    {
+        snapshot.playerCount = *EntityList::playerCount;
+        snapshot.enemyCount = *EntityList::enemyCount;
+        snapshot.objectCount = *EntityList::objectCount;
+
+        size_t count = snapshot.Count();
+        size_t firstObject = snapshot.Begin(Category::Objects);
+
+        snapshot.x.assign(count + PADDING, std::numeric_limits<float>::infinity());
+        snapshot.y.resize(count);
+        snapshot.z.assign(count + PADDING, std::numeric_limits<float>::infinity());
+        snapshot.mapSection.resize(count);
+        snapshot.flags.resize(count);
+        snapshot.entityIndex.resize(count);
+        snapshot.objectType.resize(count);
+        snapshot.entity.resize(count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            void* ptr = EntityList::entityList[i];
+            auto entity = Entity::BaseEntityWrapper(ptr);
+
+            snapshot.x[i] = entity.position().x;
+            snapshot.y[i] = entity.position().y;
+            snapshot.z[i] = entity.position().z;
+            snapshot.flags[i] = entity.entityFlags();
+            snapshot.entityIndex[i] = entity.entityIndex();
+            snapshot.entity[i] = ptr;
+
+            if (i >= firstObject)
+            {
+                auto obj = Map::MapObjectWrapper(ptr);
+                auto type = obj.mapObjectType();
+                snapshot.mapSection[i] = obj.mapSection();
+                snapshot.objectType[i] = type != nullptr ? *type : 0;
+            }
+            else
+            {
+                snapshot.mapSection[i] = (uint16_t) entity.mapSection();
+                snapshot.objectType[i] = 0;
+            }
+        }
+
+        BuildGrid();
+    }
+
+    void __cdecl OnSceneUpdated(void*)
+    {
+        Capture();
+    }
+
+    void ApplyEntitySnapshotPatch()
+    {
+        Hooking::afterSceneUpdate.AddCallback(OnSceneUpdated, nullptr, "Entity snapshot");
+    }
+};
+
+#endif // PATCH_ENTITY_SNAPSHOT
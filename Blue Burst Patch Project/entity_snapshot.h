@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "entity.h"
+#include "mathutil.h"
+
+/**
+ * Copy of the fields that AI code searches entities by, taken once per frame after the scene update.
+ * Scanning these arrays is much cheaper than walking the entity list and reading each game object field by field,
+ * so code that looks at many entities every frame should query this instead.
+ * The snapshot is from the end of the previous frame. Entity pointers in it may have been destroyed since,
+ * use EntityList::FindEntity with the entity index before touching the entity itself.
+ */
+namespace EntitySnapshot
+{
+    enum class Category
+    {
+        Players,
+        Enemies,
+        Objects,
+        PlayersAndEnemies,
+        All
+    };
+
+    struct Snapshot
+    {
+        /**
+         * One element per entity in entity list order, i.e. players, then enemies, then objects.
+         * The position arrays have infinitely far away padding after the last entity so that they can be read 4 at a time.
+         */
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        /// Objects store the section they were placed in, players and enemies the section they are currently in
+        std::vector<uint16_t> mapSection;
+        std::vector<Entity::EntityFlag> flags;
+        std::vector<Entity::EntityIndex> entityIndex;
+        /// The map object type of objects, 0 for players and enemies
+        std::vector<uint16_t> objectType;
+        std::vector<void*> entity;
+
+        size_t playerCount = 0;
+        size_t enemyCount = 0;
+        size_t objectCount = 0;
+
+        size_t Count() const { return playerCount + enemyCount + objectCount; }
+        size_t Begin(Category category) const;
+        size_t End(Category category) const;
+        Vec3f Position(size_t slot) const { return Vec3f{x[slot], y[slot], z[slot]}; }
+    };
+
+    struct Hit
+    {
+        /// Index into the snapshot's arrays
+        size_t slot;
+        float distanceSquared;
+    };
+
+    const Snapshot& Current();
+
+    /**
+     * @brief Writes the squared XZ distance from (originX, originZ) to the first count positions into out.
+     * Processes 4 positions at a time with SSE, so the inputs are read and out is written up to count rounded up to a multiple of 4.
+     */
+    void DistancesSquaredXZ(const float* xs, const float* zs, size_t count, float originX, float originZ, float* out);
+
+    /// Distances from the origin to the entities in the category, valid until the next query
+    const float* CategoryDistances(Category category, const Vec3f& origin);
+
+    /**
+     * @brief Finds up to maxHits nearest entities of the category that are accepted by the filter, nearest first.
+     * The filter is called with the snapshot and a slot.
+     * Returns the number of hits written.
+     */
+    template<typename Filter>
+    size_t Nearest(const Vec3f& origin, Category category, size_t maxHits, Filter filter, Hit* out)
+    {
+        const Snapshot& snapshot = Current();
+        size_t begin = snapshot.Begin(category);
+        size_t end = snapshot.End(category);
+        const float* distances = CategoryDistances(category, origin);
+        size_t hitCount = 0;
+
+        if (maxHits == 0) return 0;
+
+        for (size_t slot = begin; slot < end; slot++)
+        {
+            float dist = distances[slot - begin];
+
+            // Rejecting by distance first keeps the filter off the hot path
+            if (hitCount == maxHits && dist >= out[hitCount - 1].distanceSquared) continue;
+            if (!filter(snapshot, slot)) continue;
+
+            // Insertion into the sorted hits, maxHits is expected to be small
+            size_t i = hitCount < maxHits ? hitCount++ : hitCount - 1;
+            for (; i > 0 && out[i - 1].distanceSquared > dist; i--)
+            {
+                out[i] = out[i - 1];
+            }
+            out[i] = Hit{slot, dist};
+        }
+
+        return hitCount;
+    }
+
+    /// Every entity within the XZ radius regardless of category, valid until the next query
+    const std::vector<Hit>& HitsWithinRadius(const Vec3f& origin, float radius);
+
+    /**
+     * @brief Finds every entity of the category within the XZ radius that is accepted by the filter, in no particular order.
+     * Only the grid cells that overlap the radius are looked at.
+     * Hits are appended to out and their number is returned.
+     */
+    template<typename Filter>
+    size_t WithinRadius(const Vec3f& origin, float radius, Category category, Filter filter, std::vector<Hit>& out)
+    {
+        const Snapshot& snapshot = Current();
+        size_t begin = snapshot.Begin(category);
+        size_t end = snapshot.End(category);
+        size_t hitsBefore = out.size();
+
+        for (const Hit& hit : HitsWithinRadius(origin, radius))
+        {
+            if (hit.slot >= begin && hit.slot < end && filter(snapshot, hit.slot))
+            {
+                out.push_back(hit);
+            }
+        }
+
+        return out.size() - hitsBefore;
+    }
+
+    /// Takes a new snapshot. Called every frame by the patch, only needed when the snapshot must be up to date mid-frame.
+    void Capture();
+
+    void ApplyEntitySnapshotPatch();
+};
@@ -1,5 +1,12 @@
+#include <cstring>
 #include "entitylist.h"
 
+#ifdef PATCH_ENTITY_INDEX
+#include "detour.h"
+#include "enemy.h"
+#include "logger.h"
+#endif
+
 namespace EntityList
 {
     uint32_t* playerCount = reinterpret_cast<uint32_t*>(0x00aae168);
@@ -43,10 +50,9 @@ namespace EntityList
         return EntityIterator(entityList, *playerCount + *enemyCount);
     }
 
-    void* FindEntity(Entity::EntityIndex entityIndex)
+    /// Checks every entity in the list
+    void* ScanForEntity(Entity::EntityIndex entityIndex)
     {
-        if (entityIndex == -1) return nullptr;
-
         for (auto it = entityList, end = entityList + *totalEntityCount; it != end; it++)
         {
             auto entity = Entity::BaseEntityWrapper(*it);
@@ -58,4 +64,125 @@ namespace EntityList
 
         return nullptr;
     }
+
+#ifdef PATCH_ENTITY_INDEX
+    /// The game compares entity indices as unsigned 16-bit values
+    const size_t INDEX_TABLE_SIZE = 0x10000;
+
+    typedef uint32_t (__cdecl *EntityListFunction)(void* entity);
+    typedef uint32_t (__fastcall *InsertIntoEntityListDetour)(void* entity, void* edx);
+
+    bool indexEnabled = false;
+    /// Set when the list was changed by something that does not update the table
+    bool indexStale = true;
+    /// totalEntityCount as of the last change that the table knows about
+    uint32_t indexedCount = 0;
+    void* indexTable[INDEX_TABLE_SIZE];
+
+    InsertIntoEntityListDetour originalInsert = nullptr;
+    EntityListFunction originalInsertWithIndex = nullptr;
+    EntityListFunction originalRemove = nullptr;
+
+    uint16_t TableSlot(void* entity)
+    {
+        return (uint16_t) Entity::BaseEntityWrapper(entity).entityIndex();
+    }
+
+    void RebuildIndex()
+    {
+        memset(indexTable, 0, sizeof(indexTable));
+
+        for (auto it = entityList, end = entityList + *totalEntityCount; it != end; it++)
+        {
+            indexTable[TableSlot(*it)] = *it;
+        }
+
+        indexedCount = *totalEntityCount;
+        indexStale = false;
+    }
+
+    /// Inserting an index that is already in the list does nothing, so the count tells whether the entity was added
+    void OnInserted(void* entity, uint32_t countBefore)
+    {
+        if (countBefore != indexedCount) indexStale = true;
+        if (indexStale || *totalEntityCount == countBefore) return;
+
+        indexTable[TableSlot(entity)] = entity;
+        indexedCount = *totalEntityCount;
+    }
+
+    /// Removing an entity that is not in the list does nothing
+    void OnRemoved(void* entity, uint32_t countBefore)
+    {
+        if (countBefore != indexedCount) indexStale = true;
+        if (indexStale || *totalEntityCount == countBefore) return;
+
+        indexTable[TableSlot(entity)] = nullptr;
+        indexedCount = *totalEntityCount;
+    }
+
+    /// Enemy::InsertIntoEntityList, assigns the entity an index before inserting it
+    uint32_t __fastcall InsertHook(void* entity, void* edx)
+    {
+        uint32_t countBefore = *totalEntityCount;
+        uint32_t result = originalInsert(entity, edx);
+        OnInserted(entity, countBefore);
+        return result;
+    }
+
+    /// Inserts an entity whose index has already been assigned
+    uint32_t __cdecl InsertWithIndexHook(void* entity)
+    {
+        uint32_t countBefore = *totalEntityCount;
+        uint32_t result = originalInsertWithIndex(entity);
+        OnInserted(entity, countBefore);
+        return result;
+    }
+
+    uint32_t __cdecl RemoveHook(void* entity)
+    {
+        uint32_t countBefore = *totalEntityCount;
+        uint32_t result = originalRemove(entity);
+        OnRemoved(entity, countBefore);
+        return result;
+    }
+
+    void* LookUpEntity(Entity::EntityIndex entityIndex)
+    {
+        if (indexStale || *totalEntityCount != indexedCount) RebuildIndex();
+
+        void* found = indexTable[(uint16_t) entityIndex];
+
+#ifdef PATCH_ENTITY_INDEX_CROSSCHECK
+        void* scanned = ScanForEntity(entityIndex);
+        if (found != scanned)
+        {
+            Log(L"EntityList: Index table has %p for entity %d but the list has %p", found, (int) entityIndex, scanned);
+            RebuildIndex();
+            return scanned;
+        }
+#endif
+
+        return found;
+    }
+
+    void ApplyEntityIndexPatch()
+    {
+        originalInsert = Hooking::CreateDetour(0x007b4f54, InsertHook);
+        originalInsertWithIndex = Hooking::CreateDetour(0x007b4d98, InsertWithIndexHook);
+        originalRemove = Hooking::CreateDetour(0x007b4e84, RemoveHook);
+        indexEnabled = true;
+    }
+#endif
+
+    void* FindEntity(Entity::EntityIndex entityIndex)
+    {
+        if (entityIndex == -1) return nullptr;
+
+#ifdef PATCH_ENTITY_INDEX
+        if (indexEnabled) return LookUpEntity(entityIndex);
+#endif
+
+        return ScanForEntity(entityIndex);
+    }
 };
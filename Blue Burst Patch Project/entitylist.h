@@ -13,6 +13,8 @@ namespace EntityList
     extern uint32_t* totalEntityCount;
 
     extern void** entityList;
+    /// Number of slots in entityList
+    const size_t ENTITY_LIST_CAPACITY = 652;
 
     class EntityIterator
     {
@@ -53,4 +55,14 @@ namespace EntityList
     EntityIterator Objects();
     EntityIterator PlayersAndEnemies();
     void* FindEntity(Entity::EntityIndex entityIndex);
+
+#ifdef PATCH_ENTITY_INDEX
+    /**
+     * @brief Makes FindEntity a table lookup instead of a scan of the whole list.
+     * The table is kept up to date by hooking the game's entity list insert and remove functions.
+     * Anything that changes the list without going through them (clearing it between areas) is
+     * noticed when the entity count no longer matches and the table is rebuilt from the list.
+     */
+    void ApplyEntityIndexPatch();
+#endif
 };
@@ -2,6 +2,8 @@
 
 #include "helpers.h"
 #include "fastwarp.h"
+#include "profiler.h"
+#include "trace.h"
 
 /*
 This patch works by skipping the sleep portion of the render function
@@ -25,6 +27,9 @@ bool IsLoginLoadingScreenActive()
 
 void __fastcall BeforeInnerRenderCall(BOOL shouldPresent)
 {
+    PROFILE_SCOPE("Fastwarp: BeforeInnerRenderCall");
+    TRACE_SCOPE("Fastwarp: BeforeInnerRenderCall");
+
     if (IsLoginLoadingScreenActive())
     {
         *skipFrame = true;
@@ -46,6 +51,9 @@ void __fastcall BeforeInnerRenderCall(BOOL shouldPresent)
 
 void __cdecl BeforeAssetLoadingRenderCall()
 {
+    PROFILE_SCOPE("Fastwarp: BeforeAssetLoadingRenderCall");
+    TRACE_SCOPE("Fastwarp: BeforeAssetLoadingRenderCall");
+
     // Setting skipFrame here will also cause the shouldPresent parameter for the inner render function to be false
 #ifdef FASTWARP_NO_QUEST
     // During a quest, the quest loading screen will be skipped but not any other loading screens
@@ -60,6 +68,9 @@ void __cdecl BeforeAssetLoadingRenderCall()
 
 void __cdecl BeforeSleepLoopCall()
 {
+    PROFILE_SCOPE("Fastwarp: BeforeSleepLoopCall");
+    TRACE_SCOPE("Fastwarp: BeforeSleepLoopCall");
+
     if (*skipFrame)
     {
         *skipFrame = false;
@@ -0,0 +1,204 @@
+#ifdef PATCH_GROUND_CACHE
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include "common.h"
+#include "ground_cache.h"
+#include "hooking.h"
+#include "keyboard.h"
+#include "map.h"
+
+namespace GroundCache
+{
+    /// Horizontal size of a cell, which is also the furthest a reused sample can be from the query
+    const float CELL_SIZE = 1.0f;
+    /// Cells along each side of a tile
+    const int32_t TILE_SIZE = 16;
+    /// The whole cache is dropped instead of growing past this, about 5 MB
+    const size_t MAX_TILES = 1024;
+    /// Samples on either side of a cell boundary that are this close in height are treated as the same ground
+    const float HEIGHT_TOLERANCE = 0.01f;
+    /// Tile coordinates are packed into 16 bits each
+    const float MAX_TILE_COORDINATE = 32767.0f;
+
+    enum class CellState : uint8_t
+    {
+        Empty,
+        Ground,
+        NoGround
+    };
+
+    struct Cell
+    {
+        CellState state = CellState::Empty;
+        uint32_t type = 0;
+        float height = 0.0f;
+        /// Rays starting between these reach the same ground
+        float lowestOrigin = 0.0f;
+        float highestOrigin = 0.0f;
+    };
+
+    struct Tile
+    {
+        Cell cells[TILE_SIZE * TILE_SIZE];
+    };
+
+    bool enabled = true;
+
+    std::unordered_map<uint64_t, std::unique_ptr<Tile>> tiles;
+    Map::MapType cachedMap = (Map::MapType) 0;
+    void* cachedMeshes = nullptr;
+
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t hitsLastFrame = 0;
+    uint32_t missesLastFrame = 0;
+
+    uint32_t HitsLastFrame()
+    {
+        return hitsLastFrame;
+    }
+
+    uint32_t MissesLastFrame()
+    {
+        return missesLastFrame;
+    }
+
+    bool CacheEnabled()
+    {
+        return enabled;
+    }
+
+    GroundSample FindGroundExact(const Vec3f& position, uint32_t mask)
+    {
+        Vec3f origin = position;
+        Ground* ground = GetGround(&origin, mask);
+
+        GroundSample sample;
+        sample.found = ground != nullptr && ground->position != nullptr;
+        sample.type = sample.found ? ground->type : 0;
+        sample.position = sample.found ? Vec3f{ground->position->x, ground->position->y, ground->position->z} : position;
+        return sample;
+    }
+
+    void InvalidateIfMapChanged()
+    {
+        if (GetCurrentMap() != cachedMap || *collisionMeshes != cachedMeshes)
+        {
+            tiles.clear();
+            cachedMap = GetCurrentMap();
+            cachedMeshes = *collisionMeshes;
+        }
+    }
+
+    /// Only the low 16 bits of the mask fit in the key, callers check that the rest is zero
+    uint64_t TileKey(int32_t tileX, int32_t tileZ, uint16_t mapSection, uint32_t mask)
+    {
+        return (uint64_t) (uint16_t) tileX |
+            (uint64_t) (uint16_t) tileZ << 16 |
+            (uint64_t) mapSection << 32 |
+            (uint64_t) (uint16_t) mask << 48;
+    }
+
+    bool Covers(const Cell& cell, float originY)
+    {
+        return cell.state != CellState::Empty && originY >= cell.lowestOrigin && originY <= cell.highestOrigin;
+    }
+
+    void Record(Cell& cell, const GroundSample& sample, float originY)
+    {
+        CellState state = sample.found ? CellState::Ground : CellState::NoGround;
+        bool sameGround = cell.state == state &&
+            (!sample.found || (cell.type == sample.type && std::fabs(cell.height - sample.position.y) <= HEIGHT_TOLERANCE));
+
+        if (sameGround)
+        {
+            cell.lowestOrigin = std::min(cell.lowestOrigin, originY);
+            cell.highestOrigin = std::max(cell.highestOrigin, originY);
+            return;
+        }
+
+        cell.state = state;
+        cell.type = sample.type;
+        cell.height = sample.position.y;
+        cell.highestOrigin = originY;
+
+        if (sample.found)
+        {
+            // Nothing is in the way between the origin and the ground that was hit
+            cell.lowestOrigin = std::min(originY, sample.position.y);
+        }
+        else
+        {
+            // Nothing below the origin means nothing below any lower origin either
+            cell.lowestOrigin = -INFINITY;
+        }
+    }
+
+    GroundSample FindGround(const Vec3f& position, uint16_t mapSection, uint32_t mask)
+    {
+        float cellX = std::floor(position.x / CELL_SIZE);
+        float cellZ = std::floor(position.z / CELL_SIZE);
+        float tileX = std::floor(cellX / TILE_SIZE);
+        float tileZ = std::floor(cellZ / TILE_SIZE);
+
+        bool cacheable = enabled && (mask & 0xffff0000) == 0 && std::isfinite(position.y) &&
+            std::fabs(tileX) <= MAX_TILE_COORDINATE && std::fabs(tileZ) <= MAX_TILE_COORDINATE;
+        if (!cacheable) return FindGroundExact(position, mask);
+
+        InvalidateIfMapChanged();
+
+        auto& tile = tiles[TileKey((int32_t) tileX, (int32_t) tileZ, mapSection, mask)];
+        if (!tile)
+        {
+            if (tiles.size() > MAX_TILES)
+            {
+                tiles.clear();
+                return FindGround(position, mapSection, mask);
+            }
+
+            tile.reset(new Tile());
+        }
+
+        int32_t column = (int32_t) cellX - (int32_t) tileX * TILE_SIZE;
+        int32_t row = (int32_t) cellZ - (int32_t) tileZ * TILE_SIZE;
+        Cell& cell = tile->cells[row * TILE_SIZE + column];
+
+        if (Covers(cell, position.y))
+        {
+            hits++;
+
+            GroundSample sample;
+            sample.found = cell.state == CellState::Ground;
+            sample.type = cell.type;
+            sample.position = sample.found ? Vec3f{position.x, cell.height, position.z} : position;
+            return sample;
+        }
+
+        misses++;
+        GroundSample sample = FindGroundExact(position, mask);
+        Record(cell, sample, position.y);
+        return sample;
+    }
+
+    void __cdecl OnFrameEnd(void*)
+    {
+        hitsLastFrame = hits;
+        missesLastFrame = misses;
+        hits = 0;
+        misses = 0;
+    }
+
+    void ApplyGroundCachePatch()
+    {
+        Hooking::afterSceneUpdate.AddCallback(OnFrameEnd, nullptr, "Ground cache");
+
+        Keyboard::onKeyDown({Keyboard::Keycode::Ctrl, Keyboard::Keycode::G}, []() {
+            enabled = !enabled;
+        });
+    }
+};
+
+#endif // PATCH_GROUND_CACHE
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include "mathutil.h"
+
+/**
+ * Cache for GetGround, which raycasts against the map geometry and is the most expensive call in custom enemy updates.
+ * Results are stored per map section in tiles of small XZ cells that are filled on demand.
+ * A query reuses a cell if its ray starts within the vertical span that is known to reach the same ground,
+ * otherwise GetGround is called and the cell is updated.
+ * Everything is thrown away when the map or its collision geometry changes.
+ * Ctrl+G switches between the cache and calling GetGround every time.
+ */
+namespace GroundCache
+{
+    struct GroundSample
+    {
+        /// False if there is no ground below the position, in which case the other fields are not set
+        bool found;
+        uint32_t type;
+        /// The query position moved down to the ground
+        Vec3f position;
+    };
+
+    /**
+     * @brief Same as GetGround, but may answer from earlier queries that were at most one cell away horizontally.
+     * @param position Where the ray starts
+     * @param mapSection Section the querying entity belongs to
+     * @param mask Same as the second argument of GetGround
+     */
+    GroundSample FindGround(const Vec3f& position, uint16_t mapSection, uint32_t mask);
+
+    /// Always calls GetGround, for when the result must not be off by the cell size
+    GroundSample FindGroundExact(const Vec3f& position, uint32_t mask);
+
+    uint32_t HitsLastFrame();
+    uint32_t MissesLastFrame();
+    bool CacheEnabled();
+
+    void ApplyGroundCachePatch();
+};
@@ -1,6 +1,9 @@
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <vector>
 #include "helpers.h"
+#include "patching.h"
 
 int gcd(int a, int b)
 {
@@ -16,55 +19,32 @@ int gcd(int a, int b)
 
 void PatchNOP(int addrIn, int size)
 {
-    memset((void*)addrIn, 0x90, size);
+    std::vector<uint8_t> code(size, 0x90);
+    Patching::WriteBytes(addrIn, code.data(), code.size());
 }
-void PatchCALL(int addrIn, int addrOut, int addrDest)
+
+/// Writes a rel32 CALL or JMP followed by NOPs
+static void PatchRel32(int addrIn, int addrOut, int addrDest, uint8_t opcode)
 {
-    int size = addrOut - addrIn;
-    memset((void*)addrIn, 0x90, size);
-    *(unsigned char*)addrIn = 0xE8;
-    *(int*)(addrIn + 1) = addrDest - (addrIn + 5);
+    std::vector<uint8_t> code(addrOut - addrIn, 0x90);
+    int rel = addrDest - (addrIn + 5);
+    code[0] = opcode;
+    memcpy(&code[1], &rel, sizeof(rel));
+    Patching::WriteBytes(addrIn, code.data(), code.size());
 }
-void PatchJMP(int addrIn, int addrOut, int addrDest)
+
+void PatchCALL(int addrIn, int addrOut, int addrDest)
 {
-    int size = addrOut - addrIn;
-    memset((void*)addrIn, 0x90, size);
-    *(unsigned char*)addrIn = 0xE9;
-    *(int*)(addrIn + 1) = addrDest - (addrIn + 5);
+    PatchRel32(addrIn, addrOut, addrDest, 0xE8);
 }
-
-void Log(const WCHAR* fmt, ...)
+void PatchJMP(int addrIn, int addrOut, int addrDest)
 {
-    va_list args;
-    WCHAR text[4096];
-    FILE* fp;
-    SYSTEMTIME rawtime;
-
-    _wfopen_s(&fp, L"log\\dll.log", L"a, ccs=UTF-16LE");
-    if (fp != NULL)
-    {
-        GetLocalTime(&rawtime);
-        va_start(args, fmt);
-        vswprintf_s(text, sizeof(text) / sizeof(WCHAR), fmt, args);
-        va_end(args);
-
-        wcscat_s(text, sizeof(text) / sizeof(WCHAR), L"\n");
-
-        fwprintf_s(fp,
-            L"[%02u-%02u-%u, %02u:%02u:%02u] %s",
-            rawtime.wMonth,
-            rawtime.wDay,
-            rawtime.wYear,
-            rawtime.wHour,
-            rawtime.wMinute,
-            rawtime.wSecond,
-            text);
-        fclose(fp);
-    }
+    PatchRel32(addrIn, addrOut, addrDest, 0xE9);
 }
 
 void StubOutFunction(int addrIn, int addrOut)
 {
-    PatchNOP(addrIn, addrOut - addrIn);
-    *(uint8_t*) addrIn = 0xc3; // ret
+    std::vector<uint8_t> code(addrOut - addrIn, 0x90);
+    code[0] = 0xc3; // ret
+    Patching::WriteBytes(addrIn, code.data(), code.size());
 }
@@ -2,7 +2,10 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <stdexcept>
+#include <sstream>
 
+#include "detour.h"
 #include "hooking.h"
 #include "helpers.h"
 
@@ -11,22 +14,74 @@ namespace Hooking
     std::unordered_map<size_t, Hook> Hook::createdHooks;
 
     // Initialize common hooks
-    Hook& afterSceneUpdate = CreateHook<0x7a5f23, 0x7a5f2a>([]() {
-        // Original code
-        *reinterpret_cast<int*>(0x00a9c4ec) += 1;
-    });    
+    Hook& afterSceneUpdate = CreateHook<0x7a5f23>();
 
     Hook::Hook(PrivateCtorMarker priv, size_t callAddrIn, size_t callAddrOut)
-        : callAddrIn(callAddrIn), callAddrOut(callAddrOut) {}
+        : callAddrIn(callAddrIn), callAddrOut(callAddrOut), installed(false), dispatchTable(nullptr), callbackCaller(nullptr) {}
 
-    void Hook::Install() const
+    void __cdecl Hook::CallHookFn(void* hookFn)
     {
-        PatchCALL(callAddrIn, callAddrOut, reinterpret_cast<int>(callbackCaller));
+        (*static_cast<HookFn*>(hookFn))();
     }
 
-    void Hook::AddCallback(HookFn func)
+    void Hook::Install()
     {
-        callbacks.push_back(func);
+        if (installed) return;
+
+        // Copy the callbacks to a null-terminated array which will be deliberately leaked
+        // because the patched code keeps calling through it for the entire lifetime of the program
+        CallbackEntry* frozen = new CallbackEntry[callbacks.size() + 1];
+        std::copy(callbacks.begin(), callbacks.end(), frozen);
+        frozen[callbacks.size()] = CallbackEntry{};
+        *dispatchTable = frozen;
+
+#if defined(PATCH_PROFILER) || defined(PATCH_TRACING)
+        for (size_t i = 0; i < callbacks.size(); i++)
+        {
+            std::stringstream name;
+            name << "Hook(" << std::hex << callAddrIn << ")";
+            if (callbackNames[i].empty()) name << " #" << std::dec << i;
+            else name << " " << callbackNames[i];
+
+#ifdef PATCH_PROFILER
+            frozen[i].histogram = &Profiler::CreateHistogram(name.str());
+#endif
+#ifdef PATCH_TRACING
+            frozen[i].traceName = Tracing::PersistentName(name.str());
+#endif
+        }
+#endif
+
+        if (callAddrOut == 0)
+        {
+            CreateMidFunctionHook(callAddrIn, callbackCaller);
+        }
+        else
+        {
+            PatchCALL(callAddrIn, callAddrOut, (int) reinterpret_cast<size_t>(callbackCaller));
+        }
+
+        installed = true;
+    }
+
+    void Hook::AddCallback(HookFn func, const std::string& name)
+    {
+        ownedCallbacks.push_back(func);
+        AddCallback(CallHookFn, &ownedCallbacks.back(), name);
+    }
+
+    void Hook::AddCallback(RawHookFn func, void* context, const std::string& name)
+    {
+        if (installed)
+        {
+            throw std::runtime_error("Hook: Tried to add a callback after the hook was installed");
+        }
+
+        CallbackEntry entry = {};
+        entry.fn = func;
+        entry.context = context;
+        callbacks.push_back(entry);
+        callbackNames.push_back(name);
     }
 
     bool Hook::operator<(const Hook& right) const
@@ -36,7 +91,7 @@ namespace Hooking
 
     void InstallAllHooks()
     {
-        for (const auto& [_, hook] : Hook::createdHooks)
+        for (auto& [_, hook] : Hook::createdHooks)
         {
             hook.Install();
         }
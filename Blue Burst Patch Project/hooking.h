@@ -2,52 +2,118 @@
 
 #include <cstddef>
 #include <functional>
+#include <list>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+#ifdef PATCH_PROFILER
+#include "profiler.h"
+#endif
+
+#ifdef PATCH_TRACING
+#include "trace.h"
+#endif
+
 namespace Hooking
 {
     using HookFn = std::function<void ()>;
+    /// Callback without any wrapper object, receives the context pointer given to AddCallback
+    typedef void (__cdecl *RawHookFn)(void* context);
 
     class Hook
     {
     private:
         struct PrivateCtorMarker {};
 
+        /// One element of a dispatch table
+        struct CallbackEntry
+        {
+            RawHookFn fn;
+            void* context;
+#ifdef PATCH_PROFILER
+            Profiler::Histogram* histogram;
+#endif
+#ifdef PATCH_TRACING
+            const char* traceName;
+#endif
+        };
+
         size_t callAddrIn;
+        /// Zero if the original code is relocated by the detour engine instead of being overwritten with a CALL
         size_t callAddrOut;
-        std::vector<HookFn> callbacks;
+        /// Callbacks in the order they were added. Only used until the hook is installed.
+        std::vector<CallbackEntry> callbacks;
+        /// Names of the callbacks for diagnostics, same order as callbacks
+        std::vector<std::string> callbackNames;
+        /// Storage for std::function callbacks. A list is used so that their addresses can be used as context pointers.
+        std::list<HookFn> ownedCallbacks;
+        bool installed;
+        /// Points to the dispatch table used by callbackCaller
+        const CallbackEntry** dispatchTable;
         /**
          * @brief This is the actual function that gets patched in
          */
         void (__cdecl *callbackCaller)();
 
         template<size_t, size_t> friend Hook& CreateHook();
+        template<size_t> friend Hook& CreateHook();
         friend void InstallAllHooks();
 
         /// Store created hooks here, one per address.
         static std::unordered_map<size_t, Hook> createdHooks;
 
+        /**
+         * @brief Null-terminated array of callbacks for each address.
+         * Written once when the hook is installed and never modified after that.
+         */
+        template<size_t addr>
+        static inline const CallbackEntry* dispatchTableFor = nullptr;
+
         /**
          * @brief Used to generate the function that gets patched in
          */
         template<size_t addr>
         static void __cdecl CallHookCallbacks()
         {
-            if (auto it = createdHooks.find(addr); it != Hook::createdHooks.end())
-                for (auto cb : (*it).second.callbacks) cb();
+            for (auto entry = dispatchTableFor<addr>; entry->fn != nullptr; entry++)
+            {
+#ifdef PATCH_PROFILER
+                Profiler::ScopedTimer timer(*entry->histogram);
+#endif
+#ifdef PATCH_TRACING
+                Tracing::ScopedZone zone(entry->traceName);
+#endif
+                entry->fn(entry->context);
+            }
         }
 
+        static void __cdecl CallHookFn(void* hookFn);
+
         /**
-         * @brief Patches in the function call to the hook
+         * @brief Freezes the callbacks into the dispatch table and patches in the function call to the hook
          */
-        void Install() const;
+        void Install();
 
     public:
         // Constructor must be public to be able to use this class with std containers,
         // but it is not constructible without access to private member
         Hook(PrivateCtorMarker thisConstructorIsPrivate, size_t callAddrIn, size_t callAddrOut);
-        void AddCallback(HookFn func);
+        /**
+         * @brief Callbacks must be added before InstallAllHooks is called.
+         * The name is only used for diagnostics such as the profiler.
+         */
+        void AddCallback(HookFn func, const std::string& name = "");
+        /**
+         * @brief Cheaper alternative to the std::function overload.
+         * The context pointer is passed to the callback as is.
+         */
+        void AddCallback(RawHookFn func, void* context = nullptr, const std::string& name = "");
+        /**
+         * @brief Runs the callbacks the same way the patched in code does, e.g. for benchmarks.
+         * Only valid after InstallAllHooks.
+         */
+        void Run() const { callbackCaller(); }
         /**
          * @brief Needed for inserting Hooks into std containers
          */
@@ -68,6 +134,22 @@ namespace Hooking
         // Create the callback calling function
         auto& hook = (*entry).second;
         hook.callbackCaller = Hook::CallHookCallbacks<callAddrIn>;
+        hook.dispatchTable = &Hook::dispatchTableFor<callAddrIn>;
+        return hook;
+    }
+
+    /**
+     * @brief Creates a hook that calls its callbacks before executing the original code at the specified address.
+     * The overwritten instructions are relocated so they do not need to be restored by a callback.
+     * Registers and flags are preserved across the callbacks.
+     */
+    template<size_t addr>
+    Hook& CreateHook()
+    {
+        auto&& [entry, _] = Hook::createdHooks.try_emplace(addr, Hook::PrivateCtorMarker{}, addr, 0);
+        auto& hook = (*entry).second;
+        hook.callbackCaller = Hook::CallHookCallbacks<addr>;
+        hook.dispatchTable = &Hook::dispatchTableFor<addr>;
         return hook;
     }
 
@@ -83,8 +165,17 @@ namespace Hooking
         return hook;
     }
 
+    template<size_t callAddrIn, size_t callAddrOut>
+    Hook& CreateHook(RawHookFn initialCallback)
+    {
+        auto& hook = CreateHook<callAddrIn, callAddrOut>();
+        hook.AddCallback(initialCallback);
+        return hook;
+    }
+
     /**
      * @brief Patches in the CALLs to all created hooks.
+     * Callbacks can no longer be added after this.
      */
     void InstallAllHooks();
 
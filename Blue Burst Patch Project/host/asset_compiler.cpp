@@ -0,0 +1,44 @@
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include "newgfx/asset_compiler.h"
+#include "newgfx/compiled_asset.h"
+
+/**
+ * Converts a model file into the compiled asset format (see compiled_asset.h) ahead of time, so that the client
+ * maps it instead of importing the model with assimp. The conversion itself is in newgfx/asset_compiler.h.
+ *
+ * Usage: asset_compiler <model file> [output file]
+ * The output defaults to the path that ModelLoader::Prefetch looks for.
+ */
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s <model file> [output file]\n", argv[0]);
+        return 1;
+    }
+
+    std::string input = argv[1];
+    std::string output = argc == 3 ? argv[2] : CompiledAsset::CompiledPath(input);
+
+    try
+    {
+        auto data = AssetCompiler::CompileFile(input);
+
+        std::ofstream file(output, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file)
+            throw std::runtime_error("Failed to write " + output);
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "%s: %s\n", input.c_str(), e.what());
+        return 1;
+    }
+
+    printf("Wrote %s\n", output.c_str());
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "newgfx/bone.h"
+#include "test.h"
+
+/**
+ * Checks Bone::Sample on keyframes that are searched with a cursor and on tracks that Resample spaced evenly,
+ * which are indexed directly: resampling stays close to the original animation, times outside of the keyframes
+ * clamp to the first or last one, and a cursor that goes backwards, like it does when the animation loops,
+ * gives the same result as a new one.
+ */
+
+const float DURATION = 30.0f;
+const float STEP = 1.0f;
+/// Resampled rotations are blended with nlerp between samples instead of slerp between the original keyframes
+const float RESAMPLE_TOLERANCE = 2e-3f;
+
+float MaxDifference(const aiMatrix4x4& a, const aiMatrix4x4& b)
+{
+    float difference = 0.0f;
+    for (unsigned row = 0; row < 4; row++)
+    {
+        for (unsigned column = 0; column < 4; column++)
+        {
+            difference = std::max(difference, std::abs(a[row][column] - b[row][column]));
+        }
+    }
+
+    return difference;
+}
+
+aiQuaternion RotationZ(float angle)
+{
+    return aiQuaternion(std::cos(angle / 2.0f), 0.0f, 0.0f, std::sin(angle / 2.0f));
+}
+
+/// Unevenly spaced keyframes that end before DURATION, with a constant scale
+Bone MakeBone()
+{
+    std::vector<KeyPosition> positions = {
+        {aiVector3D(0.0f, 0.0f, 0.0f), 0.0f},
+        {aiVector3D(1.0f, 2.0f, 0.0f), 4.0f},
+        {aiVector3D(1.5f, 2.0f, -1.0f), 11.0f},
+        {aiVector3D(0.0f, 1.0f, -2.0f), 25.0f}};
+
+    std::vector<KeyRotation> rotations = {
+        {RotationZ(0.0f), 0.0f},
+        {RotationZ(0.4f), 3.0f},
+        {RotationZ(0.1f), 9.0f},
+        {RotationZ(-0.3f), 16.0f},
+        {RotationZ(0.2f), 27.0f}};
+
+    std::vector<KeyScale> scales = {{aiVector3D(1.0f, 1.0f, 1.0f), 0.0f}};
+
+    return Bone(positions, rotations, scales, 0.0f);
+}
+
+void TestResample()
+{
+    Bone original = MakeBone();
+    Bone resampled = MakeBone();
+    resampled.Resample(STEP, DURATION);
+
+    CHECK(resampled.SampleStep() == STEP);
+    CHECK(resampled.Positions().size() == size_t(DURATION / STEP) + 1);
+    CHECK(resampled.Rotations().size() == size_t(DURATION / STEP) + 1);
+    // Constant tracks are kept as they are
+    CHECK(resampled.Scales().size() == 1);
+
+    // Resampling twice does nothing
+    resampled.Resample(STEP / 2.0f, DURATION);
+    CHECK(resampled.SampleStep() == STEP);
+
+    KeyframeCursor originalCursor;
+    KeyframeCursor resampledCursor;
+    float worst = 0.0f;
+    for (float time = 0.0f; time <= DURATION; time += 0.25f)
+    {
+        worst = std::max(worst, MaxDifference(original.Sample(time, originalCursor), resampled.Sample(time, resampledCursor)));
+    }
+
+    CHECK(worst < RESAMPLE_TOLERANCE);
+
+    // On a sample the resampled track is exact
+    KeyframeCursor cursor;
+    CHECK(MaxDifference(original.Sample(11.0f, cursor), resampled.Sample(11.0f, resampledCursor)) < 1e-5f);
+}
+
+void TestClamping()
+{
+    Bone searched = MakeBone();
+    Bone indexed = MakeBone();
+    indexed.Resample(STEP, DURATION);
+
+    for (const Bone* bone : {&searched, &indexed})
+    {
+        KeyframeCursor cursor;
+        auto first = bone->Sample(0.0f, cursor);
+        auto last = bone->Sample(DURATION, cursor);
+
+        // Past the last keyframe, past the end of the resampled range and before the start
+        CHECK(MaxDifference(bone->Sample(DURATION + 5.0f, cursor), last) < 1e-6f);
+        CHECK(MaxDifference(bone->Sample(DURATION * 100.0f, cursor), last) < 1e-6f);
+        CHECK(MaxDifference(bone->Sample(-3.0f, cursor), first) < 1e-6f);
+    }
+
+    // The original tracks end at 25 and 27, so everything after that is the last keyframe
+    KeyframeCursor cursor;
+    auto end = searched.Sample(27.0f, cursor);
+    CHECK(MaxDifference(searched.Sample(29.5f, cursor), end) < 1e-6f);
+    CHECK(std::abs(end.a4 - 0.0f) < 1e-6f && std::abs(end.b4 - 1.0f) < 1e-6f && std::abs(end.c4 + 2.0f) < 1e-6f);
+}
+
+void TestCursorGoingBackwards()
+{
+    Bone bone = MakeBone();
+
+    // Play up to near the end, then loop back to the start like AnimationInstance does
+    KeyframeCursor cursor;
+    for (float time = 0.0f; time < 26.0f; time += 1.0f / 3.0f)
+    {
+        bone.Sample(time, cursor);
+    }
+    CHECK(cursor.position > 0 && cursor.rotation > 0);
+
+    for (float time : {0.5f, 3.5f, 10.0f, 20.0f, 1.0f})
+    {
+        KeyframeCursor fresh;
+        CHECK(MaxDifference(bone.Sample(time, cursor), bone.Sample(time, fresh)) == 0.0f);
+        CHECK(cursor.position == fresh.position && cursor.rotation == fresh.rotation);
+    }
+
+    // A cursor that points past the keyframes of a shorter track starts over as well
+    KeyframeCursor stale;
+    stale.position = 100;
+    stale.rotation = 100;
+    KeyframeCursor fresh;
+    CHECK(MaxDifference(bone.Sample(5.0f, stale), bone.Sample(5.0f, fresh)) == 0.0f);
+}
+
+int main()
+{
+    TestResample();
+    TestClamping();
+    TestCursorGoingBackwards();
+
+    return HostTest::Result();
+}
@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "newgfx/asset_compiler.h"
+#include "newgfx/compiled_asset.h"
+#include "newgfx/mesh.h"
+#include "newgfx/model_asset.h"
+#include "newgfx/skinning.h"
+#include "fixture_scene.h"
+#include "test.h"
+
+/**
+ * Compiles the fixture scene, reads it back the way ModelAsset does and compares it with the scene,
+ * then checks that the reader throws on damaged files instead of reading outside of them:
+ * truncated data, a wrong magic or version, offsets and counts that point past the end and
+ * records that refer to joints or bone slots that don't exist.
+ */
+
+/// Resampled rotations are blended with nlerp and stored as 16-bit integers
+const float TRACK_TOLERANCE = 2e-3f;
+
+using Data = std::vector<uint8_t>;
+
+float MaxDifference(const aiMatrix4x4& a, const aiMatrix4x4& b)
+{
+    float difference = 0.0f;
+    for (unsigned row = 0; row < 4; row++)
+    {
+        for (unsigned column = 0; column < 4; column++)
+        {
+            difference = std::max(difference, std::abs(a[row][column] - b[row][column]));
+        }
+    }
+
+    return difference;
+}
+
+/// Reads every section like ModelAsset, which throws if any of them is damaged
+void ReadEverything(const Data& data)
+{
+    CompiledAsset::View view(data.data(), data.size());
+    const auto& header = view.GetHeader();
+
+    CompiledAsset::ReadJoints(view);
+
+    auto clips = view.Array<CompiledAsset::ClipRecord>(header.clipOffset, header.clipCount);
+    for (size_t i = 0; i < header.clipCount; i++)
+    {
+        std::vector<size_t> jointChannels;
+        CompiledAsset::ReadTracks(view, clips[i], jointChannels);
+    }
+
+    auto meshes = view.Array<CompiledAsset::MeshRecord>(header.meshOffset, header.meshCount);
+    for (size_t i = 0; i < header.meshCount; i++)
+    {
+        view.Array<Vertex>(meshes[i].vertexOffset, meshes[i].vertexCount);
+        view.Array<uint32_t>(meshes[i].indexOffset, meshes[i].indexCount);
+        if (meshes[i].influenceOffset != CompiledAsset::NONE)
+            view.Array<Skinning::VertexInfluences>(meshes[i].influenceOffset, meshes[i].vertexCount);
+    }
+
+    view.Array<CompiledAsset::TextureRecord>(header.textureOffset, header.textureCount);
+}
+
+bool Throws(const std::function<void()>& f)
+{
+    try
+    {
+        f();
+    }
+    catch (const std::runtime_error&)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+/// Copy of the data with a T at offset changed by edit
+template<typename T>
+Data Damaged(const Data& data, size_t offset, const std::function<void(T&)>& edit)
+{
+    Data copy = data;
+    T value;
+    memcpy(&value, copy.data() + offset, sizeof(T));
+    edit(value);
+    memcpy(copy.data() + offset, &value, sizeof(T));
+    return copy;
+}
+
+CompiledAsset::Header GetHeader(const Data& data)
+{
+    CompiledAsset::Header header;
+    memcpy(&header, data.data(), sizeof(header));
+    return header;
+}
+
+CompiledAsset::ClipRecord GetClip(const Data& data, size_t index)
+{
+    CompiledAsset::ClipRecord clip;
+    memcpy(&clip, data.data() + GetHeader(data).clipOffset + index * sizeof(clip), sizeof(clip));
+    return clip;
+}
+
+void TestRoundTrip(const aiScene* scene, const Data& data)
+{
+    CompiledAsset::View view(data.data(), data.size());
+    const auto& header = view.GetHeader();
+    CHECK(header.fileSize == data.size());
+    CHECK(header.boneCount == FIXTURE_BONES);
+    CHECK(header.meshCount == 1);
+    CHECK(header.clipCount == 2);
+    CHECK(header.textureCount == 0);
+
+    // The root followed by the chain of bones, each bone in the slot of its index in the mesh
+    auto joints = CompiledAsset::ReadJoints(view);
+    CHECK(joints.size() == FIXTURE_BONES + 1);
+    CHECK(joints[0].parent == Skeleton::NONE && joints[0].boneSlot == Skeleton::NONE);
+    for (size_t i = 1; i < joints.size() && i <= FIXTURE_BONES; i++)
+    {
+        CHECK(joints[i].parent == i - 1);
+        CHECK(joints[i].boneSlot == i - 1);
+        CHECK(MaxDifference(joints[i].offset, scene->mMeshes[0]->mBones[i - 1]->mOffsetMatrix) == 0.0f);
+    }
+
+    auto meshes = view.Array<CompiledAsset::MeshRecord>(header.meshOffset, header.meshCount);
+    CHECK(meshes[0].vertexCount == FIXTURE_RINGS * FIXTURE_SEGMENTS);
+    CHECK(meshes[0].indexCount == (FIXTURE_RINGS - 1) * FIXTURE_SEGMENTS * 6);
+    CHECK(meshes[0].texture == CompiledAsset::NONE);
+    CHECK(meshes[0].influenceOffset != CompiledAsset::NONE);
+
+    auto indices = view.Array<uint32_t>(meshes[0].indexOffset, meshes[0].indexCount);
+    CHECK(std::all_of(indices, indices + meshes[0].indexCount, [&](uint32_t index) { return index < meshes[0].vertexCount; }));
+
+    // Palette slot 0 is the identity, every vertex is weighted between two neighbouring bones
+    auto influences = view.Array<Skinning::VertexInfluences>(meshes[0].influenceOffset, meshes[0].vertexCount);
+    bool influencesValid = true;
+    for (size_t i = 0; i < meshes[0].vertexCount; i++)
+    {
+        float total = 0.0f;
+        for (size_t j = 0; j < Skinning::MAX_INFLUENCES; j++)
+        {
+            influencesValid &= influences[i].slot[j] <= FIXTURE_BONES;
+            total += influences[i].weight[j];
+        }
+        influencesValid &= std::abs(total - 1.0f) < 1e-5f;
+    }
+    CHECK(influencesValid);
+
+    auto clips = view.Array<CompiledAsset::ClipRecord>(header.clipOffset, header.clipCount);
+    for (size_t clipIdx = 0; clipIdx < header.clipCount; clipIdx++)
+    {
+        const auto& clip = clips[clipIdx];
+        const auto animation = scene->mAnimations[clipIdx];
+        CHECK(std::string(clip.name) == animation->mName.C_Str());
+        CHECK(clip.duration == float(animation->mDuration));
+        CHECK(clip.ticksPerSecond == float(animation->mTicksPerSecond));
+        CHECK(clip.sampleStep == clip.ticksPerSecond * DELTA_TIME);
+
+        std::vector<size_t> jointChannels;
+        auto bones = CompiledAsset::ReadTracks(view, clip, jointChannels);
+        CHECK(bones.size() == FIXTURE_BONES);
+        CHECK(jointChannels.size() == joints.size());
+        if (bones.size() != FIXTURE_BONES || jointChannels.size() != joints.size()) continue;
+        CHECK(jointChannels[0] == Skeleton::NONE);
+
+        // Each bone plays back close to the channel it was compiled from
+        float worst = 0.0f;
+        for (size_t i = 0; i < FIXTURE_BONES; i++)
+        {
+            if (!CHECK(jointChannels[i + 1] < bones.size())) continue;
+
+            Bone original("bone" + std::to_string(i), i, animation->mChannels[i]);
+            const auto& compiled = bones[jointChannels[i + 1]];
+            CHECK(compiled.SampleStep() == clip.sampleStep);
+
+            KeyframeCursor originalCursor;
+            KeyframeCursor compiledCursor;
+            for (float time = 0.0f; time <= clip.duration; time += 0.25f)
+            {
+                worst = std::max(worst, MaxDifference(original.Sample(time, originalCursor), compiled.Sample(time, compiledCursor)));
+            }
+        }
+        CHECK(worst < TRACK_TOLERANCE);
+    }
+
+    ReadEverything(data);
+}
+
+void TestTruncated(const Data& data)
+{
+    // Cut short without the header agreeing
+    CHECK(Throws([&]() { CompiledAsset::View(data.data(), data.size() - 1); }));
+    CHECK(Throws([&]() { CompiledAsset::View(data.data(), sizeof(CompiledAsset::Header) - 1); }));
+    CHECK(Throws([&]() { CompiledAsset::View(data.data(), 0); }));
+
+    // Cut short with the header rewritten to match, so the sections past the end are what throws
+    for (size_t size : {sizeof(CompiledAsset::Header), data.size() / 4, data.size() / 2, data.size() - 4})
+    {
+        auto truncated = Damaged<CompiledAsset::Header>(data, 0, [&](auto& header) { header.fileSize = uint32_t(size); });
+        truncated.resize(size);
+        CHECK(Throws([&]() { ReadEverything(truncated); }));
+    }
+}
+
+void TestHeader(const Data& data)
+{
+    auto magic = Damaged<CompiledAsset::Header>(data, 0, [](auto& header) { header.magic = 0x46424c47; });
+    CHECK(Throws([&]() { CompiledAsset::View(magic.data(), magic.size()); }));
+
+    for (uint32_t version : {CompiledAsset::VERSION - 1, CompiledAsset::VERSION + 1})
+    {
+        auto wrongVersion = Damaged<CompiledAsset::Header>(data, 0, [&](auto& header) { header.version = version; });
+        std::string message;
+        try
+        {
+            CompiledAsset::View(wrongVersion.data(), wrongVersion.size());
+        }
+        catch (const std::runtime_error& e)
+        {
+            message = e.what();
+        }
+        CHECK(message.find("recompile") != std::string::npos);
+    }
+}
+
+void TestOutOfRange(const Data& data)
+{
+    auto header = GetHeader(data);
+    auto size = uint32_t(data.size());
+
+    // Header offsets and counts
+    const std::vector<std::function<void(CompiledAsset::Header&)>> headerEdits = {
+        [&](auto& h) { h.jointOffset = size; },
+        [&](auto& h) { h.jointOffset = 0xfffffffc; },
+        [&](auto& h) { h.jointOffset += 2; },
+        [&](auto& h) { h.jointCount = 0xffffffff; },
+        [&](auto& h) { h.boneCount = 0; },
+        [&](auto& h) { h.clipOffset = size - 4; },
+        [&](auto& h) { h.clipCount += 1000; },
+        [&](auto& h) { h.meshOffset = size + 4; },
+        [&](auto& h) { h.meshCount = 0x80000000; },
+        [&](auto& h) { h.textureOffset = size + 4; },
+    };
+    for (const auto& edit : headerEdits)
+    {
+        auto damaged = Damaged<CompiledAsset::Header>(data, 0, edit);
+        CHECK(Throws([&]() { ReadEverything(damaged); }));
+    }
+
+    // A joint before its parent or in a slot past the bone matrices
+    auto joint = header.jointOffset + 3 * sizeof(CompiledAsset::JointRecord);
+    auto ownParent = Damaged<CompiledAsset::JointRecord>(data, joint, [](auto& record) { record.parent = 3; });
+    CHECK(Throws([&]() { ReadEverything(ownParent); }));
+    auto laterParent = Damaged<CompiledAsset::JointRecord>(data, joint, [](auto& record) { record.parent = 7; });
+    CHECK(Throws([&]() { ReadEverything(laterParent); }));
+    auto slot = Damaged<CompiledAsset::JointRecord>(data, joint, [&](auto& record) { record.boneSlot = header.boneCount; });
+    CHECK(Throws([&]() { ReadEverything(slot); }));
+
+    // Clip and track records
+    auto clip = GetClip(data, 1);
+    auto clipOffset = header.clipOffset + sizeof(CompiledAsset::ClipRecord);
+    const std::vector<std::function<void(CompiledAsset::ClipRecord&)>> clipEdits = {
+        [&](auto& record) { record.trackOffset = size; },
+        [&](auto& record) { record.trackOffset += 1; },
+        [&](auto& record) { record.trackCount = 0xffffffff; },
+    };
+    for (const auto& edit : clipEdits)
+    {
+        auto damaged = Damaged<CompiledAsset::ClipRecord>(data, clipOffset, edit);
+        CHECK(Throws([&]() { ReadEverything(damaged); }));
+    }
+
+    auto track = clip.trackOffset + 5 * sizeof(CompiledAsset::TrackRecord);
+    const std::vector<std::function<void(CompiledAsset::TrackRecord&)>> trackEdits = {
+        [&](auto& record) { record.joint = header.jointCount; },
+        [&](auto& record) { record.joint = CompiledAsset::NONE; },
+        [&](auto& record) { record.positionOffset = size; },
+        [&](auto& record) { record.rotationOffset = size - 4; },
+        [&](auto& record) { record.rotationCount = 0x40000000; },
+        [&](auto& record) { record.scaleOffset += 2; },
+        // Every track needs at least one keyframe of each kind
+        [&](auto& record) { record.positionCount = 0; },
+    };
+    for (const auto& edit : trackEdits)
+    {
+        auto damaged = Damaged<CompiledAsset::TrackRecord>(data, track, edit);
+        CHECK(Throws([&]() { ReadEverything(damaged); }));
+    }
+
+    // Mesh sections
+    const std::vector<std::function<void(CompiledAsset::MeshRecord&)>> meshEdits = {
+        [&](auto& record) { record.vertexOffset = size; },
+        [&](auto& record) { record.indexOffset = 0xfffffffc; },
+        [&](auto& record) { record.influenceOffset = size - 4; },
+    };
+    for (const auto& edit : meshEdits)
+    {
+        auto damaged = Damaged<CompiledAsset::MeshRecord>(data, header.meshOffset, edit);
+        CHECK(Throws([&]() { ReadEverything(damaged); }));
+    }
+}
+
+int main()
+{
+    auto scene = MakeFixtureScene();
+
+    AssetCompiler::Options options;
+    options.compressTextures = false;
+    auto data = AssetCompiler::Compile(scene, ".", options);
+
+    TestRoundTrip(scene, data);
+    TestTruncated(data);
+    TestHeader(data);
+    TestOutOfRange(data);
+
+    return HostTest::Result();
+}
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "fixture_scene.h"
+
+const aiScene* MakeFixtureScene()
+{
+    auto mesh = new aiMesh();
+    mesh->mName.Set("tube");
+    mesh->mNumVertices = unsigned(FIXTURE_RINGS * FIXTURE_SEGMENTS);
+    mesh->mVertices = new aiVector3D[mesh->mNumVertices];
+    mesh->mNormals = new aiVector3D[mesh->mNumVertices];
+    for (size_t ring = 0; ring < FIXTURE_RINGS; ring++)
+    {
+        for (size_t segment = 0; segment < FIXTURE_SEGMENTS; segment++)
+        {
+            float angle = 2.0f * float(M_PI) * segment / FIXTURE_SEGMENTS;
+            float y = FIXTURE_HEIGHT * ring / (FIXTURE_RINGS - 1);
+            mesh->mVertices[ring * FIXTURE_SEGMENTS + segment] = aiVector3D(FIXTURE_RADIUS * std::cos(angle), y, FIXTURE_RADIUS * std::sin(angle));
+            mesh->mNormals[ring * FIXTURE_SEGMENTS + segment] = aiVector3D(std::cos(angle), 0.0f, std::sin(angle));
+        }
+    }
+
+    mesh->mNumFaces = unsigned((FIXTURE_RINGS - 1) * FIXTURE_SEGMENTS * 2);
+    mesh->mFaces = new aiFace[mesh->mNumFaces];
+    auto indices = new unsigned int[mesh->mNumFaces * 3];
+    for (size_t ring = 0, face = 0; ring + 1 < FIXTURE_RINGS; ring++)
+    {
+        for (size_t segment = 0; segment < FIXTURE_SEGMENTS; segment++)
+        {
+            unsigned a = unsigned(ring * FIXTURE_SEGMENTS + segment);
+            unsigned b = unsigned(ring * FIXTURE_SEGMENTS + (segment + 1) % FIXTURE_SEGMENTS);
+            unsigned quad[6] = {a, b, unsigned(a + FIXTURE_SEGMENTS), b, unsigned(b + FIXTURE_SEGMENTS), unsigned(a + FIXTURE_SEGMENTS)};
+
+            for (size_t triangle = 0; triangle < 2; triangle++, face++)
+            {
+                std::copy(quad + triangle * 3, quad + triangle * 3 + 3, indices + face * 3);
+                mesh->mFaces[face].mNumIndices = 3;
+                mesh->mFaces[face].mIndices = indices + face * 3;
+            }
+        }
+    }
+
+    // A chain of bones up the tube, every ring is weighted between the two nearest ones
+    float boneSpacing = FIXTURE_HEIGHT / FIXTURE_BONES;
+    std::vector<std::vector<aiVertexWeight>> weights(FIXTURE_BONES);
+    for (size_t ring = 0; ring < FIXTURE_RINGS; ring++)
+    {
+        float position = FIXTURE_HEIGHT * ring / (FIXTURE_RINGS - 1) / boneSpacing;
+        size_t lower = std::min(size_t(position), FIXTURE_BONES - 1);
+        size_t upper = std::min(lower + 1, FIXTURE_BONES - 1);
+        float blend = upper == lower ? 0.0f : position - lower;
+
+        for (size_t segment = 0; segment < FIXTURE_SEGMENTS; segment++)
+        {
+            unsigned vertex = unsigned(ring * FIXTURE_SEGMENTS + segment);
+            weights[lower].push_back(aiVertexWeight{vertex, 1.0f - blend});
+            if (upper != lower) weights[upper].push_back(aiVertexWeight{vertex, blend});
+        }
+    }
+
+    mesh->mNumBones = unsigned(FIXTURE_BONES);
+    mesh->mBones = new aiBone*[FIXTURE_BONES];
+    for (size_t i = 0; i < FIXTURE_BONES; i++)
+    {
+        auto bone = new aiBone();
+        bone->mName.Set("bone" + std::to_string(i));
+        bone->mNumWeights = unsigned(weights[i].size());
+        bone->mWeights = new aiVertexWeight[weights[i].size()];
+        std::copy(weights[i].begin(), weights[i].end(), bone->mWeights);
+        aiMatrix4x4::Translation(aiVector3D(0.0f, -boneSpacing * i, 0.0f), bone->mOffsetMatrix);
+        mesh->mBones[i] = bone;
+    }
+
+    // The root holds the mesh, each bone is a child of the previous one
+    auto root = new aiNode();
+    root->mName.Set("root");
+    root->mNumMeshes = 1;
+    root->mMeshes = new unsigned int[1]{0};
+
+    aiNode* parent = root;
+    for (size_t i = 0; i < FIXTURE_BONES; i++)
+    {
+        auto node = new aiNode();
+        node->mName.Set("bone" + std::to_string(i));
+        aiMatrix4x4::Translation(aiVector3D(0.0f, i == 0 ? 0.0f : boneSpacing, 0.0f), node->mTransformation);
+        node->mParent = parent;
+        parent->mNumChildren = 1;
+        parent->mChildren = new aiNode*[1]{node};
+        parent = node;
+    }
+
+    // Swaying clips, with a different key count for each so that resampling has to interpolate
+    const char* clipNames[] = {"sway", "idle"};
+    const float amplitudes[] = {0.3f, 0.05f};
+    const double durations[] = {60.0, 90.0};
+
+    auto scene = new aiScene();
+    scene->mRootNode = root;
+    scene->mNumMeshes = 1;
+    scene->mMeshes = new aiMesh*[1]{mesh};
+    scene->mNumMaterials = 1;
+    scene->mMaterials = new aiMaterial*[1]{new aiMaterial()};
+    scene->mNumAnimations = 2;
+    scene->mAnimations = new aiAnimation*[2];
+
+    for (size_t clip = 0; clip < 2; clip++)
+    {
+        auto animation = new aiAnimation();
+        animation->mName.Set(clipNames[clip]);
+        animation->mDuration = durations[clip];
+        animation->mTicksPerSecond = 30.0;
+        animation->mNumChannels = unsigned(FIXTURE_BONES);
+        animation->mChannels = new aiNodeAnim*[FIXTURE_BONES];
+
+        for (size_t i = 0; i < FIXTURE_BONES; i++)
+        {
+            auto channel = new aiNodeAnim();
+            channel->mNodeName.Set("bone" + std::to_string(i));
+            channel->mNumPositionKeys = 1;
+            channel->mPositionKeys = new aiVectorKey[1]{aiVectorKey{0.0, aiVector3D(0.0f, i == 0 ? 0.0f : boneSpacing, 0.0f)}};
+            channel->mNumScalingKeys = 1;
+            channel->mScalingKeys = new aiVectorKey[1]{aiVectorKey{0.0, aiVector3D(1.0f, 1.0f, 1.0f)}};
+
+            size_t keyCount = FIXTURE_KEYS - clip * 10;
+            channel->mNumRotationKeys = unsigned(keyCount);
+            channel->mRotationKeys = new aiQuatKey[keyCount];
+            for (size_t k = 0; k < keyCount; k++)
+            {
+                double time = durations[clip] * k / (keyCount - 1);
+                // Around the Z axis
+                float halfAngle = amplitudes[clip] * std::sin(float(2.0 * M_PI * time / durations[clip]) + 0.3f * i) / 2.0f;
+                channel->mRotationKeys[k] = aiQuatKey{time, aiQuaternion(std::cos(halfAngle), 0.0f, 0.0f, std::sin(halfAngle))};
+            }
+
+            animation->mChannels[i] = channel;
+        }
+
+        scene->mAnimations[clip] = animation;
+    }
+
+    return scene;
+}
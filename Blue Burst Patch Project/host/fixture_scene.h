@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <assimp/scene.h>
+
+/**
+ * A generated model about the size of an enemy, for the host tools that need one without a model file:
+ * a tube with a chain of bones up its middle and two clips that sway the bones around the Z axis.
+ */
+
+const size_t FIXTURE_RINGS = 64;
+const size_t FIXTURE_SEGMENTS = 32;
+const size_t FIXTURE_BONES = 24;
+const float FIXTURE_HEIGHT = 24.0f;
+const float FIXTURE_RADIUS = 2.0f;
+/// Rotation keys of the first clip, the second one has 10 fewer
+const size_t FIXTURE_KEYS = 31;
+
+/**
+ * @brief Builds the scene that the fixture is compiled from.
+ * The scene and its arrays are never freed, assimp's destructors would free the arrays that the scene doesn't own.
+ */
+const aiScene* MakeFixtureScene();
@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "hooking.h"
+
+/**
+ * Compares the cost of running a hook's callbacks once, which afterSceneUpdate does every frame,
+ * between the map lookup and std::function copies that Hook::CallHookCallbacks used to do
+ * and the frozen dispatch tables, with 1, 16 and 128 callbacks.
+ */
+
+const size_t RUNS = 200000;
+
+/// Addresses in the simulated image. The patched in calls are never executed.
+const size_t SMALL_HOOK = 0x00401000;
+const size_t MEDIUM_HOOK = 0x00402000;
+const size_t LARGE_HOOK = 0x00403000;
+
+uint64_t calls = 0;
+
+/// What Hook kept per address before the dispatch tables
+std::unordered_map<size_t, std::vector<Hooking::HookFn>> oldHooks;
+
+/// The dispatch that Hook::CallHookCallbacks did before the dispatch tables
+template<size_t addr>
+void __cdecl OldCallHookCallbacks()
+{
+    if (auto it = oldHooks.find(addr); it != oldHooks.end())
+        for (auto cb : (*it).second) cb();
+}
+
+void __cdecl CountCall(void* context)
+{
+    (*static_cast<uint64_t*>(context))++;
+}
+
+template<typename F>
+double NanosecondsPerRun(F run)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < RUNS; i++)
+    {
+        run();
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RUNS;
+}
+
+template<size_t addr>
+void Measure(size_t callbackCount)
+{
+    // Both kinds of callbacks on the new dispatch: raw functions, and std::function through a thunk
+    auto& raw = Hooking::CreateHook<addr, addr + 5>();
+    auto& wrapped = Hooking::CreateHook<addr + 0x800, addr + 0x805>();
+    for (size_t i = 0; i < callbackCount; i++)
+    {
+        oldHooks[addr].push_back([]() { calls++; });
+        raw.AddCallback(CountCall, &calls);
+        wrapped.AddCallback([]() { calls++; });
+    }
+    Hooking::InstallAllHooks();
+
+    double before = NanosecondsPerRun(OldCallHookCallbacks<addr>);
+    double afterRaw = NanosecondsPerRun([&raw]() { raw.Run(); });
+    double afterWrapped = NanosecondsPerRun([&wrapped]() { wrapped.Run(); });
+
+    printf("%3zu callbacks: before %8.1f ns, after %8.1f ns (RawHookFn) %8.1f ns (std::function)\n",
+        callbackCount, before, afterRaw, afterWrapped);
+}
+
+int main()
+{
+    // Callbacks can't be added to an installed hook, so each size gets its own addresses
+    Measure<SMALL_HOOK>(1);
+    Measure<MEDIUM_HOOK>(16);
+    Measure<LARGE_HOOK>(128);
+
+    // Keeps the callbacks from being optimized away
+    printf("%llu calls\n", (unsigned long long) calls);
+    return 0;
+}
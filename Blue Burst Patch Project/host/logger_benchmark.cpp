@@ -0,0 +1,83 @@
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <ctime>
+#include <cwchar>
+#include <filesystem>
+#include "logger.h"
+
+/**
+ * Prints how long Log() takes on the calling thread and how many messages per second the writer formats and writes,
+ * next to the Log() that opened, wrote and closed the file for every message.
+ * Writes into log/dll.log in the working directory like the game does.
+ */
+
+/// Stays below the queue capacity so that no message is dropped while measuring the caller
+const size_t BURST = Logging::QUEUE_CAPACITY / 2;
+const size_t BURSTS = 200;
+const size_t SYNCHRONOUS_MESSAGES = 2000;
+
+/// What Log() did before the queue, with the C library instead of the Windows specific functions
+void SynchronousLog(const wchar_t* fmt, ...)
+{
+    FILE* fp = fopen("log/dll.log", "a");
+    if (fp == nullptr) return;
+
+    wchar_t text[4096];
+    va_list args;
+    va_start(args, fmt);
+    vswprintf(text, sizeof(text) / sizeof(wchar_t), fmt, args);
+    va_end(args);
+
+    time_t now = time(nullptr);
+    tm local = *localtime(&now);
+    fwprintf(fp, L"[%02u-%02u-%u, %02u:%02u:%02u] %ls\n",
+        local.tm_mon + 1, local.tm_mday, local.tm_year + 1900, local.tm_hour, local.tm_min, local.tm_sec, text);
+    fclose(fp);
+}
+
+double ElapsedNs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    std::filesystem::create_directories("log");
+
+    // Starts the writer thread outside of the measurements
+    Log(L"logger_benchmark: start");
+    Logging::Flush();
+
+    // Each burst is timed on the calling thread and then written with Flush, which does what the writer thread does
+    uint32_t droppedBefore = Logging::DroppedCount();
+    double callerNs = 0.0;
+    double writerNs = 0.0;
+    for (size_t burst = 0; burst < BURSTS; burst++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < BURST; i++)
+        {
+            Log(L"Entity %d at (%.2f, %.2f) in %s", (int) i, 1.5f * i, -2.0f * i, L"Forest 1");
+        }
+        callerNs += ElapsedNs(start);
+
+        start = std::chrono::steady_clock::now();
+        Logging::Flush();
+        writerNs += ElapsedNs(start);
+    }
+
+    size_t messages = BURST * BURSTS;
+    printf("Log:             %8.1f ns per message on the calling thread\n", callerNs / messages);
+    printf("Writer:          %8.0f messages/s formatted and written, %u dropped\n",
+        messages / (writerNs / 1e9), Logging::DroppedCount() - droppedBefore);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < SYNCHRONOUS_MESSAGES; i++)
+    {
+        SynchronousLog(L"Entity %d at (%.2f, %.2f) in %ls", (int) i, 1.5f * i, -2.0f * i, L"Forest 1");
+    }
+    printf("Synchronous Log: %8.1f ns per message on the calling thread\n", ElapsedNs(start) / SYNCHRONOUS_MESSAGES);
+
+    return 0;
+}
@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <assimp/scene.h>
+#include "newgfx/asset_compiler.h"
+#include "newgfx/compiled_asset.h"
+#include "newgfx/mesh.h"
+#include "newgfx/model_asset.h"
+#include "newgfx/skeleton.h"
+#include "newgfx/skinning.h"
+#include "newgfx/texture_pipeline.h"
+#include "fixture_scene.h"
+#include "profile_report.h"
+
+/**
+ * Times the CPU work newgfx does for every animated model: loading a compiled asset, evaluating the skeleton,
+ * building the palette and skinning into a vertex buffer, plus the texture pipeline. The results are written
+ * in the profiler's report format and compared with a baseline, which is a report from an earlier run.
+ *
+ * Usage: newgfx_benchmark [--report <file>] [--baseline <file>] [compiled model...]
+ * Without models a generated fixture is used: a tube with a chain of bones and two clips, about the size of an enemy.
+ * Exits with 1 when anything regressed. Only compare reports from the same machine.
+ */
+
+const char* DEFAULT_REPORT_PATH = "newgfx_benchmark.json";
+
+/// Timed calls per benchmark
+const size_t SAMPLE_COUNT = 200;
+/// Models animated per frame, each at its own point of the clip
+const size_t INSTANCE_COUNT = 32;
+
+const size_t TEXTURE_SIZE = 256;
+
+std::vector<ProfileReport::Entry> entries;
+
+/// Calls f SAMPLE_COUNT times and records its durations as an entry
+template<typename F>
+void Measure(const std::string& name, F f)
+{
+    std::vector<double> samples;
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    // Same percentiles as Profiler::Histogram
+    std::sort(samples.begin(), samples.end());
+    ProfileReport::Entry entry = {name, samples.size(),
+        samples[(samples.size() - 1) * 50 / 100], samples[(samples.size() - 1) * 99 / 100], samples.back()};
+    entries.push_back(entry);
+
+    printf("%-50s p50 %10.2f us  p99 %10.2f us\n", name.c_str(), entry.p50, entry.p99);
+}
+
+/// Something for the benchmarks to write to so that the work is not optimized away
+volatile float sink;
+
+/// Options for a quick compile, the mips are box filtered and the textures stay uncompressed
+AssetCompiler::Options LoadTimeOptions()
+{
+    AssetCompiler::Options options;
+    options.mipFilter = TexturePipeline::MipFilter::Box;
+    options.compressTextures = false;
+    return options;
+}
+
+struct LoadedMesh
+{
+    std::vector<Vertex> vertices;
+    std::vector<Skinning::VertexInfluences> influences;
+};
+
+/// Benchmarks a compiled asset the way ModelAsset reads it and AnimationInstance plays it
+void MeasureModel(const std::string& name, const std::vector<uint8_t>& data)
+{
+    CompiledAsset::View view(data.data(), data.size());
+    const auto& header = view.GetHeader();
+    auto clipRecords = view.Array<CompiledAsset::ClipRecord>(header.clipOffset, header.clipCount);
+
+    Measure(name + ": CompiledAsset::ReadTracks", [&]() {
+        for (size_t i = 0; i < header.clipCount; i++)
+        {
+            std::vector<size_t> jointChannels;
+            sink = float(CompiledAsset::ReadTracks(view, clipRecords[i], jointChannels).size());
+        }
+    });
+
+    Skeleton skeleton(CompiledAsset::ReadJoints(view));
+    std::vector<size_t> jointChannels;
+    auto bones = CompiledAsset::ReadTracks(view, clipRecords[0], jointChannels);
+    float ticksPerFrame = clipRecords[0].ticksPerSecond * DELTA_TIME;
+
+    std::vector<LoadedMesh> meshes;
+    auto meshRecords = view.Array<CompiledAsset::MeshRecord>(header.meshOffset, header.meshCount);
+    for (size_t i = 0; i < header.meshCount; i++)
+    {
+        const auto& record = meshRecords[i];
+        if (record.influenceOffset == CompiledAsset::NONE) continue;
+
+        auto vertices = view.Array<Vertex>(record.vertexOffset, record.vertexCount);
+        auto influences = view.Array<Skinning::VertexInfluences>(record.influenceOffset, record.vertexCount);
+        meshes.push_back(LoadedMesh{
+            std::vector<Vertex>(vertices, vertices + record.vertexCount),
+            std::vector<Skinning::VertexInfluences>(influences, influences + record.vertexCount)});
+    }
+
+    // Each instance keeps its own cursors and time like an AnimationInstance
+    std::vector<std::vector<KeyframeCursor>> cursors(INSTANCE_COUNT, std::vector<KeyframeCursor>(bones.size()));
+    std::vector<float> times(INSTANCE_COUNT);
+    for (size_t i = 0; i < INSTANCE_COUNT; i++)
+    {
+        times[i] = std::fmod(clipRecords[0].duration * i / INSTANCE_COUNT, clipRecords[0].duration);
+    }
+
+    std::vector<aiMatrix4x4> globalTransforms;
+    std::vector<aiMatrix4x4> finalBoneMatrices(header.boneCount);
+    std::vector<Skinning::PaletteMatrix> palette;
+
+    Measure(name + ": Skeleton::Evaluate x" + std::to_string(INSTANCE_COUNT), [&]() {
+        for (size_t i = 0; i < INSTANCE_COUNT; i++)
+        {
+            skeleton.Evaluate(jointChannels, bones, cursors[i], times[i], globalTransforms, finalBoneMatrices);
+            times[i] = std::fmod(times[i] + ticksPerFrame, clipRecords[0].duration);
+        }
+    });
+
+    Measure(name + ": Skinning::BuildPalette x" + std::to_string(INSTANCE_COUNT), [&]() {
+        for (size_t i = 0; i < INSTANCE_COUNT; i++)
+        {
+            Skinning::BuildPalette(finalBoneMatrices, palette);
+        }
+    });
+
+    // Stands in for the memory that locking a dynamic vertex buffer with D3DLOCK_DISCARD hands out
+    size_t largestMesh = 0;
+    for (const auto& mesh : meshes) largestMesh = std::max(largestMesh, mesh.vertices.size());
+    std::vector<Vertex> fakeVertexBuffer(largestMesh);
+
+    Measure(name + ": Skinning::SkinVertices x" + std::to_string(INSTANCE_COUNT), [&]() {
+        for (size_t i = 0; i < INSTANCE_COUNT; i++)
+        {
+            for (const auto& mesh : meshes)
+            {
+                Skinning::SkinVertices(mesh.vertices.data(), mesh.influences.data(), mesh.vertices.size(), palette.data(), fakeVertexBuffer.data());
+            }
+        }
+        sink = fakeVertexBuffer.empty() ? 0.0f : fakeVertexBuffer[0].position.x;
+    });
+}
+
+void MeasureTexturePipeline()
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> channel(0, 255);
+
+    TexturePipeline::Image image = {TEXTURE_SIZE, TEXTURE_SIZE, std::vector<uint8_t>(TEXTURE_SIZE * TEXTURE_SIZE * TexturePipeline::CHANNEL_COUNT)};
+    for (auto& value : image.pixels) value = uint8_t(channel(rng));
+    std::vector<uint8_t> swapped(image.pixels.size());
+
+    auto size = std::to_string(TEXTURE_SIZE) + "x" + std::to_string(TEXTURE_SIZE);
+
+    Measure("TexturePipeline::SwapRedBlue " + size, [&]() {
+        TexturePipeline::SwapRedBlue(image.pixels.data(), swapped.data(), TEXTURE_SIZE * TEXTURE_SIZE);
+    });
+
+    Measure("TexturePipeline::BuildMipChain Box " + size, [&]() {
+        sink = float(TexturePipeline::BuildMipChain(image, TexturePipeline::MipFilter::Box).size());
+    });
+
+    Measure("TexturePipeline::BuildMipChain Kaiser " + size, [&]() {
+        sink = float(TexturePipeline::BuildMipChain(image, TexturePipeline::MipFilter::Kaiser).size());
+    });
+
+    Measure("TexturePipeline::Compress DXT1 " + size, [&]() {
+        sink = float(TexturePipeline::Compress(image, TexturePipeline::Format::Dxt1).size());
+    });
+}
+
+int main(int argc, char** argv)
+{
+    std::string reportPath = DEFAULT_REPORT_PATH;
+    std::string baselinePath;
+    std::vector<std::string> models;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) reportPath = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baselinePath = argv[++i];
+        else models.push_back(argv[i]);
+    }
+
+    try
+    {
+        if (models.empty())
+        {
+            auto scene = MakeFixtureScene();
+            std::vector<uint8_t> fixture;
+
+            Measure("fixture: AssetCompiler::Compile", [&]() {
+                fixture = AssetCompiler::Compile(scene, ".", LoadTimeOptions());
+            });
+
+            MeasureModel("fixture", fixture);
+        }
+
+        for (const auto& path : models)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file.is_open()) throw std::runtime_error("Could not open " + path);
+
+            std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            MeasureModel(path, data);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 2;
+    }
+
+    MeasureTexturePipeline();
+
+    if (!ProfileReport::Write(reportPath.c_str(), entries))
+    {
+        fprintf(stderr, "Could not write %s\n", reportPath.c_str());
+        return 2;
+    }
+    printf("Wrote %s\n", reportPath.c_str());
+
+    if (baselinePath.empty()) return 0;
+
+    std::map<std::string, ProfileReport::BaselineEntry> baseline;
+    if (!ProfileReport::ReadBaseline(baselinePath.c_str(), baseline))
+    {
+        fprintf(stderr, "Could not read %s\n", baselinePath.c_str());
+        return 2;
+    }
+
+    auto regressions = ProfileReport::FindRegressions(entries, baseline);
+    for (const auto& regression : regressions)
+    {
+        printf("%s regressed, p50 %.2f us, baseline %.2f us, limit %.2f us\n",
+            regression.name.c_str(), regression.p50, regression.baseline, regression.limit);
+    }
+    printf("%zu regressions against %s\n", regressions.size(), baselinePath.c_str());
+
+    return regressions.empty() ? 0 : 1;
+}
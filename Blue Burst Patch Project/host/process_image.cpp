@@ -0,0 +1,89 @@
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <sys/mman.h>
+#include "battleparam.h"
+#include "customize_menu.h"
+#include "object_extension.h"
+#include "process_image.h"
+
+namespace Host
+{
+    /// Function-local so that it can be used before dynamic initialization has run
+    std::map<std::string, std::vector<uint8_t>>& ParamFiles()
+    {
+        static std::map<std::string, std::vector<uint8_t>> files;
+        return files;
+    }
+
+    uint8_t* __thiscall GetParamFileDataStub(void*, char* filename)
+    {
+        auto found = ParamFiles().find(filename);
+        return found != ParamFiles().end() ? found->second.data() : nullptr;
+    }
+
+    size_t __thiscall GetParamFileSizeStub(void*, char* filename)
+    {
+        auto found = ParamFiles().find(filename);
+        return found != ParamFiles().end() ? found->second.size() : 0;
+    }
+
+    void* __cdecl MainArenaAllocStub(size_t size)
+    {
+        return malloc(size);
+    }
+
+    void __cdecl MainArenaDeallocStub(void* node)
+    {
+        free(node);
+    }
+
+    /// Values that are read during static initialization
+    void SeedImage()
+    {
+        // The original customize menu action lists, left empty
+        CustomizeMenu::ActionListEntry terminator;
+        memset(&terminator, 0, sizeof(terminator));
+        terminator.actionCategory = CustomizeMenu::ActionCategory::ListTerminator;
+        At<CustomizeMenu::ActionListEntry>(0x009737e0) = terminator;
+        At<CustomizeMenu::ActionListEntry>(0x00973880) = terminator;
+    }
+
+    /// Must run after dynamic initialization, which is what assigns the game addresses to these pointers
+    void RedirectGameFunctions()
+    {
+        BattleParam::GetParamFileData = GetParamFileDataStub;
+        BattleParam::GetParamFileSize = GetParamFileSizeStub;
+        MainArenaAlloc = MainArenaAllocStub;
+        MainArenaDealloc = MainArenaDeallocStub;
+    }
+
+    /// Runs before the static initializers of every other translation unit
+    __attribute__((constructor(101))) void MapProcessImage()
+    {
+        void* image = mmap((void*) IMAGE_BASE, IMAGE_END - IMAGE_BASE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+        // Only possible if something else is loaded there, e.g. the executable was not built as PIE
+        if (image != (void*) IMAGE_BASE)
+        {
+            throw std::runtime_error("Host: Could not map the simulated process image");
+        }
+
+        SeedImage();
+    }
+
+    void ResetProcessImage()
+    {
+        // Private anonymous pages read back as zero after this
+        madvise((void*) IMAGE_BASE, IMAGE_END - IMAGE_BASE, MADV_DONTNEED);
+        SeedImage();
+        RedirectGameFunctions();
+    }
+
+    void SetParamFile(const std::string& filename, const std::vector<uint8_t>& data)
+    {
+        ParamFiles()[filename] = data;
+    }
+};
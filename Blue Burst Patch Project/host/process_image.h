@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Stand-in for psobb.exe when the pure-logic modules are built for the host.
+ * The address range of the game's image is mapped as zeroed memory before any static initializer runs,
+ * so the hardcoded addresses all over the patch point at something valid.
+ * Game functions that those modules call are redirected to stubs, the rest stay pointing into
+ * the image which is not executable, so calling one crashes at the game address.
+ *
+ * The image is not a copy of the real one. Pointers stored in it are host sized.
+ */
+namespace Host
+{
+    const size_t IMAGE_BASE = 0x00400000;
+    const size_t IMAGE_END = 0x01000000;
+
+    /// Access a value in the image by its game address
+    template<typename T>
+    T& At(size_t addr)
+    {
+        return *reinterpret_cast<T*>(addr);
+    }
+
+    /**
+     * @brief Zeroes the image, writes back the values the modules read during startup and redirects game functions to the stubs.
+     * Must be called before using any of the modules.
+     */
+    void ResetProcessImage();
+
+    /// Returned by the game's param file store (BattleParamEntry.dat etc.) instead of reading the game's archives
+    void SetParamFile(const std::string& filename, const std::vector<uint8_t>& data);
+};
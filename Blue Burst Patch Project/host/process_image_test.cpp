@@ -0,0 +1,286 @@
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "battleparam.h"
+#include "customize_menu.h"
+#include "enemy.h"
+#include "initlist.h"
+#include "map.h"
+#include "omnispawn.h"
+#include "patching.h"
+#include "process_image.h"
+#include "test.h"
+
+/**
+ * Runs the startup patches' list rewriting and the battle param lookups against the simulated process image.
+ * Game state is set up by writing into the image at the addresses the modules read it from.
+ * The patch journal is only committed once per process, so every module queues its writes first
+ * and the results are checked after the commit at the end of main.
+ */
+
+using BattleParam::BPEntryType;
+using Enemy::NpcType;
+using Enemy::TaggedEnemyConstructor;
+using Omnispawn::NewBPIndex;
+
+/// Not used by the game, lists that the tests make up are put here
+const size_t SCRATCH = 0x00f00000;
+
+/// See common.cpp
+const size_t CURRENT_EPISODE = 0x00a9b1c8;
+const size_t SOLO_MODE = 0x00a9b1c4;
+const size_t CURRENT_DIFFICULTY = 0x00a9b1cc;
+/// See battleparam.cpp
+const size_t LOADED_BP = 0x00a9b1e0;
+const size_t BP_FILENAMES = 0x009f7dec;
+/// See enemy.cpp and map.cpp
+const size_t MAP_ENEMY_TABLE = 0x009fba60;
+const size_t MAP_INIT_LISTS = 0x009fcae0;
+/// Code that refers to the fleshie action list, see customize_menu.cpp
+const size_t FLESHIE_ACTION_LIST_REF = 0x0074a2b1;
+
+void __cdecl InitA() {}
+void __cdecl UninitA() {}
+void __cdecl InitB() {}
+void __cdecl InitC() {}
+void __cdecl InitD() {}
+
+/// Sized initlists are rewritten in order with their size references updated
+struct SizedInitListCase
+{
+    InitList::FunctionPair* original = reinterpret_cast<InitList::FunctionPair*>(SCRATCH);
+    size_t listRef = SCRATCH + 0x100;
+    size_t sizeRef = SCRATCH + 0x110;
+
+    void Queue()
+    {
+        original[0] = InitList::FunctionPair(InitA, UninitA);
+        original[1] = InitList::FunctionPair(InitB, nullptr);
+        Host::At<InitList::FunctionPair*>(listRef) = original;
+        Host::At<uint8_t>(sizeRef) = 2 * sizeof(InitList::FunctionPair);
+
+        InitList& list = InitList::GetInitList(original, original + 2);
+        CHECK(&InitList::GetInitList(original, original + 2) == &list);
+
+        list.AddListReferenceAddress(listRef);
+        list.AddSizeReferenceAddress(sizeRef);
+        // Already in the list, ignored
+        list.AddFunctionPair(InitList::FunctionPair(InitB, UninitA));
+        list.AddFunctionPair(InitList::FunctionPair(InitC, nullptr));
+        list.PrependFunctionPair(InitList::FunctionPair(InitD, nullptr));
+    }
+
+    void Check()
+    {
+        auto patched = Host::At<InitList::FunctionPair*>(listRef);
+        CHECK(patched != original);
+        CHECK(Host::At<uint8_t>(sizeRef) == 4 * sizeof(InitList::FunctionPair));
+        CHECK(patched[0].init == InitD);
+        CHECK(patched[1].init == InitA && patched[1].uninit == UninitA);
+        CHECK(patched[2].init == InitB && patched[2].uninit == nullptr);
+        CHECK(patched[3].init == InitC);
+
+        // The original list is left alone
+        CHECK(original[0].init == InitA && original[1].init == InitB);
+    }
+};
+
+/// Map initlists are null terminated and found through the table of every map's list
+struct MapInitListCase
+{
+    InitList::FunctionPair* original = reinterpret_cast<InitList::FunctionPair*>(SCRATCH + 0x200);
+
+    void Queue()
+    {
+        original[0] = InitList::FunctionPair(InitA, nullptr);
+        original[1] = InitList::FunctionPair(nullptr, nullptr);
+        Host::At<InitList::FunctionPair*>(MAP_INIT_LISTS + (size_t) Map::MapType::Forest1 * sizeof(void*)) = original;
+
+        Map::GetMapInitList(Map::MapType::Forest1).AddFunctionPair(InitList::FunctionPair(InitB, nullptr));
+    }
+
+    void Check()
+    {
+        auto patched = Host::At<InitList::FunctionPair*>(MAP_INIT_LISTS + (size_t) Map::MapType::Forest1 * sizeof(void*));
+        CHECK(patched != original);
+        CHECK(patched[0].init == InitA);
+        CHECK(patched[1].init == InitB);
+        CHECK(patched[2].init == nullptr && patched[2].uninit == nullptr);
+    }
+};
+
+/// Used enemy constructor lists are copied into a new list and written into the table
+struct EnemyConstructorListCase
+{
+    TaggedEnemyConstructor* pioneer2 = reinterpret_cast<TaggedEnemyConstructor*>(SCRATCH + 0x300);
+    TaggedEnemyConstructor* forest1 = reinterpret_cast<TaggedEnemyConstructor*>(SCRATCH + 0x400);
+    TaggedEnemyConstructor** table = reinterpret_cast<TaggedEnemyConstructor**>(MAP_ENEMY_TABLE);
+
+    static void* __cdecl ConstructBooma(Enemy::InitData::InnerData*) { return nullptr; }
+    static void* __cdecl ConstructHildebear(Enemy::InitData::InnerData*) { return nullptr; }
+
+    void Queue()
+    {
+        pioneer2[0] = TaggedEnemyConstructor(NpcType::ListTerminator, nullptr);
+        forest1[0] = TaggedEnemyConstructor(NpcType::Booma, ConstructBooma);
+        forest1[1] = TaggedEnemyConstructor(NpcType::ListTerminator, nullptr);
+        table[(size_t) Map::MapType::Pioneer2_Ep1] = pioneer2;
+        table[(size_t) Map::MapType::Forest1] = forest1;
+        table[(size_t) Map::MapType::Forest2] = nullptr;
+
+        auto& list = Enemy::GetEnemyConstructorList(Map::MapType::Forest1);
+        CHECK(list.size() == 1 && list[0].enemyType == NpcType::Booma);
+        CHECK(&Enemy::GetEnemyConstructorList(Map::MapType::Forest1) == &list);
+        list.push_back(TaggedEnemyConstructor(NpcType::Hildebear, ConstructHildebear));
+
+        CHECK(Enemy::FindEnemyConstructor(NpcType::Booma) == &forest1[0]);
+        CHECK(Enemy::FindEnemyConstructor(NpcType::Hildebear) == nullptr);
+
+        Enemy::PatchEnemyConstructorLists();
+    }
+
+    void Check()
+    {
+        auto patched = table[(size_t) Map::MapType::Forest1];
+        CHECK(patched != forest1);
+        CHECK(patched[0].enemyType == NpcType::Booma && patched[0].constructor == ConstructBooma);
+        CHECK(patched[1].enemyType == NpcType::Hildebear && patched[1].constructor == ConstructHildebear);
+        CHECK(patched[2].enemyType == NpcType::ListTerminator);
+        CHECK(Enemy::FindEnemyConstructor(NpcType::Hildebear) == &patched[1]);
+
+        // Lists that were never read are not rewritten
+        CHECK(table[(size_t) Map::MapType::Pioneer2_Ep1] == pioneer2);
+    }
+};
+
+CustomizeMenu::ActionListEntry Action(CustomizeMenu::ActionCategory category)
+{
+    CustomizeMenu::ActionListEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.actionCategory = category;
+    return entry;
+}
+
+void TestFixupActionList()
+{
+    using CustomizeMenu::ActionCategory;
+    auto attack = Action(ActionCategory::Attack);
+    auto terminator = Action(ActionCategory::ListTerminator);
+
+    CustomizeMenu::ActionList empty;
+    CustomizeMenu::FixupActionList(empty);
+    CHECK(empty.size() == 1 && empty[0].actionCategory == ActionCategory::ListTerminator);
+
+    // Padded to whole rows of 3 before the terminator
+    CustomizeMenu::ActionList unaligned(4, attack);
+    CustomizeMenu::FixupActionList(unaligned);
+    CHECK(unaligned.size() == 7);
+    CHECK(unaligned[3].actionCategory == ActionCategory::Attack);
+    CHECK(unaligned[4].actionCategory == ActionCategory::Blank && unaligned[5].actionCategory == ActionCategory::Blank);
+    CHECK(unaligned[6].actionCategory == ActionCategory::ListTerminator);
+
+    CustomizeMenu::ActionList terminatedUnaligned = {attack, attack, terminator};
+    CustomizeMenu::FixupActionList(terminatedUnaligned);
+    CHECK(terminatedUnaligned.size() == 4);
+    CHECK(terminatedUnaligned[2].actionCategory == ActionCategory::Blank);
+    CHECK(terminatedUnaligned[3].actionCategory == ActionCategory::ListTerminator);
+
+    CustomizeMenu::ActionList correct = {attack, attack, attack, terminator};
+    CustomizeMenu::FixupActionList(correct);
+    CHECK(correct.size() == 4 && correct[3].actionCategory == ActionCategory::ListTerminator);
+}
+
+/// The lists are read from the image during static initialization, which has them empty
+void TestActionListPatch()
+{
+    using CustomizeMenu::ActionCategory;
+
+    CHECK(CustomizeMenu::GetFleshieActionList().empty());
+    CustomizeMenu::GetFleshieActionList().push_back(Action(ActionCategory::Technique));
+    CustomizeMenu::ApplyActionListPatch();
+
+    auto patched = Host::At<CustomizeMenu::ActionListEntry*>(FLESHIE_ACTION_LIST_REF);
+    CHECK(patched[0].actionCategory == ActionCategory::Technique);
+    CHECK(patched[1].actionCategory == ActionCategory::Blank && patched[2].actionCategory == ActionCategory::Blank);
+    CHECK(patched[3].actionCategory == ActionCategory::ListTerminator);
+}
+
+void TestDecodeNewBpIndex()
+{
+    Host::At<Episode>(CURRENT_EPISODE) = Episode::Episode1;
+    CHECK(Omnispawn::DecodeNewBpIndex(NewBPIndex::Hildebear, BPEntryType::Stats) ==
+        (uint8_t) BattleParam::BPStatsIndex::ep1_Hildebear__ep2_Hildebear__ep4_None);
+    CHECK(Omnispawn::DecodeNewBpIndex(NewBPIndex::ZuCrater, BPEntryType::Attacks) ==
+        (uint8_t) BattleParam::BPAttacksIndex::ep1_Canadine__ep2_Gee__ep4_ZuCrater);
+
+    // Episode 2 has no Crater, Crater enemies get their Desert stats
+    Host::At<Episode>(CURRENT_EPISODE) = Episode::Episode2;
+    CHECK(Omnispawn::DecodeNewBpIndex(NewBPIndex::ZuCrater, BPEntryType::Attacks) ==
+        (uint8_t) BattleParam::BPAttacksIndex::ep1_Dubchic__ep2_Dubchic__ep4_ZuDesert);
+
+    bool threw = false;
+    try
+    {
+        Omnispawn::DecodeNewBpIndex(NewBPIndex(0xff), BPEntryType::Stats);
+    }
+    catch (const std::invalid_argument&)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+void TestGetBPEntry()
+{
+    Host::At<Episode>(CURRENT_EPISODE) = Episode::Episode1;
+    Host::At<bool>(SOLO_MODE) = false;
+    Host::At<Difficulty>(CURRENT_DIFFICULTY) = Difficulty::VeryHard;
+
+    // The current episode's entries come from the loaded difficulty
+    static BattleParam::BPDifficultyFile loaded;
+    Host::At<BattleParam::BPDifficultyFile*>(LOADED_BP) = &loaded;
+    CHECK(BattleParam::GetBPEntry(Episode::Episode1, false, 5, BPEntryType::Stats) == &loaded.stats[5]);
+    CHECK(BattleParam::GetBPEntry(Episode::Episode1, false, 5, BPEntryType::Animations) == &loaded.animations[5]);
+
+    // Other episodes are read from the game's param files, at the current difficulty
+    static char filename[] = "BattleParamEntry_lab_on.dat";
+    Host::At<char*>(BP_FILENAMES + ((size_t) Episode::Episode2 * 2 + 1) * sizeof(char*)) = filename;
+
+    std::vector<uint8_t> file(sizeof(BattleParam::BPFile));
+    auto bp = reinterpret_cast<BattleParam::BPFile*>(file.data());
+    bp->stats[(size_t) Difficulty::VeryHard][5].atp = 1234;
+    bp->attacks[(size_t) Difficulty::VeryHard][5].max_distance = 80.0f;
+    Host::SetParamFile(filename, file);
+
+    auto stats = static_cast<BattleParam::BPStatsEntry*>(BattleParam::GetBPEntry(Episode::Episode2, true, 5, BPEntryType::Stats));
+    auto attacks = static_cast<BattleParam::BPAttacksEntry*>(BattleParam::GetBPEntry(Episode::Episode2, true, 5, BPEntryType::Attacks));
+    CHECK(stats->atp == 1234);
+    CHECK(attacks->max_distance == 80.0f);
+}
+
+int main()
+{
+    Host::ResetProcessImage();
+
+    TestFixupActionList();
+    TestActionListPatch();
+    TestDecodeNewBpIndex();
+    TestGetBPEntry();
+
+    SizedInitListCase sizedInitList;
+    MapInitListCase mapInitList;
+    EnemyConstructorListCase enemyConstructorList;
+    sizedInitList.Queue();
+    mapInitList.Queue();
+    enemyConstructorList.Queue();
+
+    InitList::PatchAllInitLists();
+    Patching::CommitPatches();
+
+    sizedInitList.Check();
+    mapInitList.Check();
+    enemyConstructorList.Check();
+
+    return HostTest::Result();
+}
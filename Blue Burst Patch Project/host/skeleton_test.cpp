@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <assimp/anim.h>
+#include <assimp/scene.h>
+#include "newgfx/bone.h"
+#include "newgfx/skeleton.h"
+#include "test.h"
+
+/**
+ * Checks that Skeleton::Evaluate's forward loop over the flattened joints computes the same bone matrices,
+ * bit for bit, as the recursion over the node tree with name lookups that it replaced.
+ */
+
+const size_t NODE_COUNT = 60;
+const size_t TREE_COUNT = 20;
+const float DURATION = 40.0f;
+
+/// Owns the nodes and channels of a random tree, assimp's structures only point at them
+struct RandomTree
+{
+    std::vector<std::unique_ptr<aiNode>> nodes;
+    std::vector<std::vector<aiNode*>> children;
+    std::vector<std::unique_ptr<aiNodeAnim>> channels;
+    std::vector<std::vector<aiVectorKey>> positionKeys;
+    std::vector<std::vector<aiQuatKey>> rotationKeys;
+    std::vector<std::vector<aiVectorKey>> scaleKeys;
+    std::unordered_map<std::string, BoneInfo> boneInfoMap;
+    std::vector<Bone> bones;
+
+    ~RandomTree()
+    {
+        // assimp's destructors would free the arrays again
+        for (auto& node : nodes)
+        {
+            node->mNumChildren = 0;
+            node->mChildren = nullptr;
+        }
+
+        for (auto& channel : channels)
+        {
+            channel->mPositionKeys = nullptr;
+            channel->mRotationKeys = nullptr;
+            channel->mScalingKeys = nullptr;
+        }
+    }
+};
+
+aiMatrix4x4 RandomTransform(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> coordinate(-2.0f, 2.0f);
+    aiMatrix4x4 rotation, translation;
+    aiMatrix4x4::RotationY(coordinate(rng), rotation);
+    aiMatrix4x4::Translation(aiVector3D(coordinate(rng), coordinate(rng), coordinate(rng)), translation);
+    return translation * rotation;
+}
+
+void MakeTree(std::mt19937& rng, RandomTree& tree)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> coordinate(-2.0f, 2.0f);
+
+    tree.children.resize(NODE_COUNT);
+    for (size_t i = 0; i < NODE_COUNT; i++)
+    {
+        tree.nodes.emplace_back(new aiNode());
+        auto node = tree.nodes.back().get();
+        node->mName.Set("node" + std::to_string(i));
+        node->mTransformation = RandomTransform(rng);
+
+        // Any earlier node can be the parent, which gives deep chains as well as wide fans
+        if (i > 0)
+        {
+            auto parent = std::uniform_int_distribution<size_t>(0, i - 1)(rng);
+            node->mParent = tree.nodes[parent].get();
+            tree.children[parent].push_back(node);
+        }
+
+        // Bone ids in a different order than the nodes, like a mesh's bone list
+        if (unit(rng) < 0.6f)
+        {
+            BoneInfo info;
+            info.id = tree.boneInfoMap.size();
+            info.offset = RandomTransform(rng);
+            tree.boneInfoMap[node->mName.C_Str()] = info;
+        }
+    }
+
+    for (size_t i = 0; i < NODE_COUNT; i++)
+    {
+        tree.nodes[i]->mNumChildren = unsigned(tree.children[i].size());
+        tree.nodes[i]->mChildren = tree.children[i].empty() ? nullptr : tree.children[i].data();
+    }
+
+    // Channels for some nodes plus one that matches no node, in shuffled order
+    std::vector<std::string> names;
+    for (size_t i = 0; i < NODE_COUNT; i++)
+    {
+        if (unit(rng) < 0.5f) names.push_back(tree.nodes[i]->mName.C_Str());
+    }
+    names.push_back("missing");
+    std::shuffle(names.begin(), names.end(), rng);
+
+    tree.positionKeys.resize(names.size());
+    tree.rotationKeys.resize(names.size());
+    tree.scaleKeys.resize(names.size());
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        auto keyCount = std::uniform_int_distribution<size_t>(1, 6)(rng);
+        for (size_t k = 0; k < keyCount; k++)
+        {
+            double time = DURATION * k / keyCount;
+            // Around the Y axis
+            float halfAngle = coordinate(rng) / 2.0f;
+            aiQuaternion rotation(std::cos(halfAngle), 0.0f, std::sin(halfAngle), 0.0f);
+            tree.positionKeys[i].push_back(aiVectorKey{time, aiVector3D(coordinate(rng), coordinate(rng), coordinate(rng))});
+            tree.rotationKeys[i].push_back(aiQuatKey{time, rotation});
+            tree.scaleKeys[i].push_back(aiVectorKey{time, aiVector3D(1.0f + unit(rng), 1.0f, 1.0f)});
+        }
+
+        tree.channels.emplace_back(new aiNodeAnim());
+        auto channel = tree.channels.back().get();
+        channel->mNodeName.Set(names[i]);
+        channel->mNumPositionKeys = unsigned(keyCount);
+        channel->mPositionKeys = tree.positionKeys[i].data();
+        channel->mNumRotationKeys = unsigned(keyCount);
+        channel->mRotationKeys = tree.rotationKeys[i].data();
+        channel->mNumScalingKeys = unsigned(keyCount);
+        channel->mScalingKeys = tree.scaleKeys[i].data();
+
+        auto entry = tree.boneInfoMap.find(names[i]);
+        auto id = entry == tree.boneInfoMap.end() ? tree.boneInfoMap.size() : entry->second.id;
+        tree.bones.emplace_back(names[i], id, channel);
+    }
+}
+
+/// The recursion that Skeleton::Evaluate replaced, searching the bones and boneInfoMap by name at every node
+void EvaluateRecursively(const aiNode* node, const aiMatrix4x4& parentTransform, const RandomTree& tree,
+    float animationTime, std::vector<aiMatrix4x4>& finalBoneMatrices)
+{
+    auto nodeTransform = node->mTransformation;
+    for (const auto& bone : tree.bones)
+    {
+        if (bone.GetName() == node->mName.C_Str())
+        {
+            KeyframeCursor cursor;
+            nodeTransform = bone.Sample(animationTime, cursor);
+            break;
+        }
+    }
+
+    auto globalTransform = parentTransform * nodeTransform;
+
+    auto entry = tree.boneInfoMap.find(node->mName.C_Str());
+    if (entry != tree.boneInfoMap.end())
+    {
+        finalBoneMatrices[entry->second.id] = globalTransform * entry->second.offset;
+    }
+
+    for (size_t i = 0; i < node->mNumChildren; i++)
+    {
+        EvaluateRecursively(node->mChildren[i], globalTransform, tree, animationTime, finalBoneMatrices);
+    }
+}
+
+void TestTree(std::mt19937& rng)
+{
+    RandomTree tree;
+    MakeTree(rng, tree);
+
+    Skeleton skeleton(tree.nodes[0].get(), tree.boneInfoMap);
+    const auto& joints = skeleton.Joints();
+    CHECK(joints.size() == NODE_COUNT);
+    CHECK(joints[0].parent == Skeleton::NONE);
+
+    bool parentsFirst = true;
+    for (size_t i = 1; i < joints.size(); i++)
+    {
+        parentsFirst &= joints[i].parent < i;
+    }
+    CHECK(parentsFirst);
+
+    auto jointChannels = skeleton.MapChannels(tree.bones);
+    std::vector<KeyframeCursor> cursors(tree.bones.size());
+    std::vector<aiMatrix4x4> globalTransforms;
+    std::vector<aiMatrix4x4> expected(tree.boneInfoMap.size()), actual(tree.boneInfoMap.size());
+
+    // Forwards and then backwards, so that the cursors also have to search backwards
+    std::vector<float> times;
+    for (float time = 0.0f; time <= DURATION; time += 1.37f) times.push_back(time);
+    for (float time = DURATION; time >= 0.0f; time -= 2.9f) times.push_back(time);
+
+    bool identical = true;
+    for (float time : times)
+    {
+        EvaluateRecursively(tree.nodes[0].get(), aiMatrix4x4(), tree, time, expected);
+        skeleton.Evaluate(jointChannels, tree.bones, cursors, time, globalTransforms, actual);
+        identical &= memcmp(expected.data(), actual.data(), expected.size() * sizeof(aiMatrix4x4)) == 0;
+    }
+    CHECK(identical);
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    for (size_t i = 0; i < TREE_COUNT; i++)
+    {
+        TestTree(rng);
+    }
+
+    return HostTest::Result();
+}
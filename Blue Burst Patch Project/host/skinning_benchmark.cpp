@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "newgfx/mesh.h"
+#include "newgfx/skinning.h"
+
+/**
+ * Compares the per-vertex bone lists that Mesh::ApplyBoneTransformations used to blend
+ * with the packed influences and SSE kernel in Skinning, on a synthetic mesh.
+ */
+
+const size_t VERTEX_COUNT = 20000;
+const size_t BONE_COUNT = 40;
+const size_t RUNS = 100;
+
+/// The loop that Mesh::ApplyBoneTransformations ran before Skinning
+void SkinWithBoneLists(const std::vector<Vertex>& src, const std::vector<std::vector<VertexBoneData>>& vertexBoneMap,
+    const std::vector<aiMatrix4x4>& transforms, std::vector<Vertex>& dst)
+{
+    for (size_t vertIdx = 0; vertIdx < src.size(); vertIdx++)
+    {
+        auto& vert = dst[vertIdx];
+        vert.position = src[vertIdx].position;
+        vert.normal = src[vertIdx].normal;
+
+        auto bones = vertexBoneMap[vertIdx];
+        if (bones.empty()) continue;
+
+        auto totalTransform = transforms[bones[0].boneId] * bones[0].boneWeight;
+        for (size_t i = 1; i < bones.size(); i++)
+        {
+            totalTransform = totalTransform + (transforms[bones[i].boneId] * bones[i].boneWeight);
+        }
+
+        vert.position *= totalTransform;
+        vert.normal *= totalTransform;
+    }
+}
+
+template<typename F>
+double VerticesPerMillisecond(F skin)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t run = 0; run < RUNS; run++)
+    {
+        skin();
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return double(VERTEX_COUNT * RUNS) / ms;
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+    std::uniform_int_distribution<size_t> bone(0, BONE_COUNT - 1);
+    // Mostly 1 to 4 bones like typical exports, with the odd vertex that has none or too many
+    std::discrete_distribution<size_t> boneCount({2, 30, 30, 20, 15, 3});
+
+    std::vector<Vertex> vertices(VERTEX_COUNT);
+    std::vector<std::vector<VertexBoneData>> vertexBoneMap(VERTEX_COUNT);
+    for (size_t i = 0; i < VERTEX_COUNT; i++)
+    {
+        vertices[i].position = aiVector3D(coordinate(rng), coordinate(rng), coordinate(rng));
+        vertices[i].normal = aiVector3D(0.0f, 1.0f, 0.0f);
+
+        size_t count = boneCount(rng);
+        for (size_t b = 0; b < count; b++)
+        {
+            vertexBoneMap[i].push_back(VertexBoneData{bone(rng), 1.0f / count});
+        }
+    }
+
+    std::vector<aiMatrix4x4> transforms(BONE_COUNT);
+    for (auto& transform : transforms)
+    {
+        aiMatrix4x4 rotation, translation;
+        aiMatrix4x4::RotationY(coordinate(rng), rotation);
+        aiMatrix4x4::Translation(aiVector3D(coordinate(rng), coordinate(rng), coordinate(rng)), translation);
+        transform = translation * rotation;
+    }
+
+    std::vector<Vertex> before(VERTEX_COUNT);
+    std::vector<Vertex> after(VERTEX_COUNT);
+    auto influences = Skinning::PackInfluences(vertexBoneMap);
+    std::vector<Skinning::PaletteMatrix> palette;
+
+    double beforeRate = VerticesPerMillisecond([&]() {
+        SkinWithBoneLists(vertices, vertexBoneMap, transforms, before);
+    });
+
+    double afterRate = VerticesPerMillisecond([&]() {
+        Skinning::BuildPalette(transforms, palette);
+        Skinning::SkinVertices(vertices.data(), influences.data(), VERTEX_COUNT, palette.data(), after.data());
+    });
+
+    // Vertices with more than 4 bones are expected to differ, the rest should match
+    float maxDifference = 0.0f;
+    for (size_t i = 0; i < VERTEX_COUNT; i++)
+    {
+        if (vertexBoneMap[i].size() > Skinning::MAX_INFLUENCES) continue;
+        maxDifference = std::max(maxDifference, (before[i].position - after[i].position).Length());
+    }
+
+    printf("bone lists:        %.0f vertices/ms\n", beforeRate);
+    printf("packed influences: %.0f vertices/ms (%.1fx)\n", afterRate, afterRate / beforeRate);
+    printf("largest position difference: %g\n", maxDifference);
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdio>
+
+/**
+ * Checks for the host tests that ctest runs. A failed check prints where it failed and the test keeps going,
+ * so that one run shows every failure. Return HostTest::Result() from main.
+ */
+namespace HostTest
+{
+    inline int failures = 0;
+
+    inline bool Check(bool passed, const char* expression, const char* file, int line)
+    {
+        if (!passed)
+        {
+            fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+            failures++;
+        }
+
+        return passed;
+    }
+
+    inline int Result()
+    {
+        if (failures > 0) fprintf(stderr, "%d checks failed\n", failures);
+        return failures > 0 ? 1 : 0;
+    }
+};
+
+#define CHECK(expression) HostTest::Check(bool(expression), #expression, __FILE__, __LINE__)
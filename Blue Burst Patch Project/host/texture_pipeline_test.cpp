@@ -0,0 +1,454 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "newgfx/texture_pipeline.h"
+#include "test.h"
+
+/**
+ * Checks TexturePipeline against golden images in golden/.
+ * The goldens are PAM files (RGBA), which most image viewers and ImageMagick can open.
+ *
+ * Usage: texture_pipeline_test <golden directory> [--update]
+ * --update rewrites the goldens from the current output, look at them before committing.
+ */
+
+using namespace TexturePipeline;
+
+/// Pixels may differ by this much from a golden, the filters use floats
+const int MAX_CHANNEL_DIFFERENCE = 1;
+/// Decoded DXT images have to be at least this close to their golden
+const double MIN_GOLDEN_PSNR = 50.0;
+/// And at least this close to the source image
+const double MIN_DXT1_PSNR = 35.0;
+const double MIN_DXT5_PSNR = 33.0;
+
+std::string goldenDirectory;
+bool update = false;
+
+/// Images are BGRA like in the pipeline, PAM files are RGBA
+void WritePam(const std::string& name, const Image& image)
+{
+    std::ofstream file(goldenDirectory + "/" + name, std::ios::binary | std::ios::trunc);
+    file << "P7\nWIDTH " << image.width << "\nHEIGHT " << image.height << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+
+    std::vector<uint8_t> rgba(image.pixels.size());
+    SwapRedBlue(image.pixels.data(), rgba.data(), rgba.size() / CHANNEL_COUNT);
+    file.write(reinterpret_cast<const char*>(rgba.data()), rgba.size());
+}
+
+bool ReadPam(const std::string& name, Image& image)
+{
+    std::ifstream file(goldenDirectory + "/" + name, std::ios::binary);
+    if (!file.is_open())
+    {
+        fprintf(stderr, "missing golden %s\n", name.c_str());
+        return false;
+    }
+
+    std::string line;
+    image.width = image.height = 0;
+    while (std::getline(file, line) && line != "ENDHDR")
+    {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        if (key == "WIDTH") fields >> image.width;
+        if (key == "HEIGHT") fields >> image.height;
+    }
+
+    std::vector<uint8_t> rgba(size_t(image.width) * image.height * CHANNEL_COUNT);
+    file.read(reinterpret_cast<char*>(rgba.data()), rgba.size());
+    if (!file)
+    {
+        fprintf(stderr, "truncated golden %s\n", name.c_str());
+        return false;
+    }
+
+    image.pixels.resize(rgba.size());
+    SwapRedBlue(rgba.data(), image.pixels.data(), rgba.size() / CHANNEL_COUNT);
+    return true;
+}
+
+int MaxDifference(const Image& a, const Image& b)
+{
+    int difference = 0;
+    for (size_t i = 0; i < a.pixels.size(); i++)
+    {
+        difference = std::max(difference, std::abs(int(a.pixels[i]) - int(b.pixels[i])));
+    }
+    return difference;
+}
+
+double Psnr(const Image& a, const Image& b)
+{
+    double squaredError = 0.0;
+    for (size_t i = 0; i < a.pixels.size(); i++)
+    {
+        double difference = double(a.pixels[i]) - double(b.pixels[i]);
+        squaredError += difference * difference;
+    }
+
+    if (squaredError == 0.0) return 99.0;
+    return 10.0 * std::log10(255.0 * 255.0 / (squaredError / a.pixels.size()));
+}
+
+bool SameSize(const Image& a, const Image& b)
+{
+    return a.width == b.width && a.height == b.height && a.pixels.size() == b.pixels.size();
+}
+
+/// Compares against the golden, or replaces the golden with --update
+void CheckGolden(const std::string& name, const Image& image, int maxDifference)
+{
+    if (update)
+    {
+        WritePam(name, image);
+        return;
+    }
+
+    Image golden;
+    if (!CHECK(ReadPam(name, golden))) return;
+    if (!CHECK(SameSize(image, golden))) return;
+
+    int difference = MaxDifference(image, golden);
+    if (difference > maxDifference) fprintf(stderr, "%s differs by up to %d\n", name.c_str(), difference);
+    CHECK(difference <= maxDifference);
+}
+
+void CheckGoldenPsnr(const std::string& name, const Image& image)
+{
+    if (update)
+    {
+        WritePam(name, image);
+        return;
+    }
+
+    Image golden;
+    if (!CHECK(ReadPam(name, golden))) return;
+    if (!CHECK(SameSize(image, golden))) return;
+
+    double psnr = Psnr(image, golden);
+    if (psnr < MIN_GOLDEN_PSNR) fprintf(stderr, "%s is %.1f dB from its golden\n", name.c_str(), psnr);
+    CHECK(psnr >= MIN_GOLDEN_PSNR);
+}
+
+void Decode565(uint16_t packed, int* bgr)
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    bgr[0] = b << 3 | b >> 2;
+    bgr[1] = g << 2 | g >> 4;
+    bgr[2] = r << 3 | r >> 2;
+}
+
+/// Reference decoder for a DXT color block, as described in the D3D documentation
+void DecodeColorBlock(const uint8_t* block, bool allowPunchThrough, uint8_t (&pixels)[16][4])
+{
+    uint16_t color0 = block[0] | block[1] << 8;
+    uint16_t color1 = block[2] | block[3] << 8;
+
+    int palette[4][4];
+    Decode565(color0, palette[0]);
+    Decode565(color1, palette[1]);
+    palette[0][3] = palette[1][3] = 255;
+
+    if (color0 > color1 || !allowPunchThrough)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        palette[2][3] = palette[3][3] = 255;
+    }
+    else
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+        palette[2][3] = 255;
+        palette[3][3] = 0;
+    }
+
+    uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | uint32_t(block[7]) << 24;
+    for (int i = 0; i < 16; i++)
+    {
+        auto entry = palette[(indices >> (2 * i)) & 3];
+        for (int c = 0; c < 4; c++)
+        {
+            pixels[i][c] = uint8_t(entry[c]);
+        }
+    }
+}
+
+void DecodeAlphaBlock(const uint8_t* block, uint8_t (&pixels)[16][4])
+{
+    int palette[8] = {block[0], block[1]};
+    if (palette[0] > palette[1])
+    {
+        for (int i = 1; i < 7; i++)
+        {
+            palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+        }
+    }
+    else
+    {
+        for (int i = 1; i < 5; i++)
+        {
+            palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        indices |= uint64_t(block[2 + i]) << (8 * i);
+    }
+
+    for (int i = 0; i < 16; i++)
+    {
+        pixels[i][3] = uint8_t(palette[(indices >> (3 * i)) & 7]);
+    }
+}
+
+Image Decode(const std::vector<uint8_t>& data, Format format, uint32_t width, uint32_t height)
+{
+    Image image{width, height, std::vector<uint8_t>(size_t(width) * height * CHANNEL_COUNT)};
+    size_t blockBytes = format == Format::Dxt1 ? 8 : 16;
+    uint32_t blocksWide = (width + 3) / 4;
+
+    for (uint32_t blockY = 0; blockY < (height + 3) / 4; blockY++)
+    {
+        for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+        {
+            auto block = &data[(size_t(blockY) * blocksWide + blockX) * blockBytes];
+            uint8_t pixels[16][4];
+            if (format == Format::Dxt1)
+            {
+                DecodeColorBlock(block, true, pixels);
+            }
+            else
+            {
+                DecodeColorBlock(block + 8, false, pixels);
+                DecodeAlphaBlock(block, pixels);
+            }
+
+            for (uint32_t y = 0; y < 4; y++)
+            {
+                for (uint32_t x = 0; x < 4; x++)
+                {
+                    uint32_t imageX = blockX * 4 + x, imageY = blockY * 4 + y;
+                    if (imageX >= width || imageY >= height) continue;
+                    memcpy(&image.pixels[(size_t(imageY) * width + imageX) * CHANNEL_COUNT], pixels[y * 4 + x], CHANNEL_COUNT);
+                }
+            }
+        }
+    }
+
+    return image;
+}
+
+/// Smooth colors and an alpha gradient, only used to create the source golden
+Image MakeSource()
+{
+    const uint32_t size = 64;
+    Image image{size, size, std::vector<uint8_t>(size * size * CHANNEL_COUNT)};
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            auto pixel = &image.pixels[(y * size + x) * CHANNEL_COUNT];
+            pixel[0] = uint8_t(128 + 100 * std::sin(x * 0.2));
+            pixel[1] = uint8_t(y * 4);
+            pixel[2] = uint8_t((x + y) * 2);
+            pixel[3] = uint8_t(x * 4);
+        }
+    }
+    return image;
+}
+
+void TestSwapRedBlue()
+{
+    std::mt19937 rng(1);
+    // Not a multiple of 4 so that the scalar tail runs too
+    const size_t count = 1027;
+    std::vector<uint8_t> src(count * CHANNEL_COUNT), dst(src.size()), expected(src.size());
+    for (auto& byte : src) byte = uint8_t(rng());
+
+    for (size_t i = 0; i < count; i++)
+    {
+        expected[i * 4 + 0] = src[i * 4 + 2];
+        expected[i * 4 + 1] = src[i * 4 + 1];
+        expected[i * 4 + 2] = src[i * 4 + 0];
+        expected[i * 4 + 3] = src[i * 4 + 3];
+    }
+
+    SwapRedBlue(src.data(), dst.data(), count);
+    CHECK(dst == expected);
+
+    // In place
+    SwapRedBlue(dst.data(), dst.data(), count);
+    CHECK(dst == src);
+}
+
+void TestMipSizes()
+{
+    CHECK(MipLevelCount(256, 64) == 9);
+    CHECK(MipLevelCount(1, 1) == 1);
+    CHECK(MipLevelCount(5, 3) == 3);
+
+    Image odd{37, 10, std::vector<uint8_t>(37 * 10 * CHANNEL_COUNT)};
+    for (auto filter : {MipFilter::Box, MipFilter::Kaiser})
+    {
+        auto chain = BuildMipChain(odd, filter);
+        CHECK(chain.size() == MipLevelCount(37, 10));
+        CHECK(chain[1].width == 18 && chain[1].height == 5);
+        CHECK(chain.back().width == 1 && chain.back().height == 1);
+        for (const auto& level : chain)
+        {
+            CHECK(level.pixels.size() == size_t(level.width) * level.height * CHANNEL_COUNT);
+        }
+    }
+
+    CHECK(LevelSize(Format::Dxt1, 64, 64) == 64 * 64 / 2);
+    CHECK(LevelSize(Format::Dxt5, 64, 64) == 64 * 64);
+    // Levels smaller than a block still take a whole block
+    CHECK(LevelSize(Format::Dxt1, 2, 1) == 8);
+    CHECK(CanCompress(64, 32) && !CanCompress(64, 30));
+}
+
+/// Filters must not change an image of one color, no matter the size
+void TestFlatImages()
+{
+    Image flat{37, 10, std::vector<uint8_t>(37 * 10 * CHANNEL_COUNT)};
+    for (size_t i = 0; i < flat.pixels.size(); i++)
+    {
+        flat.pixels[i] = uint8_t((i % CHANNEL_COUNT) * 60 + 10);
+    }
+
+    for (auto filter : {MipFilter::Box, MipFilter::Kaiser})
+    {
+        for (const auto& level : BuildMipChain(flat, filter))
+        {
+            bool unchanged = true;
+            for (size_t i = 0; i < level.pixels.size(); i++)
+            {
+                unchanged &= level.pixels[i] == (i % CHANNEL_COUNT) * 60 + 10;
+            }
+            CHECK(unchanged);
+        }
+    }
+
+    // A 565 representable color survives DXT1 exactly
+    Image solid{4, 4, std::vector<uint8_t>(16 * CHANNEL_COUNT)};
+    for (size_t i = 0; i < solid.pixels.size(); i += CHANNEL_COUNT)
+    {
+        solid.pixels[i + 0] = 8;
+        solid.pixels[i + 1] = 251;
+        solid.pixels[i + 2] = 255;
+        solid.pixels[i + 3] = 255;
+    }
+    CHECK(Psnr(solid, Decode(Compress(solid, Format::Dxt1), Format::Dxt1, 4, 4)) > 60.0);
+}
+
+/// DXT1 stores pixels with alpha below 128 as transparent black and keeps the rest opaque
+void TestPunchThroughAlpha()
+{
+    Image cutout{4, 4, std::vector<uint8_t>(16 * CHANNEL_COUNT, 200)};
+    for (size_t i = 3; i < cutout.pixels.size(); i += CHANNEL_COUNT)
+    {
+        cutout.pixels[i] = 255;
+    }
+    cutout.pixels[3] = 0;
+    cutout.pixels[7] = 127;
+    cutout.pixels[11] = 128;
+
+    CHECK(HasTransparency(cutout));
+
+    auto decoded = Decode(Compress(cutout, Format::Dxt1), Format::Dxt1, 4, 4);
+    CHECK(decoded.pixels[3] == 0);
+    CHECK(decoded.pixels[7] == 0);
+    CHECK(decoded.pixels[11] == 255);
+    CHECK(decoded.pixels[15] == 255);
+    // Opaque pixels keep their color
+    CHECK(std::abs(int(decoded.pixels[12]) - 200) <= 8);
+}
+
+void TestGoldens()
+{
+    Image source;
+    if (update)
+    {
+        source = MakeSource();
+        WritePam("source.pam", source);
+    }
+    else if (!CHECK(ReadPam("source.pam", source)))
+    {
+        return;
+    }
+
+    auto boxChain = BuildMipChain(source, MipFilter::Box);
+    auto kaiserChain = BuildMipChain(source, MipFilter::Kaiser);
+    // Box filtering is integer math, so it has to match exactly
+    CheckGolden("box_mip1.pam", boxChain[1], 0);
+    CheckGolden("box_mip2.pam", boxChain[2], 0);
+    CheckGolden("kaiser_mip1.pam", kaiserChain[1], MAX_CHANNEL_DIFFERENCE);
+    CheckGolden("kaiser_mip2.pam", kaiserChain[2], MAX_CHANNEL_DIFFERENCE);
+
+    Image opaque = source;
+    for (size_t i = 3; i < opaque.pixels.size(); i += CHANNEL_COUNT)
+    {
+        opaque.pixels[i] = 255;
+    }
+    CHECK(!HasTransparency(opaque) && HasTransparency(source));
+
+    auto dxt1 = Compress(opaque, Format::Dxt1);
+    CHECK(dxt1.size() == LevelSize(Format::Dxt1, opaque.width, opaque.height));
+    auto decoded1 = Decode(dxt1, Format::Dxt1, opaque.width, opaque.height);
+    CheckGoldenPsnr("dxt1.pam", decoded1);
+    printf("dxt1 %.1f dB\n", Psnr(opaque, decoded1));
+    CHECK(Psnr(opaque, decoded1) >= MIN_DXT1_PSNR);
+
+    auto dxt5 = Compress(source, Format::Dxt5);
+    CHECK(dxt5.size() == LevelSize(Format::Dxt5, source.width, source.height));
+    auto decoded5 = Decode(dxt5, Format::Dxt5, source.width, source.height);
+    CheckGoldenPsnr("dxt5.pam", decoded5);
+    printf("dxt5 %.1f dB\n", Psnr(source, decoded5));
+    CHECK(Psnr(source, decoded5) >= MIN_DXT5_PSNR);
+
+    // Every level of a compressed chain has the size that D3D expects, including the ones smaller than a block
+    for (const auto& level : kaiserChain)
+    {
+        CHECK(Compress(level, Format::Dxt5).size() == LevelSize(Format::Dxt5, level.width, level.height));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || (argc == 3 && std::string(argv[2]) != "--update") || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s <golden directory> [--update]\n", argv[0]);
+        return 1;
+    }
+
+    goldenDirectory = argv[1];
+    update = argc == 3;
+
+    TestSwapRedBlue();
+    TestMipSizes();
+    TestFlatImages();
+    TestPunchThroughAlpha();
+    TestGoldens();
+
+    return HostTest::Result();
+}
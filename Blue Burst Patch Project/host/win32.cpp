@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <ctime>
+#include <cwctype>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <windows.h>
+
+namespace
+{
+    /// Difference between the FILETIME epoch (1601) and the Unix epoch in 100 ns intervals
+    const uint64_t FILETIME_UNIX_EPOCH = 116444736000000000ULL;
+
+    int ToMmapProtection(DWORD protect)
+    {
+        switch (protect)
+        {
+            case PAGE_EXECUTE_READWRITE:
+                return PROT_READ | PROT_WRITE | PROT_EXEC;
+            default:
+                return PROT_READ | PROT_WRITE;
+        }
+    }
+
+    /// MSVC's wide printf functions take wide strings for %s and narrow strings for %S, glibc's take narrow strings for both
+    std::wstring TranslateWideFormat(const wchar_t* format)
+    {
+        std::wstring out;
+
+        for (const wchar_t* p = format; *p != 0; p++)
+        {
+            out += *p;
+            if (*p != L'%') continue;
+
+            std::wstring spec;
+            for (p++; *p != 0 && wcschr(L"-+ #0123456789.*hlLjztwI", *p) != nullptr; p++)
+            {
+                spec += *p;
+            }
+
+            if (*p == 0) break;
+
+            if (wcschr(L"sScC", *p) == nullptr)
+            {
+                // I64 is the only MSVC specific size prefix in use
+                size_t i64 = spec.find(L"I64");
+                if (i64 != std::wstring::npos) spec.replace(i64, 3, L"ll");
+
+                out += spec;
+                out += *p;
+                continue;
+            }
+
+            bool wide = *p == L's' || *p == L'c';
+            while (!spec.empty() && wcschr(L"hlw", spec.back()) != nullptr)
+            {
+                wide = spec.back() != L'h';
+                spec.pop_back();
+            }
+
+            out += spec;
+            if (wide) out += L'l';
+            out += (wchar_t) towlower(*p);
+        }
+
+        return out;
+    }
+
+    std::string ToHostPath(const char* path)
+    {
+        std::string out(path);
+        for (char& c : out)
+        {
+            if (c == '\\') c = '/';
+        }
+        return out;
+    }
+
+    /// File and file mapping handles are heap-allocated descriptors, any other handle is a dummy
+    struct FileHandle
+    {
+        int fd;
+    };
+
+    std::mutex fileMutex;
+    std::unordered_map<HANDLE, FileHandle*> fileHandles;
+    /// Sizes of mapped views, which munmap needs
+    std::unordered_map<LPCVOID, size_t> viewSizes;
+
+    HANDLE AddFileHandle(int fd)
+    {
+        auto handle = new FileHandle{fd};
+        std::lock_guard<std::mutex> lock(fileMutex);
+        fileHandles[handle] = handle;
+        return handle;
+    }
+
+    /// Signalled when the thread returns, like a real thread handle
+    struct ThreadHandle
+    {
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool done = false;
+    };
+
+    std::mutex threadMutex;
+    /// The thread keeps its own reference, so closing the handle early is fine
+    std::unordered_map<HANDLE, std::shared_ptr<ThreadHandle>> threadHandles;
+
+    int FindFileDescriptor(HANDLE handle)
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        auto found = fileHandles.find(handle);
+        return found == fileHandles.end() ? -1 : found->second->fd;
+    }
+
+    std::string ToHostPath(const wchar_t* path)
+    {
+        std::string narrow;
+        for (const wchar_t* p = path; *p != 0; p++)
+        {
+            narrow += (char) *p;
+        }
+        return ToHostPath(narrow.c_str());
+    }
+};
+
+LPVOID VirtualAlloc(LPVOID address, SIZE_T size, DWORD, DWORD protect)
+{
+    void* memory = mmap(address, size, ToMmapProtection(protect), MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+}
+
+BOOL VirtualFree(LPVOID address, SIZE_T size, DWORD)
+{
+    return munmap(address, size) == 0;
+}
+
+BOOL VirtualProtect(LPVOID address, SIZE_T size, DWORD newProtect, PDWORD oldProtect)
+{
+    // Protection is not tracked, the simulated image is always writable
+    if (oldProtect != nullptr) *oldProtect = PAGE_READWRITE;
+
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t begin = (size_t) address & ~(page - 1);
+    size_t end = (size_t) address + size;
+    return mprotect((void*) begin, end - begin, ToMmapProtection(newProtect)) == 0;
+}
+
+HANDLE GetCurrentProcess()
+{
+    return (HANDLE) -1;
+}
+
+BOOL FlushInstructionCache(HANDLE, LPCVOID, SIZE_T)
+{
+    return TRUE;
+}
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* count)
+{
+    count->QuadPart = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency)
+{
+    frequency->QuadPart = 1000000000;
+    return TRUE;
+}
+
+void GetSystemTimeAsFileTime(FILETIME* time)
+{
+    uint64_t intervals = FILETIME_UNIX_EPOCH + std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() / 100;
+    time->dwLowDateTime = (DWORD) intervals;
+    time->dwHighDateTime = (DWORD) (intervals >> 32);
+}
+
+BOOL FileTimeToLocalFileTime(const FILETIME* utc, FILETIME* local)
+{
+    *local = *utc;
+    return TRUE;
+}
+
+BOOL FileTimeToSystemTime(const FILETIME* time, SYSTEMTIME* out)
+{
+    uint64_t intervals = ((uint64_t) time->dwHighDateTime << 32) | time->dwLowDateTime;
+    time_t seconds = (time_t) ((intervals - FILETIME_UNIX_EPOCH) / 10000000);
+
+    struct tm parts;
+    if (gmtime_r(&seconds, &parts) == nullptr) return FALSE;
+
+    out->wYear = (WORD) (parts.tm_year + 1900);
+    out->wMonth = (WORD) (parts.tm_mon + 1);
+    out->wDayOfWeek = (WORD) parts.tm_wday;
+    out->wDay = (WORD) parts.tm_mday;
+    out->wHour = (WORD) parts.tm_hour;
+    out->wMinute = (WORD) parts.tm_min;
+    out->wSecond = (WORD) parts.tm_sec;
+    out->wMilliseconds = (WORD) ((intervals / 10000) % 1000);
+    return TRUE;
+}
+
+void Sleep(DWORD milliseconds)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+HANDLE CreateThread(void*, SIZE_T, LPTHREAD_START_ROUTINE start, LPVOID param, DWORD, LPDWORD)
+{
+    auto thread = std::make_shared<ThreadHandle>();
+    HANDLE handle = thread.get();
+    {
+        std::lock_guard<std::mutex> lock(threadMutex);
+        threadHandles[handle] = thread;
+    }
+
+    std::thread([thread, start, param]() {
+        start(param);
+
+        std::lock_guard<std::mutex> lock(thread->mutex);
+        thread->done = true;
+        thread->finished.notify_all();
+    }).detach();
+
+    return handle;
+}
+
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds)
+{
+    std::shared_ptr<ThreadHandle> thread;
+    {
+        std::lock_guard<std::mutex> lock(threadMutex);
+        auto found = threadHandles.find(handle);
+        if (found == threadHandles.end()) return WAIT_FAILED;
+        thread = found->second;
+    }
+
+    std::unique_lock<std::mutex> lock(thread->mutex);
+    auto isDone = [&]() { return thread->done; };
+    if (milliseconds == INFINITE)
+    {
+        thread->finished.wait(lock, isDone);
+        return WAIT_OBJECT_0;
+    }
+
+    return thread->finished.wait_for(lock, std::chrono::milliseconds(milliseconds), isDone) ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+}
+
+BOOL CloseHandle(HANDLE handle)
+{
+    {
+        std::lock_guard<std::mutex> lock(threadMutex);
+        if (threadHandles.erase(handle) > 0) return TRUE;
+    }
+
+    std::lock_guard<std::mutex> lock(fileMutex);
+    auto found = fileHandles.find(handle);
+    if (found != fileHandles.end())
+    {
+        close(found->second->fd);
+        delete found->second;
+        fileHandles.erase(found);
+    }
+
+    return TRUE;
+}
+
+HANDLE CreateFileA(const char* filename, DWORD, DWORD, void*, DWORD, DWORD, HANDLE)
+{
+    int fd = open(ToHostPath(filename).c_str(), O_RDONLY);
+    return fd < 0 ? INVALID_HANDLE_VALUE : AddFileHandle(fd);
+}
+
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size)
+{
+    struct stat info;
+    if (fstat(FindFileDescriptor(file), &info) != 0) return FALSE;
+
+    size->QuadPart = info.st_size;
+    return TRUE;
+}
+
+DWORD GetFileAttributesA(const char* filename)
+{
+    struct stat info;
+    if (stat(ToHostPath(filename).c_str(), &info) != 0) return INVALID_FILE_ATTRIBUTES;
+    return FILE_ATTRIBUTE_NORMAL;
+}
+
+HANDLE CreateFileMappingA(HANDLE file, void*, DWORD, DWORD, DWORD, const char*)
+{
+    // The mapping outlives the file handle, like on Windows
+    int fd = FindFileDescriptor(file);
+    if (fd < 0) return nullptr;
+
+    int mappingFd = dup(fd);
+    return mappingFd < 0 ? nullptr : AddFileHandle(mappingFd);
+}
+
+LPVOID MapViewOfFile(HANDLE mapping, DWORD, DWORD, DWORD, SIZE_T)
+{
+    // Only whole files are mapped
+    struct stat info;
+    int fd = FindFileDescriptor(mapping);
+    if (fstat(fd, &info) != 0 || info.st_size == 0) return nullptr;
+
+    void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) return nullptr;
+
+    std::lock_guard<std::mutex> lock(fileMutex);
+    viewSizes[view] = info.st_size;
+    return view;
+}
+
+BOOL UnmapViewOfFile(LPCVOID address)
+{
+    std::lock_guard<std::mutex> lock(fileMutex);
+    auto found = viewSizes.find(address);
+    if (found == viewSizes.end()) return FALSE;
+
+    munmap(const_cast<void*>(address), found->second);
+    viewSizes.erase(found);
+    return TRUE;
+}
+
+DWORD GetCurrentThreadId()
+{
+    static std::atomic<DWORD> nextId(1);
+    thread_local DWORD id = nextId.fetch_add(1);
+    return id;
+}
+
+void AcquireSRWLockExclusive(SRWLOCK* lock)
+{
+    auto flag = reinterpret_cast<std::atomic<void*>*>(&lock->Ptr);
+    void* unlocked = nullptr;
+
+    while (!flag->compare_exchange_weak(unlocked, (void*) 1, std::memory_order_acquire))
+    {
+        unlocked = nullptr;
+        std::this_thread::yield();
+    }
+}
+
+BOOLEAN TryAcquireSRWLockExclusive(SRWLOCK* lock)
+{
+    void* unlocked = nullptr;
+    return reinterpret_cast<std::atomic<void*>*>(&lock->Ptr)->compare_exchange_strong(unlocked, (void*) 1, std::memory_order_acquire);
+}
+
+void ReleaseSRWLockExclusive(SRWLOCK* lock)
+{
+    reinterpret_cast<std::atomic<void*>*>(&lock->Ptr)->store(nullptr, std::memory_order_release);
+}
+
+int _snwprintf_s(wchar_t* buffer, size_t size, size_t count, const wchar_t* format, ...)
+{
+    size_t limit = count == _TRUNCATE ? size : std::min(size, count + 1);
+
+    va_list args;
+    va_start(args, format);
+    int written = vswprintf(buffer, limit, TranslateWideFormat(format).c_str(), args);
+    va_end(args);
+
+    // glibc leaves the buffer unterminated and returns -1 when the output does not fit
+    if (written < 0 && limit > 0) buffer[limit - 1] = 0;
+    return written;
+}
+
+int _snprintf_s(char* buffer, size_t size, size_t count, const char* format, ...)
+{
+    size_t limit = count == _TRUNCATE ? size : std::min(size, count + 1);
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer, limit, format, args);
+    va_end(args);
+
+    return written >= 0 && (size_t) written < limit ? written : -1;
+}
+
+int fopen_s(FILE** file, const char* filename, const char* mode)
+{
+    *file = fopen(ToHostPath(filename).c_str(), mode);
+    return *file == nullptr ? errno : 0;
+}
+
+int _wfopen_s(FILE** file, const wchar_t* filename, const wchar_t* mode)
+{
+    // The ccs=... part of the mode selects an encoding, which glibc does not support
+    std::string narrowMode;
+    for (const wchar_t* p = mode; *p != 0 && *p != L','; p++)
+    {
+        narrowMode += (char) *p;
+    }
+
+    *file = fopen(ToHostPath(filename).c_str(), narrowMode.c_str());
+    return *file == nullptr ? errno : 0;
+}
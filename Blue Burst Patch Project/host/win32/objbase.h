@@ -0,0 +1,18 @@
+#pragma once
+
+// Just enough COM to declare the Direct3D 8 interfaces in C style, see CINTERFACE
+#include "windows.h"
+
+#define interface struct
+#define PURE
+#define THIS INTERFACE* This
+#define THIS_ INTERFACE* This,
+#define STDMETHOD(method) HRESULT (STDMETHODCALLTYPE *method)
+#define STDMETHOD_(type, method) type (STDMETHODCALLTYPE *method)
+#define DECLARE_INTERFACE_(iface, base) \
+    typedef struct iface { const struct iface##Vtbl* lpVtbl; } iface; \
+    typedef struct iface##Vtbl iface##Vtbl; \
+    struct iface##Vtbl
+#define DEFINE_GUID(name, ...) extern const GUID name
+
+typedef struct IUnknown IUnknown;
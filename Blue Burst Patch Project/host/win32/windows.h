@@ -0,0 +1,166 @@
+#pragma once
+
+/**
+ * The small part of the Win32 API that the host build needs, implemented in host/win32.cpp.
+ * Everything else is left undeclared so that using it outside psobb.exe fails to compile.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdarg>
+#include <cwchar>
+
+// The calling convention keywords themselves are defined away in host/CMakeLists.txt
+#define WINAPI
+#define APIENTRY
+#define CALLBACK
+#define STDMETHODCALLTYPE
+#define __declspec(x)
+#define __MSABI_LONG(x) x##L
+
+typedef int BOOL;
+typedef int INT;
+typedef unsigned int UINT;
+typedef uint8_t BYTE;
+typedef BYTE BOOLEAN;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef int32_t HRESULT;
+typedef size_t SIZE_T;
+typedef uintptr_t ULONG_PTR;
+typedef intptr_t LONG_PTR;
+typedef float FLOAT;
+typedef char CHAR;
+typedef wchar_t WCHAR;
+typedef void VOID;
+typedef void* LPVOID;
+typedef const void* LPCVOID;
+typedef DWORD* PDWORD;
+typedef DWORD* LPDWORD;
+typedef void* HANDLE;
+typedef void* HMODULE;
+typedef void* HINSTANCE;
+typedef void* HWND;
+typedef void* HDC;
+typedef void* HMONITOR;
+
+typedef union
+{
+    struct
+    {
+        DWORD LowPart;
+        LONG HighPart;
+    };
+    LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef struct
+{
+    DWORD dwLowDateTime;
+    DWORD dwHighDateTime;
+} FILETIME;
+
+typedef struct
+{
+    WORD wYear;
+    WORD wMonth;
+    WORD wDayOfWeek;
+    WORD wDay;
+    WORD wHour;
+    WORD wMinute;
+    WORD wSecond;
+    WORD wMilliseconds;
+} SYSTEMTIME;
+
+typedef struct { LONG left, top, right, bottom; } RECT;
+typedef struct { LONG x, y; } POINT;
+typedef struct { DWORD LowPart; LONG HighPart; } LUID;
+typedef struct { BYTE peRed, peGreen, peBlue, peFlags; } PALETTEENTRY;
+typedef struct { DWORD dwSize; } RGNDATA;
+
+typedef struct _GUID
+{
+    uint32_t Data1;
+    uint16_t Data2;
+    uint16_t Data3;
+    uint8_t Data4[8];
+} GUID, IID;
+typedef const GUID& REFGUID;
+typedef const IID& REFIID;
+
+#define TRUE 1
+#define FALSE 0
+#define S_OK ((HRESULT) 0)
+#define MAKE_HRESULT(s, f, c) ((HRESULT) (((unsigned long) (s) << 31) | ((unsigned long) (f) << 16) | ((unsigned long) (c))))
+#define FAILED(hr) (((HRESULT) (hr)) < 0)
+#define SUCCEEDED(hr) (((HRESULT) (hr)) >= 0)
+
+#define INVALID_HANDLE_VALUE ((HANDLE) -1)
+#define MAXDWORD 0xffffffff
+
+#define PAGE_READONLY 0x02
+#define PAGE_READWRITE 0x04
+#define PAGE_EXECUTE_READWRITE 0x40
+#define MEM_COMMIT 0x1000
+#define MEM_RESERVE 0x2000
+#define MEM_RELEASE 0x8000
+
+// Memory
+LPVOID VirtualAlloc(LPVOID address, SIZE_T size, DWORD allocationType, DWORD protect);
+BOOL VirtualFree(LPVOID address, SIZE_T size, DWORD freeType);
+BOOL VirtualProtect(LPVOID address, SIZE_T size, DWORD newProtect, PDWORD oldProtect);
+HANDLE GetCurrentProcess();
+BOOL FlushInstructionCache(HANDLE process, LPCVOID address, SIZE_T size);
+
+// Files, only opening existing files for reading and mapping them whole is supported
+#define GENERIC_READ 0x80000000
+#define FILE_SHARE_READ 0x01
+#define OPEN_EXISTING 3
+#define FILE_ATTRIBUTE_NORMAL 0x80
+#define INVALID_FILE_ATTRIBUTES ((DWORD) -1)
+#define FILE_MAP_READ 0x04
+HANDLE CreateFileA(const char* filename, DWORD access, DWORD shareMode, void* security, DWORD creation, DWORD flags, HANDLE templateFile);
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size);
+DWORD GetFileAttributesA(const char* filename);
+HANDLE CreateFileMappingA(HANDLE file, void* security, DWORD protect, DWORD maxSizeHigh, DWORD maxSizeLow, const char* name);
+LPVOID MapViewOfFile(HANDLE mapping, DWORD access, DWORD offsetHigh, DWORD offsetLow, SIZE_T size);
+BOOL UnmapViewOfFile(LPCVOID address);
+
+// Time
+BOOL QueryPerformanceCounter(LARGE_INTEGER* count);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency);
+void GetSystemTimeAsFileTime(FILETIME* time);
+BOOL FileTimeToLocalFileTime(const FILETIME* utc, FILETIME* local);
+BOOL FileTimeToSystemTime(const FILETIME* time, SYSTEMTIME* out);
+void Sleep(DWORD milliseconds);
+
+// Threads
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID);
+HANDLE CreateThread(void* attributes, SIZE_T stackSize, LPTHREAD_START_ROUTINE start, LPVOID param, DWORD flags, LPDWORD threadId);
+BOOL CloseHandle(HANDLE handle);
+DWORD GetCurrentThreadId();
+#define INFINITE 0xffffffff
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT 258
+#define WAIT_FAILED ((DWORD) -1)
+/// Only thread handles can be waited on
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds);
+
+/// Zero-initialized like the real one, which the logger relies on
+typedef struct { void* Ptr; } SRWLOCK;
+#define SRWLOCK_INIT {0}
+void AcquireSRWLockExclusive(SRWLOCK* lock);
+BOOLEAN TryAcquireSRWLockExclusive(SRWLOCK* lock);
+void ReleaseSRWLockExclusive(SRWLOCK* lock);
+
+// CRT extensions. Format strings use the MSVC meaning of %s and %S.
+#define _TRUNCATE ((size_t) -1)
+int _snwprintf_s(wchar_t* buffer, size_t size, size_t count, const wchar_t* format, ...);
+int _snprintf_s(char* buffer, size_t size, size_t count, const char* format, ...);
+int fopen_s(FILE** file, const char* filename, const char* mode);
+int _wfopen_s(FILE** file, const wchar_t* filename, const wchar_t* mode);
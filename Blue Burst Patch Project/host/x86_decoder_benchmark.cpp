@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "detour.h"
+#include "x86_decoder.h"
+
+/**
+ * Prints the throughput of X86::Decode over a stream of common instructions
+ * and of Hooking::RelocateCode over function prologues that start with short branches.
+ */
+
+const size_t INSTRUCTION_COUNT = 100000;
+const size_t RUNS = 50;
+const size_t RELOCATIONS = 1000000;
+
+/// What compiled code around hook sites is mostly made of
+const std::vector<std::vector<uint8_t>> INSTRUCTIONS = {
+    {0x55}, // push ebp
+    {0x8b, 0xec}, // mov ebp, esp
+    {0x83, 0xec, 0x10}, // sub esp, 10h
+    {0x8b, 0x45, 0x08}, // mov eax, [ebp+8]
+    {0x8b, 0x44, 0x24, 0x04}, // mov eax, [esp+4]
+    {0x8b, 0x0d, 0x00, 0x10, 0x00, 0x00}, // mov ecx, [1000h]
+    {0xc7, 0x44, 0x24, 0x04, 0x01, 0x00, 0x00, 0x00}, // mov dword [esp+4], 1
+    {0x64, 0xa1, 0x00, 0x00, 0x00, 0x00}, // mov eax, fs:[0]
+    {0xf6, 0x45, 0x08, 0x01}, // test byte [ebp+8], 1
+    {0x0f, 0xb6, 0x45, 0x08}, // movzx eax, byte [ebp+8]
+    {0xd9, 0x45, 0x08}, // fld dword [ebp+8]
+    {0x74, 0x10}, // je rel8
+    {0x0f, 0x84, 0x00, 0x01, 0x00, 0x00}, // je rel32
+    {0xe8, 0x00, 0x01, 0x00, 0x00}, // call rel32
+    {0xc2, 0x08, 0x00}, // ret 8
+};
+
+int main()
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> pick(0, INSTRUCTIONS.size() - 1);
+
+    std::vector<uint8_t> code;
+    for (size_t i = 0; i < INSTRUCTION_COUNT; i++)
+    {
+        const auto& insn = INSTRUCTIONS[pick(rng)];
+        code.insert(code.end(), insn.begin(), insn.end());
+    }
+    // The decoder may read up to an instruction's length past the last one
+    code.resize(code.size() + X86::MAX_INSTRUCTION_LENGTH, 0xcc);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t decoded = 0;
+    for (size_t run = 0; run < RUNS; run++)
+    {
+        size_t offset = 0;
+        for (size_t i = 0; i < INSTRUCTION_COUNT; i++)
+        {
+            offset += X86::Decode(code.data() + offset).length;
+        }
+        decoded += offset;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("Decode:       %8.0f instructions/ms (%zu bytes)\n", double(INSTRUCTION_COUNT * RUNS) / ms, decoded / RUNS);
+
+    // je rel8; push ebp; mov ebp, esp; jmp rel8, the worst case for widening
+    const uint8_t prologue[] = {0x74, 0x40, 0x55, 0x8b, 0xec, 0xeb, 0x40};
+    std::vector<uint8_t> memory(0x100, 0xcc);
+    std::copy(std::begin(prologue), std::end(prologue), memory.begin());
+    size_t length = X86::CoveringLength(memory.data(), sizeof(prologue));
+
+    start = std::chrono::steady_clock::now();
+    size_t written = 0;
+    for (size_t i = 0; i < RELOCATIONS; i++)
+    {
+        written += Hooking::RelocateCode((size_t) memory.data(), length, memory.data() + 0x80);
+    }
+    ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("RelocateCode: %8.0f relocations/ms (%zu bytes to %zu)\n", double(RELOCATIONS) / ms, length, written / RELOCATIONS);
+
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "detour.h"
+#include "x86_decoder.h"
+#include "test.h"
+
+/**
+ * Checks X86::Decode against a corpus of instructions with known lengths,
+ * and that Hooking::RelocateCode keeps relative branches pointing at the same targets.
+ */
+
+using X86::BranchType;
+
+struct Case
+{
+    std::vector<uint8_t> bytes;
+    /// Zero for bytes that must be rejected
+    size_t length;
+    BranchType branchType;
+    size_t displacementSize;
+};
+
+const Case CORPUS[] = {
+    {{0x90}, 1, BranchType::None, 0}, // nop
+    {{0x55}, 1, BranchType::None, 0}, // push ebp
+    {{0x8b, 0xec}, 2, BranchType::None, 0}, // mov ebp, esp
+    {{0x83, 0xec, 0x10}, 3, BranchType::None, 0}, // sub esp, 10h
+    {{0x81, 0xec, 0x00, 0x01, 0x00, 0x00}, 6, BranchType::None, 0}, // sub esp, 100h
+    {{0x66, 0x81, 0xec, 0x00, 0x01}, 5, BranchType::None, 0}, // sub sp, 100h
+    {{0x8b, 0x45, 0x08}, 3, BranchType::None, 0}, // mov eax, [ebp+8]
+    {{0x8b, 0x85, 0x00, 0x01, 0x00, 0x00}, 6, BranchType::None, 0}, // mov eax, [ebp+100h]
+    {{0x8b, 0x04, 0x24}, 3, BranchType::None, 0}, // mov eax, [esp]
+    {{0x8b, 0x44, 0x24, 0x04}, 4, BranchType::None, 0}, // mov eax, [esp+4]
+    {{0x8b, 0x04, 0x85, 0x00, 0x10, 0x00, 0x00}, 7, BranchType::None, 0}, // mov eax, [eax*4+1000h]
+    {{0x8b, 0x0d, 0x00, 0x10, 0x00, 0x00}, 6, BranchType::None, 0}, // mov ecx, [1000h]
+    {{0xc7, 0x44, 0x24, 0x04, 0x01, 0x00, 0x00, 0x00}, 8, BranchType::None, 0}, // mov dword [esp+4], 1
+    {{0x67, 0x8b, 0x46, 0x08}, 4, BranchType::None, 0}, // mov eax, [bp+8]
+    {{0x67, 0x8b, 0x06, 0x00, 0x10}, 5, BranchType::None, 0}, // mov eax, [1000h] with 16-bit addressing
+    {{0xa1, 0x00, 0x10, 0x00, 0x00}, 5, BranchType::None, 0}, // mov eax, [1000h]
+    {{0x67, 0xa1, 0x00, 0x10}, 4, BranchType::None, 0}, // mov eax, [1000h] with 16-bit addressing
+    {{0x64, 0xa1, 0x00, 0x00, 0x00, 0x00}, 6, BranchType::None, 0}, // mov eax, fs:[0]
+    {{0xf6, 0x45, 0x08, 0x01}, 4, BranchType::None, 0}, // test byte [ebp+8], 1
+    {{0xf6, 0x55, 0x08}, 3, BranchType::None, 0}, // not byte [ebp+8]
+    {{0xf7, 0xc0, 0x00, 0x01, 0x00, 0x00}, 6, BranchType::None, 0}, // test eax, 100h
+    {{0x66, 0xf7, 0xc0, 0x00, 0x01}, 5, BranchType::None, 0}, // test ax, 100h
+    {{0xf7, 0xd8}, 2, BranchType::None, 0}, // neg eax
+    {{0xc2, 0x08, 0x00}, 3, BranchType::None, 0}, // ret 8
+    {{0xc8, 0x10, 0x00, 0x00}, 4, BranchType::None, 0}, // enter 10h, 0
+    {{0x9a, 0x00, 0x10, 0x00, 0x00, 0x08, 0x00}, 7, BranchType::None, 0}, // call far 8:1000h
+    {{0xf3, 0xa5}, 2, BranchType::None, 0}, // rep movsd
+    {{0xd9, 0x45, 0x08}, 3, BranchType::None, 0}, // fld dword [ebp+8]
+    {{0x0f, 0xb6, 0x45, 0x08}, 4, BranchType::None, 0}, // movzx eax, byte [ebp+8]
+    {{0x0f, 0xba, 0xe0, 0x03}, 4, BranchType::None, 0}, // bt eax, 3
+    {{0x0f, 0x28, 0x44, 0x24, 0x10}, 5, BranchType::None, 0}, // movaps xmm0, [esp+10h]
+    {{0x66, 0x0f, 0x38, 0x00, 0xc1}, 5, BranchType::None, 0}, // pshufb xmm0, xmm1
+    {{0x66, 0x0f, 0x3a, 0x0f, 0xc1, 0x08}, 6, BranchType::None, 0}, // palignr xmm0, xmm1, 8
+    {{0x74, 0x10}, 2, BranchType::ConditionalJump, 1}, // je rel8
+    {{0x0f, 0x84, 0x00, 0x01, 0x00, 0x00}, 6, BranchType::ConditionalJump, 4}, // je rel32
+    {{0xeb, 0xfe}, 2, BranchType::Jump, 1}, // jmp rel8
+    {{0xe9, 0x00, 0x01, 0x00, 0x00}, 5, BranchType::Jump, 4}, // jmp rel32
+    {{0x66, 0xe9, 0x00, 0x01}, 4, BranchType::Jump, 2}, // jmp rel16
+    {{0xe8, 0x00, 0x01, 0x00, 0x00}, 5, BranchType::Call, 4}, // call rel32
+    {{0xe2, 0xfe}, 2, BranchType::Loop, 1}, // loop rel8
+    {{0xe3, 0x10}, 2, BranchType::Loop, 1}, // jecxz rel8
+    {{0x0f, 0x04}, 0, BranchType::None, 0}, // undefined
+    {{0xc4, 0xc0, 0x00}, 0, BranchType::None, 0}, // VEX prefix, not les
+    {std::vector<uint8_t>(15, 0x66), 0, BranchType::None, 0}, // nothing but prefixes
+    // 14 bytes of prefixes followed by a 2 byte instruction
+    {{0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x3e, 0x8b, 0xc0}, 0, BranchType::None, 0},
+};
+
+void TestCorpus()
+{
+    for (const auto& c : CORPUS)
+    {
+        // Padded so that the decoder never reads past the end
+        std::vector<uint8_t> code(c.bytes);
+        code.resize(X86::MAX_INSTRUCTION_LENGTH + 1, 0xcc);
+
+        auto insn = X86::Decode(code.data());
+        if (!CHECK(insn.length == c.length) ||
+            !CHECK(insn.branchType == c.branchType) ||
+            !CHECK(insn.displacementSize == c.displacementSize))
+        {
+            fprintf(stderr, "  decoded length %zu for", insn.length);
+            for (auto byte : c.bytes) fprintf(stderr, " %02x", byte);
+            fprintf(stderr, "\n");
+        }
+    }
+}
+
+void TestCoveringLength()
+{
+    // push ebp; mov ebp, esp; sub esp, 10h
+    const uint8_t prologue[] = {0x55, 0x8b, 0xec, 0x83, 0xec, 0x10, 0xcc, 0xcc};
+    CHECK(X86::CoveringLength(prologue, 5) == 6);
+    CHECK(X86::CoveringLength(prologue, 3) == 3);
+
+    const uint8_t invalid[] = {0x55, 0x0f, 0x04, 0xcc};
+    CHECK(X86::CoveringLength(invalid, 3) == 0);
+}
+
+/// Relocates code from the start of memory to its middle and checks every instruction against the original
+void TestRelocation()
+{
+    const uint8_t original[] = {
+        0x74, 0x40, // je +40h
+        0x55, // push ebp
+        0x8b, 0xec, // mov ebp, esp
+        0xeb, 0xa0, // jmp -60h
+        0x7f, 0x10, // jg to the first byte after the copied code
+        0xe8, 0x00, 0x02, 0x00, 0x00, // call +200h
+        0x0f, 0x85, 0x00, 0xfe, 0xff, 0xff, // jne -200h
+        0xe9, 0xe7, 0xff, 0xff, 0xff, // jmp to the start of the copied code
+    };
+    const size_t length = sizeof(original);
+
+    // One allocation so that every branch target is within rel32 range of both copies
+    std::vector<uint8_t> memory(0x1000, 0xcc);
+    size_t from = (size_t) memory.data() + 0x400;
+    uint8_t* to = memory.data() + 0x800;
+    memcpy((void*) from, original, length);
+
+    size_t written = Hooking::RelocateCode(from, length, to);
+    CHECK(written <= Hooking::MaxRelocatedSize(length));
+
+    size_t read = 0;
+    size_t out = 0;
+    while (read < length && out < written)
+    {
+        auto before = X86::Decode((const uint8_t*) from + read);
+        auto after = X86::Decode(to + out);
+        CHECK(after.branchType == before.branchType);
+
+        if (before.IsRelativeBranch())
+        {
+            // rel8 is widened to e9 rel32 or 0f 8x rel32
+            CHECK(after.displacementSize == 4);
+            CHECK(after.BranchTarget(to + out, (size_t) to + out) == before.BranchTarget((const uint8_t*) from + read, from + read));
+        }
+        else
+        {
+            CHECK(after.length == before.length);
+            CHECK(memcmp(to + out, (const uint8_t*) from + read, before.length) == 0);
+        }
+
+        if (before.displacementSize == 1 && before.branchType == BranchType::ConditionalJump)
+        {
+            CHECK(to[out] == 0x0f);
+            CHECK(to[out + 1] == (0x80 | (original[read] & 0x0f)));
+        }
+
+        read += before.length;
+        out += after.length;
+    }
+    CHECK(read == length);
+    CHECK(out == written);
+}
+
+bool RelocationThrows(const std::vector<uint8_t>& original)
+{
+    std::vector<uint8_t> memory(0x100, 0xcc);
+    memcpy(memory.data(), original.data(), original.size());
+
+    try
+    {
+        Hooking::RelocateCode((size_t) memory.data(), original.size(), memory.data() + 0x80);
+    }
+    catch (const std::runtime_error&)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+void TestRelocationErrors()
+{
+    // loop has no rel32 form
+    CHECK(RelocationThrows({0x55, 0xe2, 0x10, 0x90, 0x90}));
+    // jmp rel16
+    CHECK(RelocationThrows({0x66, 0xe9, 0x00, 0x01, 0x90}));
+    // Branch into the middle of the copied code
+    CHECK(RelocationThrows({0x74, 0x01, 0x55, 0x8b, 0xec}));
+    // Undecodable
+    CHECK(RelocationThrows({0x0f, 0x04, 0x90, 0x90, 0x90}));
+    CHECK(!RelocationThrows({0x55, 0x8b, 0xec, 0x83, 0xec, 0x10}));
+}
+
+int main()
+{
+    TestCorpus();
+    TestCoveringLength();
+    TestRelocation();
+    TestRelocationErrors();
+
+    return HostTest::Result();
+}
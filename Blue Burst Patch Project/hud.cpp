@@ -0,0 +1,353 @@
+#ifdef PATCH_HUD
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ai_scheduler.h"
+#include "collision.h"
+#include "common.h"
+#include "detour.h"
+#include "entitylist.h"
+#include "ground_cache.h"
+#include "helpers.h"
+#include "hooking.h"
+#include "hud.h"
+#include "keyboard.h"
+#include "navigation.h"
+#include "newgfx/pose_cache.h"
+#include "newgfx/texture_cache.h"
+#include "object_extension.h"
+#include "patching.h"
+#include "profiler.h"
+#include "psobb_functions.h"
+
+namespace Hud
+{
+    /// How many frames the frame time graph shows
+    const size_t GRAPH_LENGTH = 60;
+    /// The text is only rebuilt every this many frames so that it stays readable and cheap
+    const size_t REFRESH_INTERVAL = 15;
+    /// How many hook callbacks are listed when the profiler is enabled
+    const size_t TOP_HISTOGRAM_COUNT = 4;
+    /// Enough for every statistic with all patches compiled in, plus the profiler's lines which are always kept free
+    const size_t STAT_LINES = 12;
+    const size_t MAX_LINES = STAT_LINES + TOP_HISTOGRAM_COUNT;
+    const size_t LINE_LENGTH = 96;
+    const float LEFT = 8.0f;
+    const float TOP = 8.0f;
+    const uint32_t TEXT_COLOR = 0xffffff00;
+    /// Frame time at the top of the graph, two frames at 30 fps
+    const double GRAPH_MAX_MS = 66.7;
+    /// Profiler scope of the drawing and name of the frame callback, which the hook prefixes with its address
+    const char HUD_HISTOGRAM_NAME[] = "HUD";
+
+    bool visible = false;
+    bool deviceHooked = false;
+    bool renderedThisFrame = false;
+
+    uint32_t drawCalls = 0;
+    uint32_t hudDrawCalls = 0;
+    uint32_t lastFrameDrawCalls = 0;
+
+    double frameTimes[GRAPH_LENGTH];
+    size_t nextFrameTime = 0;
+    size_t framesSinceRefresh = 0;
+    LARGE_INTEGER lastFrameStart;
+    LARGE_INTEGER frequency;
+
+    /// All lines separated by newlines so that the HUD is a single render_text call
+    wchar_t text[MAX_LINES * LINE_LENGTH];
+    size_t textLength = 0;
+    size_t lineCount = 0;
+
+    /**
+     * The size of every block allocated since the patch was applied, because the arena's free doesn't get one.
+     * Blocks from before then aren't counted when they're freed. The loader thread may allocate too so the map is locked.
+     */
+    std::unordered_map<void*, uint32_t> arenaBlockSizes;
+    SRWLOCK arenaLock = SRWLOCK_INIT;
+    uint32_t arenaBytesInUse = 0;
+    /// Total ever allocated, for the allocation rate
+    std::atomic<uint32_t> arenaBytesAllocated(0);
+    uint32_t arenaBytesAtRefresh = 0;
+    LARGE_INTEGER lastRefresh;
+    MainArenaAllocFunction originalArenaAlloc = nullptr;
+    MainArenaDeallocFunction originalArenaDealloc = nullptr;
+
+    decltype(IDirect3DDevice8Vtbl::EndScene) originalEndScene = nullptr;
+    decltype(IDirect3DDevice8Vtbl::DrawPrimitive) originalDrawPrimitive = nullptr;
+    decltype(IDirect3DDevice8Vtbl::DrawIndexedPrimitive) originalDrawIndexedPrimitive = nullptr;
+    decltype(IDirect3DDevice8Vtbl::DrawPrimitiveUP) originalDrawPrimitiveUP = nullptr;
+    decltype(IDirect3DDevice8Vtbl::DrawIndexedPrimitiveUP) originalDrawIndexedPrimitiveUP = nullptr;
+
+    void* __cdecl CountingArenaAlloc(size_t size)
+    {
+        void* block = originalArenaAlloc(size);
+
+        if (block != nullptr)
+        {
+            arenaBytesAllocated.fetch_add((uint32_t) size, std::memory_order_relaxed);
+
+            AcquireSRWLockExclusive(&arenaLock);
+            // Replaces the size of a block at the same address that was freed without going through the hook
+            auto& blockSize = arenaBlockSizes[block];
+            arenaBytesInUse += (uint32_t) size - blockSize;
+            blockSize = (uint32_t) size;
+            ReleaseSRWLockExclusive(&arenaLock);
+        }
+
+        return block;
+    }
+
+    void __cdecl CountingArenaDealloc(void* block)
+    {
+        if (block != nullptr)
+        {
+            AcquireSRWLockExclusive(&arenaLock);
+            auto found = arenaBlockSizes.find(block);
+            if (found != arenaBlockSizes.end())
+            {
+                arenaBytesInUse -= found->second;
+                arenaBlockSizes.erase(found);
+            }
+            ReleaseSRWLockExclusive(&arenaLock);
+        }
+
+        originalArenaDealloc(block);
+    }
+
+    HRESULT STDMETHODCALLTYPE CountingDrawPrimitive(IDirect3DDevice8* self, D3DPRIMITIVETYPE type, UINT startVertex, UINT primitiveCount)
+    {
+        drawCalls++;
+        return originalDrawPrimitive(self, type, startVertex, primitiveCount);
+    }
+
+    HRESULT STDMETHODCALLTYPE CountingDrawIndexedPrimitive(IDirect3DDevice8* self, D3DPRIMITIVETYPE type, UINT minIndex, UINT vertexCount, UINT startIndex, UINT primitiveCount)
+    {
+        drawCalls++;
+        return originalDrawIndexedPrimitive(self, type, minIndex, vertexCount, startIndex, primitiveCount);
+    }
+
+    HRESULT STDMETHODCALLTYPE CountingDrawPrimitiveUP(IDirect3DDevice8* self, D3DPRIMITIVETYPE type, UINT primitiveCount, const void* data, UINT stride)
+    {
+        drawCalls++;
+        return originalDrawPrimitiveUP(self, type, primitiveCount, data, stride);
+    }
+
+    HRESULT STDMETHODCALLTYPE CountingDrawIndexedPrimitiveUP(IDirect3DDevice8* self, D3DPRIMITIVETYPE type, UINT minVertexIndex, UINT vertexCount,
+        UINT primitiveCount, const void* indexData, D3DFORMAT indexFormat, const void* data, UINT stride)
+    {
+        drawCalls++;
+        return originalDrawIndexedPrimitiveUP(self, type, minVertexIndex, vertexCount, primitiveCount, indexData, indexFormat, data, stride);
+    }
+
+    /// The game can call EndScene more than once per frame, the HUD is drawn on the first call
+    HRESULT STDMETHODCALLTYPE EndSceneWithHud(IDirect3DDevice8* self)
+    {
+        if (visible && !renderedThisFrame)
+        {
+            PROFILE_SCOPE(HUD_HISTOGRAM_NAME);
+            renderedThisFrame = true;
+            uint32_t drawCallsBefore = drawCalls;
+
+            (*pf_FogEnable_False)();
+            (*pf_render_text)(LEFT, TOP, 0.9999f, TEXT_COLOR, text);
+            (*pf_FogEnable_True)();
+
+            hudDrawCalls = drawCalls - drawCallsBefore;
+        }
+
+        return originalEndScene(self);
+    }
+
+    /// The device does not exist when the patches are applied so its vtable is patched on the first frame
+    void HookDevice()
+    {
+        const IDirect3DDevice8Vtbl* vtbl = (*d3dDevice)->lpVtbl;
+
+        originalEndScene = vtbl->EndScene;
+        originalDrawPrimitive = vtbl->DrawPrimitive;
+        originalDrawIndexedPrimitive = vtbl->DrawIndexedPrimitive;
+        originalDrawPrimitiveUP = vtbl->DrawPrimitiveUP;
+        originalDrawIndexedPrimitiveUP = vtbl->DrawIndexedPrimitiveUP;
+
+        Patching::OwnerScope owner("PATCH_HUD");
+        Patching::Write((size_t) &vtbl->EndScene, &EndSceneWithHud);
+        Patching::Write((size_t) &vtbl->DrawPrimitive, &CountingDrawPrimitive);
+        Patching::Write((size_t) &vtbl->DrawIndexedPrimitive, &CountingDrawIndexedPrimitive);
+        Patching::Write((size_t) &vtbl->DrawPrimitiveUP, &CountingDrawPrimitiveUP);
+        Patching::Write((size_t) &vtbl->DrawIndexedPrimitiveUP, &CountingDrawIndexedPrimitiveUP);
+
+        deviceHooked = true;
+    }
+
+    /// Draws the recent frame times as a row of characters of increasing height
+    void BuildGraph(wchar_t* out)
+    {
+        static const wchar_t levels[] = L" _.-~^";
+        const size_t levelCount = sizeof(levels) / sizeof(levels[0]) - 1;
+
+        for (size_t i = 0; i < GRAPH_LENGTH; i++)
+        {
+            double ms = frameTimes[(nextFrameTime + i) % GRAPH_LENGTH];
+            size_t level = (size_t) (std::min(ms, GRAPH_MAX_MS) / GRAPH_MAX_MS * (levelCount - 1) + 0.5);
+            out[i] = levels[level];
+        }
+
+        out[GRAPH_LENGTH] = 0;
+    }
+
+    void RebuildText()
+    {
+        double total = 0.0;
+        double worst = 0.0;
+        for (double ms : frameTimes)
+        {
+            total += ms;
+            worst = std::max(worst, ms);
+        }
+        double average = total / GRAPH_LENGTH;
+        double latest = frameTimes[(nextFrameTime + GRAPH_LENGTH - 1) % GRAPH_LENGTH];
+
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        double seconds = double(now.QuadPart - lastRefresh.QuadPart) / double(frequency.QuadPart);
+        uint32_t bytesAllocated = arenaBytesAllocated.load(std::memory_order_relaxed);
+        double bytesPerSecond = seconds > 0.0 ? (bytesAllocated - arenaBytesAtRefresh) / seconds : 0.0;
+        arenaBytesAtRefresh = bytesAllocated;
+        lastRefresh = now;
+
+        AcquireSRWLockExclusive(&arenaLock);
+        size_t blocks = arenaBlockSizes.size();
+        uint32_t bytesInUse = arenaBytesInUse;
+        ReleaseSRWLockExclusive(&arenaLock);
+
+        textLength = 0;
+        lineCount = 0;
+        size_t lineLimit = STAT_LINES;
+        auto addLine = [&lineLimit](const wchar_t* fmt, auto... args) {
+            if (lineCount >= lineLimit) return;
+            // A line takes at most LINE_LENGTH characters with its newline, so text never fills up
+            if (lineCount > 0) text[textLength++] = L'\n';
+            int written = _snwprintf_s(text + textLength, LINE_LENGTH - 1, _TRUNCATE, fmt, args...);
+            textLength += written < 0 ? LINE_LENGTH - 2 : written;
+            lineCount++;
+        };
+
+        addLine(L"Frame %.1f ms (%.0f fps), avg %.1f ms, max %.1f ms",
+            latest, latest > 0.0 ? 1000.0 / latest : 0.0, average, worst);
+
+        if (lineCount < lineLimit)
+        {
+            text[textLength++] = L'\n';
+            BuildGraph(text + textLength);
+            textLength += GRAPH_LENGTH;
+            lineCount++;
+        }
+
+        addLine(L"Draw calls %u", lastFrameDrawCalls);
+        addLine(L"Players %u, enemies %u, objects %u", *EntityList::playerCount, *EntityList::enemyCount, *EntityList::objectCount);
+        addLine(L"Main arena %.0f KB in %u blocks, %.0f KB/s allocated", bytesInUse / 1024.0, (unsigned) blocks, bytesPerSecond / 1024.0);
+
+#ifdef PATCH_COLLISION_BROADPHASE
+        addLine(L"Collision pair tests %u (%S)", Collision::PairTestsLastFrame(),
+            Collision::BroadphaseEnabled() ? "broadphase" : "all pairs");
+#endif
+
+#ifdef PATCH_GROUND_CACHE
+        addLine(L"Ground cache %u hits, %u misses (%S)", GroundCache::HitsLastFrame(), GroundCache::MissesLastFrame(),
+            GroundCache::CacheEnabled() ? "on" : "off");
+#endif
+
+#ifdef PATCH_NAVIGATION
+        addLine(L"Flow fields %u, %u computed", (unsigned) Navigation::FieldCount(), Navigation::FieldsComputedLastFrame());
+#endif
+
+#ifdef PATCH_AI_SCHEDULER
+        addLine(L"AI thinks %u, deferred %u", AiScheduler::ThinksLastFrame(), AiScheduler::DeferralsLastFrame());
+#endif
+
+#ifdef PATCH_POSE_CACHE
+        {
+            auto hits = PoseCache::HitsLastFrame();
+            auto lookups = hits + PoseCache::MissesLastFrame();
+            addLine(L"Pose cache %u/%u hits (%.0f%%), quantum %u", hits, lookups,
+                lookups > 0 ? 100.0 * hits / lookups : 0.0, (unsigned) PoseCache::Quantum());
+        }
+#endif
+
+#ifdef USE_NEWGFX
+        addLine(L"Textures %u, %.1f MB", (unsigned) TextureCache::TextureCount(), TextureCache::TotalBytes() / (1024.0 * 1024.0));
+#endif
+
+#ifdef PATCH_PROFILER
+        lineLimit = MAX_LINES;
+        std::vector<std::pair<double, const Profiler::Histogram*>> slowest;
+        for (const auto& histogram : Profiler::Histograms())
+        {
+            // The HUD should not list itself, neither its drawing nor its afterSceneUpdate callback, "Hook(7a5f23) HUD"
+            const auto& name = histogram.Name();
+            if (name == HUD_HISTOGRAM_NAME || name.ends_with(std::string(" ") + HUD_HISTOGRAM_NAME)) continue;
+            slowest.emplace_back(histogram.Summarize().p50, &histogram);
+        }
+
+        size_t shown = std::min(slowest.size(), TOP_HISTOGRAM_COUNT);
+        std::partial_sort(slowest.begin(), slowest.begin() + shown, slowest.end(), [](const auto& a, const auto& b) {
+            return a.first > b.first;
+        });
+
+        for (size_t i = 0; i < shown; i++)
+        {
+            addLine(L"%.1f us  %S", slowest[i].first, slowest[i].second->Name().c_str());
+        }
+#endif
+    }
+
+    void __cdecl OnFrameEnd(void*)
+    {
+        if (!deviceHooked && *d3dDevice != nullptr) HookDevice();
+
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        frameTimes[nextFrameTime] = double(now.QuadPart - lastFrameStart.QuadPart) * 1000.0 / double(frequency.QuadPart);
+        nextFrameTime = (nextFrameTime + 1) % GRAPH_LENGTH;
+        lastFrameStart = now;
+
+        lastFrameDrawCalls = drawCalls - hudDrawCalls;
+        drawCalls = 0;
+        hudDrawCalls = 0;
+        renderedThisFrame = false;
+
+        if (visible && ++framesSinceRefresh >= REFRESH_INTERVAL)
+        {
+            framesSinceRefresh = 0;
+            RebuildText();
+        }
+    }
+
+    void ApplyHudPatch()
+    {
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&lastFrameStart);
+        lastRefresh = lastFrameStart;
+
+        originalArenaAlloc = Hooking::CreateDetour(0x005caba4, CountingArenaAlloc);
+        originalArenaDealloc = Hooking::CreateDetour(0x005c2f74, CountingArenaDealloc);
+
+        Hooking::afterSceneUpdate.AddCallback(OnFrameEnd, nullptr, HUD_HISTOGRAM_NAME);
+
+        Keyboard::onKeyDown({Keyboard::Keycode::Ctrl, Keyboard::Keycode::H}, []() {
+            visible = !visible;
+            if (visible)
+            {
+                RebuildText();
+                framesSinceRefresh = 0;
+            }
+        });
+    }
+};
+
+#endif // PATCH_HUD
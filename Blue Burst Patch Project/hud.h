@@ -0,0 +1,10 @@
+#pragma once
+
+/**
+ * On-screen overlay with frame time, draw calls, entity counts, main arena usage
+ * and the most expensive hook callbacks when the profiler is enabled. Toggled with Ctrl+H.
+ */
+namespace Hud
+{
+    void ApplyHudPatch();
+};
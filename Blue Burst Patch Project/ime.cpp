@@ -1,6 +1,7 @@
 #ifdef PATCH_IME
 
 #include "ime.h"
+#include "patching.h"
 
 void PatchIme()
 {
@@ -9,7 +10,7 @@ void PatchIme()
 
     if (reg_ImeEnabled != 1)
     {
-        *(int*)addrImeCall = valImePatch;
+        Patching::Write<int>(addrImeCall, valImePatch);
     }
 }
 
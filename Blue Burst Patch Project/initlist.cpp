@@ -5,6 +5,8 @@
 #include <stdexcept>
 #include <sstream>
 #include "initlist.h"
+#include "patching.h"
+#include "trace.h"
 
 std::map<const InitList::FunctionPair*, std::unique_ptr<InitList>> InitList::initLists;
 bool InitList::patchApplied = false;
@@ -150,6 +152,17 @@ void InitList::AddFunctionPair(const FunctionPair&& funcPair)
     AddFunctionPair(funcPair);
 }
 
+void InitList::PrependFunctionPair(const FunctionPair& funcPair)
+{
+    // Check duplicate
+    for (const FunctionPair& existing : functionPairs)
+    {
+        if (existing.init == funcPair.init) return;
+    }
+
+    functionPairs.insert(functionPairs.begin(), funcPair);
+}
+
 void InitList::SetNullTerminated(bool option)
 {
     nullTerminated = option;
@@ -175,7 +188,14 @@ bool InitList::HasChanged()
 
 void InitList::Patch()
 {
-    if (!HasChanged())
+#ifdef PATCH_TRACING
+    // Every function gets wrapped in a trace zone which means the list must be rewritten even if nothing else changed
+    bool mustRewrite = !listReferenceAddresses.empty();
+#else
+    bool mustRewrite = false;
+#endif
+
+    if (!HasChanged() && !mustRewrite)
     {
         // Nothing to do
         return;
@@ -199,7 +219,7 @@ void InitList::Patch()
     size_t byteSize = pairCount * sizeof(FunctionPair);
     for (SizeRefValueType* address : sizeReferenceAddresses)
     {
-        *address = (SizeRefValueType) byteSize;
+        Patching::Write((size_t) address, (SizeRefValueType) byteSize);
     }
 
     size_t newListLength = functionPairs.size();
@@ -215,6 +235,14 @@ void InitList::Patch()
     FunctionPair* listCopy = new FunctionPair[newListLength];
     std::copy(functionPairs.begin(), functionPairs.end(), listCopy);
 
+#ifdef PATCH_TRACING
+    for (size_t i = 0; i < functionPairs.size(); i++)
+    {
+        listCopy[i].init = WrapWithTraceZone(listCopy[i].init, "init");
+        listCopy[i].uninit = WrapWithTraceZone(listCopy[i].uninit, "uninit");
+    }
+#endif
+
     if (nullTerminated)
     {
         // Append null terminator
@@ -224,7 +252,7 @@ void InitList::Patch()
     // Rewrite initlist references
     for (FunctionPair** address : listReferenceAddresses)
     {
-        *address = listCopy;
+        Patching::Write((size_t) address, listCopy);
     }
 }
 
@@ -246,6 +274,17 @@ void InitList::PatchAllInitLists()
     patchApplied = true;
 }
 
+#ifdef PATCH_TRACING
+InitList::Function InitList::WrapWithTraceZone(Function func, const char* kind)
+{
+    if (func == nullptr) return nullptr;
+
+    std::stringstream name;
+    name << toString() << " " << kind << " " << std::hex << (size_t) func;
+    return Tracing::WrapFunction(func, Tracing::PersistentName(name.str()));
+}
+#endif
+
 std::string InitList::toString()
 {
     std::stringstream sstream;
@@ -36,8 +36,6 @@ public:
     static const size_t MAX_FN_PAIR_COUNT = sizeof(SizeRefValueType) * 0xff / sizeof(FunctionPair);
 
 private:
-    friend void PSOBB();
-
     static std::map<const FunctionPair*, std::unique_ptr<InitList>> initLists;
     static bool patchApplied;
     static const FunctionPair nullTerminator;
@@ -50,9 +48,11 @@ private:
     std::vector<FunctionPair> functionPairs;
     bool nullTerminated;
 
-    static void PatchAllInitLists();
     bool HasChanged();
     void Patch();
+#ifdef PATCH_TRACING
+    Function WrapWithTraceZone(Function func, const char* kind);
+#endif
 
     InitList(const FunctionPair* listStart, const FunctionPair* listEnd);
     InitList(const FunctionPair* listStart);
@@ -76,6 +76,8 @@ public:
     /// The pair will not be added if the first function of the pair already exists in the list.
     void AddFunctionPair(const FunctionPair& funcPair);
     void AddFunctionPair(const FunctionPair&& funcPair);
+    /// Like AddFunctionPair, but the pair runs before every pair that is already in the list.
+    void PrependFunctionPair(const FunctionPair& funcPair);
 
     /// Should terminate list with a null element?
     void SetNullTerminated(bool);
@@ -91,6 +93,9 @@ public:
     static InitList& GetNullTerminatedInitList(size_t listStartAddr);
     static InitList& GetNullTerminatedInitList(const FunctionPair* listStart);
 
+    /// Writes every modified initlist and the references to it. Only once, after every patch is done with its lists.
+    static void PatchAllInitLists();
+
     std::string toString();
 };
 
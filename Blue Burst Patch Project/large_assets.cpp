@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <vector>
 #include "large_assets.h"
+#include "patching.h"
 
 void ApplyLargeAssetsPatch()
 {
@@ -31,7 +32,7 @@ void ApplyLargeAssetsPatch()
 
     for (auto addr : addrs)
     {
-        *(uint32_t*) addr = newsize;
+        Patching::Write(addr, newsize);
     }
 }
 
@@ -0,0 +1,161 @@
+#include <atomic>
+#include <cstdio>
+#include "bounded_queue.h"
+#include "logger.h"
+
+namespace Logging
+{
+    /// Longest line that will be written, including the timestamp
+    const size_t MAX_LINE_LENGTH = 1024;
+    /// Lines are collected here and written into the file with one call
+    const size_t BATCH_LENGTH = 64 * 1024;
+    /// How long the writer thread sleeps when there is nothing to write
+    const DWORD WRITER_IDLE_MS = 50;
+
+    BoundedQueue<Message, QUEUE_CAPACITY> queue;
+    /// Only touched by whoever holds consumerLock, which makes them the single consumer of the queue
+    SRWLOCK consumerLock = SRWLOCK_INIT;
+
+    std::atomic<uint32_t> droppedCount(0);
+    uint32_t reportedDroppedCount = 0;
+    std::atomic<bool> writerStarted(false);
+
+    FILE* logFile = nullptr;
+    WCHAR batch[BATCH_LENGTH];
+    size_t batchUsed = 0;
+
+    DWORD WINAPI WriterThread(LPVOID);
+
+    Message* Reserve()
+    {
+        if (!writerStarted.load(std::memory_order_relaxed) && !writerStarted.exchange(true))
+        {
+            // If this happens while the loader lock is held the thread starts running after it has been released
+            HANDLE thread = CreateThread(nullptr, 0, WriterThread, nullptr, 0, nullptr);
+            if (thread != nullptr) CloseHandle(thread);
+        }
+
+        Message* message = queue.Reserve();
+        if (message == nullptr)
+        {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return message;
+    }
+
+    void Publish(Message* message)
+    {
+        queue.Publish(message);
+    }
+
+    uint32_t DroppedCount()
+    {
+        return droppedCount.load(std::memory_order_relaxed);
+    }
+
+    void WriteBatch()
+    {
+        if (batchUsed == 0) return;
+
+        if (logFile == nullptr)
+        {
+            _wfopen_s(&logFile, L"log\\dll.log", L"a, ccs=UTF-16LE");
+        }
+
+        // Lines are lost if the file can't be opened, same as before
+        if (logFile != nullptr)
+        {
+            fputws(batch, logFile);
+            fflush(logFile);
+        }
+
+        batchUsed = 0;
+    }
+
+    void AppendLine(uint64_t timestamp, const WCHAR* text)
+    {
+        if (BATCH_LENGTH - batchUsed < MAX_LINE_LENGTH) WriteBatch();
+
+        FILETIME utc, local;
+        SYSTEMTIME time;
+        utc.dwLowDateTime = (DWORD) timestamp;
+        utc.dwHighDateTime = (DWORD) (timestamp >> 32);
+        FileTimeToLocalFileTime(&utc, &local);
+        FileTimeToSystemTime(&local, &time);
+
+        int written = _snwprintf_s(batch + batchUsed, MAX_LINE_LENGTH, _TRUNCATE,
+            L"[%02u-%02u-%u, %02u:%02u:%02u] %s\n",
+            time.wMonth,
+            time.wDay,
+            time.wYear,
+            time.wHour,
+            time.wMinute,
+            time.wSecond,
+            text);
+
+        // Truncated lines still end up terminated, just without the newline
+        batchUsed += written >= 0 ? written : wcslen(batch + batchUsed);
+    }
+
+    /// Formats and writes everything in the queue while holding consumerLock. Returns the number of messages written.
+    size_t WriteQueuedLocked()
+    {
+        size_t count = 0;
+        WCHAR text[MAX_LINE_LENGTH];
+
+        uint32_t dropped = droppedCount.load(std::memory_order_relaxed);
+        if (dropped != reportedDroppedCount)
+        {
+            _snwprintf_s(text, MAX_LINE_LENGTH, _TRUNCATE, L"Logging: Dropped %u messages because the queue was full", dropped - reportedDroppedCount);
+            AppendLine(CurrentTimestamp(), text);
+            reportedDroppedCount = dropped;
+        }
+
+        while (Message* message = queue.Peek())
+        {
+            message->formatter(message->format, message->payload, text, MAX_LINE_LENGTH);
+            AppendLine(message->timestamp, text);
+            queue.Pop();
+            count++;
+        }
+
+        WriteBatch();
+        return count;
+    }
+
+    size_t WriteQueued()
+    {
+        AcquireSRWLockExclusive(&consumerLock);
+        size_t count = WriteQueuedLocked();
+        ReleaseSRWLockExclusive(&consumerLock);
+        return count;
+    }
+
+    DWORD WINAPI WriterThread(LPVOID)
+    {
+        while (true)
+        {
+            if (WriteQueued() == 0)
+            {
+                Sleep(WRITER_IDLE_MS);
+            }
+        }
+
+        return 0;
+    }
+
+    void Flush()
+    {
+        WriteQueued();
+    }
+
+    bool TryFlush()
+    {
+        if (!TryAcquireSRWLockExclusive(&consumerLock)) return false;
+
+        WriteQueuedLocked();
+        ReleaseSRWLockExclusive(&consumerLock);
+        return true;
+    }
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <tuple>
+#include <type_traits>
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+/**
+ * Log messages are not formatted by the thread that logs them.
+ * The format string pointer and the raw arguments are copied into a bounded queue
+ * and a background thread formats them and writes them into the log file in batches.
+ * If the queue is full the message is dropped and counted instead of blocking the caller.
+ */
+namespace Logging
+{
+    /// How many messages can be waiting to be written. Must be a power of two.
+    const size_t QUEUE_CAPACITY = 1024;
+    /// Space for the arguments of one message. Longer strings are truncated.
+    const size_t PAYLOAD_SIZE = 232;
+
+    typedef void (*FormatFn)(const WCHAR* format, const uint8_t* payload, WCHAR* out, size_t outSize);
+
+    struct Message
+    {
+        /// FILETIME of when the message was logged
+        uint64_t timestamp;
+        /// Must point to a string with static storage duration, i.e. a literal
+        const WCHAR* format;
+        FormatFn formatter;
+        uint8_t payload[PAYLOAD_SIZE];
+    };
+
+    /**
+     * @brief Reserves a free message in the queue.
+     * Returns null and counts the message as dropped if the queue is full.
+     * The message must be handed back with Publish.
+     */
+    Message* Reserve();
+    void Publish(Message* message);
+
+    /// Writes every queued message on the calling thread. Useful right before the process is about to die.
+    void Flush();
+
+    /**
+     * @brief Like Flush, but writes nothing and returns false if the writer thread holds the queue.
+     * For when the DLL is unloaded, the writer thread can't finish while the loader lock is held.
+     */
+    bool TryFlush();
+
+    /// Number of messages dropped since the start because the queue was full
+    uint32_t DroppedCount();
+
+    /// How an argument of type T is stored in the payload
+    template<typename T, typename = void>
+    struct ArgCodec
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Log arguments must be trivially copyable");
+
+        static uint8_t* Encode(uint8_t* cursor, uint8_t* end, T value)
+        {
+            if (cursor + sizeof(T) > end) return end;
+            memcpy(cursor, &value, sizeof(T));
+            return cursor + sizeof(T);
+        }
+
+        static T Decode(const uint8_t*& cursor, const uint8_t* end)
+        {
+            T value{};
+            if (cursor + sizeof(T) <= end) memcpy(&value, cursor, sizeof(T));
+            cursor += sizeof(T);
+            return value;
+        }
+    };
+
+    /// Strings are copied because the pointer might not be valid anymore when the message is formatted
+    template<typename Char>
+    struct StringCodec
+    {
+        static uint8_t* Encode(uint8_t* cursor, uint8_t* end, const Char* str)
+        {
+            size_t room = (end - cursor) / sizeof(Char);
+            if (room == 0) return end;
+
+            if (str == nullptr) str = std::is_same_v<Char, char> ? (const Char*) "(null)" : (const Char*) L"(null)";
+
+            size_t length = 0;
+            while (length + 1 < room && str[length] != 0) length++;
+
+            memcpy(cursor, str, length * sizeof(Char));
+            memset(cursor + length * sizeof(Char), 0, sizeof(Char));
+            return cursor + (length + 1) * sizeof(Char);
+        }
+
+        static const Char* Decode(const uint8_t*& cursor, const uint8_t* end)
+        {
+            auto str = reinterpret_cast<const Char*>(cursor);
+            if (cursor >= end) return std::is_same_v<Char, char> ? (const Char*) "" : (const Char*) L"";
+
+            while (cursor < end && *reinterpret_cast<const Char*>(cursor) != 0) cursor += sizeof(Char);
+            cursor += sizeof(Char);
+            return str;
+        }
+    };
+
+    template<typename T>
+    struct ArgCodec<T, std::enable_if_t<std::is_same_v<T, const char*> || std::is_same_v<T, char*>>> : StringCodec<char> {};
+
+    template<typename T>
+    struct ArgCodec<T, std::enable_if_t<std::is_same_v<T, const wchar_t*> || std::is_same_v<T, wchar_t*>>> : StringCodec<wchar_t> {};
+
+    template<typename T>
+    using DecodedType = decltype(ArgCodec<T>::Decode(std::declval<const uint8_t*&>(), nullptr));
+
+    /// Instantiated for every combination of argument types, runs on the writer thread
+    template<typename... Args>
+    void FormatArgs(const WCHAR* format, const uint8_t* payload, WCHAR* out, size_t outSize)
+    {
+        const uint8_t* cursor = payload;
+        const uint8_t* end = payload + PAYLOAD_SIZE;
+        // Braced initialization guarantees left to right evaluation
+        std::tuple<DecodedType<Args>...> args{ArgCodec<Args>::Decode(cursor, end)...};
+
+        std::apply([&](auto... values) {
+            _snwprintf_s(out, outSize, _TRUNCATE, format, values...);
+        }, args);
+    }
+
+    inline uint64_t CurrentTimestamp()
+    {
+        FILETIME now;
+        GetSystemTimeAsFileTime(&now);
+        return ((uint64_t) now.dwHighDateTime << 32) | now.dwLowDateTime;
+    }
+};
+
+/**
+ * @brief Queues a printf-style message to be written into log\dll.log.
+ * Cheap enough to be called every frame. The format string must be a literal.
+ */
+template<typename... Args>
+void Log(const WCHAR* fmt, Args... args)
+{
+    Logging::Message* message = Logging::Reserve();
+    if (message == nullptr) return;
+
+    message->timestamp = Logging::CurrentTimestamp();
+    message->format = fmt;
+    message->formatter = Logging::FormatArgs<Args...>;
+
+    uint8_t* cursor = message->payload;
+    uint8_t* end = message->payload + Logging::PAYLOAD_SIZE;
+    ((cursor = Logging::ArgCodec<Args>::Encode(cursor, end, args)), ...);
+
+    Logging::Publish(message);
+}
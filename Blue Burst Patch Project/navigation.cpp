@@ -0,0 +1,296 @@
+#ifdef PATCH_NAVIGATION
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "common.h"
+#include "hooking.h"
+#include "map.h"
+#include "navigation.h"
+
+namespace Navigation
+{
+    /// Horizontal size of a grid cell, about the width of an enemy
+    const float CELL_SIZE = 5.0f;
+    /// Cells along each side of a field, which is centered on the target
+    const int32_t FIELD_SIZE = 64;
+    /// Largest height difference between neighboring cells that can be walked over
+    const float MAX_STEP = 10.0f;
+    /// What custom enemies pass to GetGround
+    const uint32_t GROUND_MASK = 0x15;
+    /// Raycasts allowed per frame across all fields
+    const size_t SAMPLE_BUDGET = 256;
+    /// Fields that have not been asked for in this many frames are freed
+    const uint32_t FIELD_LIFETIME = 120;
+
+    const int32_t STRAIGHT_COST = 10;
+    const int32_t DIAGONAL_COST = 14;
+
+    /// Neighbors of a cell, straight ones first, then diagonals
+    const int32_t NEIGHBOR_X[8] = {1, 0, -1, 0, 1, -1, -1, 1};
+    const int32_t NEIGHBOR_Z[8] = {0, 1, 0, -1, 1, 1, -1, -1};
+    /// The neighbor in the opposite direction of each neighbor
+    const uint8_t OPPOSITE[8] = {2, 3, 0, 1, 6, 7, 4, 5};
+
+    /// Direction of the target's own cell
+    const uint8_t AT_TARGET = 8;
+    /// Direction of cells that the field did not reach
+    const uint8_t UNREACHED = 0xff;
+
+    enum class CellState : uint8_t
+    {
+        Walkable,
+        Blocked
+    };
+
+    struct NavCell
+    {
+        CellState state;
+        float height;
+    };
+
+    struct Field
+    {
+        /// Cell coordinates of the field's first cell
+        int32_t originX = 0;
+        int32_t originZ = 0;
+        /// False if the field ran out of raycasts before reaching every cell it could
+        bool complete = false;
+        uint32_t computedFrame = 0;
+        uint32_t usedFrame = 0;
+        /// Index of the neighbor to walk to from each cell, rows are stored one after another
+        uint8_t direction[FIELD_SIZE * FIELD_SIZE];
+    };
+
+    /// Sampled cells of every map section and height band
+    std::unordered_map<uint64_t, NavCell> navCells;
+    std::unordered_map<uint32_t, std::unique_ptr<Field>> fields;
+
+    Map::MapType cachedMap = (Map::MapType) 0;
+    void* cachedMeshes = nullptr;
+
+    size_t samplesLeft = SAMPLE_BUDGET;
+    /// Starts at 1 so that new fields never look like they were computed during the current frame
+    uint32_t frame = 1;
+    uint32_t fieldsComputed = 0;
+    uint32_t fieldsComputedLastFrame = 0;
+
+    std::vector<int32_t> costScratch;
+    std::vector<float> heightScratch;
+
+    size_t FieldCount()
+    {
+        return fields.size();
+    }
+
+    uint32_t FieldsComputedLastFrame()
+    {
+        return fieldsComputedLastFrame;
+    }
+
+    int32_t CellCoordinate(float worldCoordinate)
+    {
+        return (int32_t) std::floor(worldCoordinate / CELL_SIZE);
+    }
+
+    float CellCenter(int32_t cellCoordinate)
+    {
+        return (float(cellCoordinate) + 0.5f) * CELL_SIZE;
+    }
+
+    /**
+     * Raycasts from origins in different bands can hit different floors in the same column, like a bridge and the path under it,
+     * so each band gets its own cells. Origins in the same band are less than a step apart.
+     */
+    int32_t HeightBand(float originY)
+    {
+        return (int32_t) std::floor(originY / MAX_STEP);
+    }
+
+    /// Coordinates and bands are truncated to 16 bits, which is far more than any map needs
+    uint64_t CellKey(uint16_t mapSection, int32_t cellX, int32_t cellZ, int32_t heightBand)
+    {
+        return (uint64_t) (uint16_t) cellX | (uint64_t) (uint16_t) cellZ << 16 | (uint64_t) (uint16_t) heightBand << 32 |
+            (uint64_t) mapSection << 48;
+    }
+
+    /// Returns nullptr if the cell has not been sampled and there are no raycasts left this frame
+    const NavCell* Sample(uint16_t mapSection, int32_t cellX, int32_t cellZ, float originY)
+    {
+        uint64_t key = CellKey(mapSection, cellX, cellZ, HeightBand(originY));
+        auto found = navCells.find(key);
+        if (found != navCells.end()) return &found->second;
+
+        if (samplesLeft == 0) return nullptr;
+        samplesLeft--;
+
+        Vec3f origin{CellCenter(cellX), originY, CellCenter(cellZ)};
+        Ground* ground = GetGround(&origin, GROUND_MASK);
+
+        NavCell cell;
+        cell.state = ground != nullptr && ground->position != nullptr ? CellState::Walkable : CellState::Blocked;
+        cell.height = cell.state == CellState::Walkable ? ground->position->y : 0.0f;
+        return &navCells.emplace(key, cell).first->second;
+    }
+
+    /// Dijkstra outwards from the target, every reached cell points to the neighbor it was reached from
+    void Compute(Field& field, uint16_t mapSection, const Vec3f& targetPosition)
+    {
+        int32_t targetX = CellCoordinate(targetPosition.x);
+        int32_t targetZ = CellCoordinate(targetPosition.z);
+
+        field.originX = targetX - FIELD_SIZE / 2;
+        field.originZ = targetZ - FIELD_SIZE / 2;
+        field.complete = true;
+        field.computedFrame = frame;
+        std::fill(std::begin(field.direction), std::end(field.direction), UNREACHED);
+
+        costScratch.assign(FIELD_SIZE * FIELD_SIZE, INT_MAX);
+        heightScratch.assign(FIELD_SIZE * FIELD_SIZE, 0.0f);
+
+        typedef std::pair<int32_t, int32_t> QueueEntry;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+        // The target is where it is regardless of what the grid thinks of its cell
+        int32_t start = (targetZ - field.originZ) * FIELD_SIZE + (targetX - field.originX);
+        costScratch[start] = 0;
+        heightScratch[start] = targetPosition.y;
+        field.direction[start] = AT_TARGET;
+        queue.push(QueueEntry(0, start));
+
+        // Looks up a neighbor and whether it can be stepped to from the given height
+        auto walkableFrom = [&](int32_t x, int32_t z, float height, const NavCell*& cell) {
+            cell = Sample(mapSection, field.originX + x, field.originZ + z, height + MAX_STEP);
+            if (cell == nullptr)
+            {
+                field.complete = false;
+                return false;
+            }
+
+            return cell->state == CellState::Walkable && std::fabs(cell->height - height) <= MAX_STEP;
+        };
+
+        while (!queue.empty())
+        {
+            auto current = queue.top();
+            queue.pop();
+
+            int32_t index = current.second;
+            if (current.first > costScratch[index]) continue;
+
+            int32_t x = index % FIELD_SIZE;
+            int32_t z = index / FIELD_SIZE;
+            float height = heightScratch[index];
+
+            for (uint8_t neighbor = 0; neighbor < 8; neighbor++)
+            {
+                int32_t nx = x + NEIGHBOR_X[neighbor];
+                int32_t nz = z + NEIGHBOR_Z[neighbor];
+                if (nx < 0 || nz < 0 || nx >= FIELD_SIZE || nz >= FIELD_SIZE) continue;
+
+                bool diagonal = neighbor >= 4;
+                int32_t cost = current.first + (diagonal ? DIAGONAL_COST : STRAIGHT_COST);
+                int32_t neighborIndex = nz * FIELD_SIZE + nx;
+                if (cost >= costScratch[neighborIndex]) continue;
+
+                const NavCell* cell;
+                if (!walkableFrom(nx, nz, height, cell)) continue;
+
+                // Don't cut corners
+                if (diagonal)
+                {
+                    const NavCell* side;
+                    if (!walkableFrom(nx, z, height, side) || !walkableFrom(x, nz, height, side)) continue;
+                }
+
+                costScratch[neighborIndex] = cost;
+                heightScratch[neighborIndex] = cell->height;
+                field.direction[neighborIndex] = OPPOSITE[neighbor];
+                queue.push(QueueEntry(cost, neighborIndex));
+            }
+        }
+
+        fieldsComputed++;
+    }
+
+    void InvalidateIfMapChanged()
+    {
+        if (GetCurrentMap() != cachedMap || *collisionMeshes != cachedMeshes)
+        {
+            navCells.clear();
+            fields.clear();
+            cachedMap = GetCurrentMap();
+            cachedMeshes = *collisionMeshes;
+        }
+    }
+
+    bool NextWaypoint(Entity::EntityIndex target, uint16_t mapSection, const Vec3f& targetPosition, const Vec3f& position, Vec3f& waypoint)
+    {
+        InvalidateIfMapChanged();
+
+        auto& field = fields[(uint32_t) (uint16_t) target << 16 | mapSection];
+        if (!field) field.reset(new Field());
+
+        int32_t targetX = CellCoordinate(targetPosition.x);
+        int32_t targetZ = CellCoordinate(targetPosition.z);
+        bool targetMoved = targetX != field->originX + FIELD_SIZE / 2 || targetZ != field->originZ + FIELD_SIZE / 2;
+
+        // Once per frame at most, every enemy chasing the target asks for it
+        if (field->computedFrame != frame && (targetMoved || !field->complete))
+        {
+            Compute(*field, mapSection, targetPosition);
+        }
+
+        field->usedFrame = frame;
+
+        int32_t x = CellCoordinate(position.x) - field->originX;
+        int32_t z = CellCoordinate(position.z) - field->originZ;
+        if (x < 0 || z < 0 || x >= FIELD_SIZE || z >= FIELD_SIZE) return false;
+
+        uint8_t direction = field->direction[z * FIELD_SIZE + x];
+        if (direction == UNREACHED) return false;
+
+        if (direction == AT_TARGET)
+        {
+            waypoint = targetPosition;
+        }
+        else
+        {
+            waypoint = Vec3f{
+                CellCenter(field->originX + x + NEIGHBOR_X[direction]),
+                position.y,
+                CellCenter(field->originZ + z + NEIGHBOR_Z[direction])
+            };
+        }
+
+        return true;
+    }
+
+    void __cdecl OnFrameEnd(void*)
+    {
+        for (auto it = fields.begin(); it != fields.end();)
+        {
+            if (frame - it->second->usedFrame > FIELD_LIFETIME) it = fields.erase(it);
+            else it++;
+        }
+
+        fieldsComputedLastFrame = fieldsComputed;
+        fieldsComputed = 0;
+        samplesLeft = SAMPLE_BUDGET;
+        frame++;
+    }
+
+    void ApplyNavigationPatch()
+    {
+        Hooking::afterSceneUpdate.AddCallback(OnFrameEnd, nullptr, "Navigation");
+    }
+};
+
+#endif // PATCH_NAVIGATION
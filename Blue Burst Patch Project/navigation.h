@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "entity.h"
+#include "mathutil.h"
+
+/**
+ * Flow fields for enemies that chase a target around obstacles.
+ * Walkability of each map section is sampled from GetGround into a coarse grid as fields reach new cells, and kept until the map changes.
+ * Cells are sampled per height band so that floors above each other stay apart.
+ * A field is computed once per target and map section around the target, so every enemy chasing the same target shares it,
+ * and is only computed again when the target moves to another cell.
+ * Raycasts are limited per frame. A field that ran out of them is finished during later frames, and enemies that it
+ * has not reached yet get no direction in the meantime.
+ */
+namespace Navigation
+{
+    /**
+     * @brief Finds where to walk next to get to the target.
+     * @param target Entity index of the target, which together with mapSection identifies the field
+     * @param targetPosition Where the target is now
+     * @param position Where the enemy is now
+     * @param waypoint Set to a point to walk straight towards
+     * @return False if the enemy is outside the field or the target can not be reached from its position
+     */
+    bool NextWaypoint(Entity::EntityIndex target, uint16_t mapSection, const Vec3f& targetPosition, const Vec3f& position, Vec3f& waypoint);
+
+    size_t FieldCount();
+    uint32_t FieldsComputedLastFrame();
+
+    void ApplyNavigationPatch();
+};
@@ -17,8 +17,15 @@
 #include "initlist.h"
 #include "object_wrapper.h"
 #include "entitylist.h"
+#include "entity_snapshot.h"
+#include "ai_scheduler.h"
+#include "newgfx/animation_lod.h"
+#include "newgfx/model_loader.h"
+#include "ground_cache.h"
+#include "navigation.h"
 #include "battleparam.h"
 #include "object.h"
+#include "helpers.h"
 
 using Enemy::EntityFlag;
 using EntityList::BaseEntityWrapper;
@@ -29,11 +36,13 @@ auto CreateBloodStain = reinterpret_cast<void (__thiscall *)(void* self)>(0x0053
 NewEnemy::NewEnemy(void* parentObject, void* initData) :
     targetEntityIndex(UndefinedEntityIndex),
     hasTarget(false),
+    hasWaypoint(false),
     playingFullAnimation(false),
+    drawnSinceUpdate(true),
     hasSpawned(false),
     spawnSequenceCounter(0),
     deathSequenceCounter(0),
-    model(*NewEnemy::modelData),
+    model(NewEnemy::modelAsset),
     EnemyBase(parentObject)
 {
     OVERRIDE_METHOD(NewEnemy, Destruct);
@@ -84,10 +93,10 @@ void NewEnemy::PlayAnimationFullyOnce(Animation anim)
     playingFullAnimation = true;
 }
 
-void NewEnemy::FaceTowardsTarget()
+void NewEnemy::FaceTowards(const Vec3<float>& point)
 {
-    // Get angle towards target
-    auto angleDelta = atan2(targetPosition.z - xyz2.z, targetPosition.x - xyz2.x);
+    // Get angle towards point
+    auto angleDelta = atan2(point.z - xyz2.z, point.x - xyz2.x);
     int16_t targetAngleInt = RadToIntAngle(angleDelta);
     // Invert and Offset by 90deg because idk
     targetAngleInt = 0xffff - targetAngleInt;
@@ -103,6 +112,29 @@ void NewEnemy::FaceTowardsTarget()
     rotation.y = RadToIntAngle(currentAngle + turnAmount);
 }
 
+void NewEnemy::FaceTowardsTarget(bool refreshWaypoint)
+{
+#ifdef PATCH_NAVIGATION
+    // Waypoints are the centers of neighboring navigation cells, this is about half a cell
+    if (hasWaypoint && DistanceSquaredXZ(waypoint, xyz2) < Squared(2.5)) refreshWaypoint = true;
+
+    if (refreshWaypoint)
+    {
+#ifdef PATCH_AI_SCHEDULER
+        // Also when reaching the waypoint forced the refresh, it's the same work
+        AiScheduler::ThinkTimer timer(true);
+#endif
+        Vec3<float> position{xyz2.x, xyz2.y, xyz2.z};
+        hasWaypoint = Navigation::NextWaypoint(targetEntityIndex, originalMapSection, targetPosition, position, waypoint);
+    }
+
+    // Straight at the target when the flow field has no direction for this position
+    FaceTowards(hasWaypoint ? waypoint : targetPosition);
+#else
+    FaceTowards(targetPosition);
+#endif
+}
+
 void NewEnemy::MoveForwards()
 {
     // Project a point in the current heading direction
@@ -116,12 +148,19 @@ void NewEnemy::MoveForwards()
     newPos.z -= c * speed;
 
     // Apply new position if there is walkable ground
+#ifdef PATCH_GROUND_CACHE
+    if (GroundCache::FindGround(newPos, originalMapSection, 0x15).found)
+    {
+        xyz2.set(newPos);
+    }
+#else
     auto ground = GetGround(&newPos, 0x15);
 
     if (ground != nullptr && ground->position != nullptr)
     {
         xyz2.set(newPos);
     }
+#endif
 }
 
 void NewEnemy::SnapToMapSurface()
@@ -130,12 +169,21 @@ void NewEnemy::SnapToMapSurface()
     // Move the projection point slightly up to ensure it's actually above the ground
     pos.y += 10.0;
     // 0x15 is what other entities seem to use
+#ifdef PATCH_GROUND_CACHE
+    auto ground = GroundCache::FindGround(pos, originalMapSection, 0x15);
+
+    if (ground.found)
+    {
+        xyz2.set(ground.position);
+    }
+#else
     auto ground = GetGround(&pos, 0x15);
     
     if (ground != nullptr && ground->position != nullptr)
     {
         xyz2.set(ground->position);
     }
+#endif
 }
 
 void NewEnemy::CollideWithEntities()
@@ -154,6 +202,23 @@ bool NewEnemy::IsValidTarget(MapObjectWrapper& obj) const
 
 void NewEnemy::SearchForNewTarget()
 {
+#ifdef PATCH_ENTITY_SNAPSHOT
+    Vec3<float> position{xyz2.x, xyz2.y, xyz2.z};
+    EntitySnapshot::Hit nearest;
+    auto found = EntitySnapshot::Nearest(position, EntitySnapshot::Category::Objects, 1,
+        [this](const EntitySnapshot::Snapshot& snapshot, size_t slot) {
+            // Same conditions as IsValidTarget
+            return snapshot.objectType[slot] == 136 && snapshot.mapSection[slot] == originalMapSection;
+        }, &nearest);
+
+    if (found > 0)
+    {
+        auto& snapshot = EntitySnapshot::Current();
+        targetPosition = snapshot.Position(nearest.slot);
+        targetEntityIndex = snapshot.entityIndex[nearest.slot];
+        hasTarget = true;
+    }
+#else
     auto infinity = std::numeric_limits<float>::infinity();
 
     auto nearestTargetPos = Vec3<float>{infinity, infinity, infinity};
@@ -185,6 +250,7 @@ void NewEnemy::SearchForNewTarget()
         targetEntityIndex = nearestTargetIndex;
         hasTarget = true;
     }
+#endif
 }
 
 void NewEnemy::UpdateTargetExistence()
@@ -201,11 +267,25 @@ void NewEnemy::UpdateTargetExistence()
 
 void NewEnemy::Behavior()
 {
+#ifdef PATCH_AI_SCHEDULER
+    // Expensive decisions are only made on the frames that the scheduler gives this enemy
+    bool think = schedule.Due(*this);
+#else
+    bool think = true;
+#endif
+
     if (!hasTarget)
     {
         // No target, search new
         UseAnimation(Animation::Idle);
-        SearchForNewTarget();
+        if (think)
+        {
+#ifdef PATCH_AI_SCHEDULER
+            // Only the decisions count towards the budget, not the movement that happens every frame
+            AiScheduler::ThinkTimer timer(true);
+#endif
+            SearchForNewTarget();
+        }
     }
     
     UpdateTargetExistence();
@@ -221,7 +301,7 @@ void NewEnemy::Behavior()
         {
             // Move towards target
             UseAnimation(Animation::Walk);
-            FaceTowardsTarget();
+            FaceTowardsTarget(think);
             MoveForwards();
         }
     }
@@ -245,7 +325,14 @@ void NewEnemy::FlagForDestruction()
 
 void NewEnemy::Update()
 {
+#ifdef PATCH_ANIMATION_LOD
+    Vec3<float> position{xyz2.x, xyz2.y, xyz2.z};
+    // Entity index staggers the frames that enemies with the same interval are evaluated on
+    model.UpdateAnimation(AnimationLod::UpdateInterval(position, drawnSinceUpdate), (uint16_t) entityIndex);
+#else
     model.UpdateAnimation();
+#endif
+    drawnSinceUpdate = false;
 
     if (playingFullAnimation && model.AnimationEnded())
     {
@@ -299,6 +386,10 @@ void NewEnemy::Update()
         PlaySoundEffect(81);
         PlayAnimationFullyOnce(Animation::Flinch);
         entityFlags = EntityFlag(entityFlags & ~EntityFlag::TookDamage);
+
+#ifdef PATCH_AI_SCHEDULER
+        schedule.Boost();
+#endif
     }
 
     if (!playingFullAnimation) Behavior();
@@ -324,6 +415,8 @@ void NewEnemy::Render()
 {
     if (spawnSequenceCounter < 5) return;
 
+    drawnSinceUpdate = true;
+
     // Apply transformations and render
     Transform::PushTransformStackCopy();
     Transform::TranslateTransformStackHead(const_cast<Vec3<float>*>(&xyz2));
@@ -337,7 +430,7 @@ void NewEnemy::Render()
     Transform::PopTransformStack();
 }
 
-AnimatedModel* NewEnemy::modelData;
+std::shared_ptr<const ModelAsset> NewEnemy::modelAsset;
 
 const Enemy::CollisionBox NewEnemy::collisionBox(0.0, 5.0, 0.0, 5.0);
 
@@ -374,15 +467,26 @@ const BattleParam::BPResistsEntry NewEnemy::bpResists =
     15
 };
 
+/// Loading starts when the map starts loading and is finished by GlobalInit
+std::shared_ptr<ModelLoader::PendingModel> pendingModel;
+
+void __cdecl PrefetchModels()
+{
+    pendingModel = ModelLoader::Prefetch("pso-ene-seal-tex-mask-rig_packed-texture.fbx");
+}
+
 void __cdecl GlobalInit()
 {
-    NewEnemy::modelData = new AnimatedModel("pso-ene-seal-tex-mask-rig_packed-texture.fbx");
+    if (pendingModel == nullptr) PrefetchModels();
+
+    NewEnemy::modelAsset = ModelLoader::Finish(pendingModel);
+    pendingModel.reset();
 }
 
 void __cdecl GlobalUninit()
 {
-    delete NewEnemy::modelData;
-    NewEnemy::modelData = nullptr;
+    // Enemies that are still alive keep the asset until they're destroyed
+    NewEnemy::modelAsset.reset();
 }
 
 void* __cdecl CreateNewEnemy(void* initData)
@@ -395,13 +499,14 @@ void* __cdecl CreateNewEnemy(void* initData)
 /// Removes limit on number of enemy name entries in the unitxt
 void PatchEnemyNameUnitxtLimit()
 {
-    *(uint8_t*) 0x00793028 = 0x90;
-    *(uint8_t*) 0x00793029 = 0x90;
+    PatchNOP(0x00793028, 2);
 }
 
 void MakeNewEnemySpawnable()
 {
+    // Prefetching first lets the model load while the rest of the map does
     auto& forest1InitList = Map::GetMapInitList(Map::MapType::Forest1);
+    forest1InitList.PrependFunctionPair(InitList::FunctionPair(PrefetchModels, nullptr));
     forest1InitList.AddFunctionPair(InitList::FunctionPair(GlobalInit, GlobalUninit));
 
     auto& forest1Enemies = Enemy::GetEnemyConstructorList(Map::MapType::Forest1);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+#include "ai_scheduler.h"
 #include "initlist.h"
 #include "enemy.h"
 #include "map.h"
@@ -11,7 +13,8 @@ using Map::MapObjectWrapper;
 class NewEnemy : public EnemyBase
 {
 public:
-    static AnimatedModel* modelData;
+    /// Every NewEnemy animates its own instance of this
+    static std::shared_ptr<const ModelAsset> modelAsset;
     static const Enemy::NpcType enemyType = (Enemy::NpcType) 1337;
 
 private:
@@ -36,14 +39,23 @@ private:
     EntityIndex targetEntityIndex;
     Vec3<float> targetPosition;
     bool hasTarget;
+    /// Where to walk towards on the way to the target
+    Vec3<float> waypoint;
+    bool hasWaypoint;
 
     bool playingFullAnimation;
-    AnimatedModel model;
+    AnimationInstance model;
+    /// Render sets this and Update clears it
+    bool drawnSinceUpdate;
 
     bool hasSpawned;
     size_t spawnSequenceCounter;
     size_t deathSequenceCounter;
 
+#ifdef PATCH_AI_SCHEDULER
+    AiScheduler::Schedule schedule;
+#endif
+
 public:
     NewEnemy(void* parentObject, void* initData);
 
@@ -51,7 +63,8 @@ private:
     void Destruct(bool32 freeMemory);
     void UseAnimation(Animation newAnim);
     void PlayAnimationFullyOnce(Animation anim);
-    void FaceTowardsTarget();
+    void FaceTowards(const Vec3<float>& point);
+    void FaceTowardsTarget(bool refreshWaypoint);
     void MoveForwards();
     void SnapToMapSurface();
     void CollideWithEntities();
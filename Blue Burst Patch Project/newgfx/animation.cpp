@@ -1,178 +1,44 @@
 #ifdef USE_NEWGFX
 #include <stdexcept>
-#include <assimp/Importer.hpp>
-#include <assimp/postprocess.h>
 #include <cmath>
 #include "animation.h"
 #include "common.h"
+#include "pose_cache.h"
+#include "profiler.h"
+#include "trace.h"
 
-// Game runs at 30 fps
-const float DELTA_TIME = 1.0 / 30.0;
-
-AnimatedModel::Animation::Animation(const aiAnimation* anim)
-{
-    name = anim->mName.C_Str();
-    duration = anim->mDuration;
-
-    ticksPerSecond = anim->mTicksPerSecond;
-    if (ticksPerSecond == 0.0)
-    {
-        // 25-ish seems to be a common value
-        ticksPerSecond = 25.0;
-    }
-}
-
-void AnimatedModel::Animation::AddBone(const std::string& name, size_t id, const aiNodeAnim* channel)
-{
-    bones.emplace_back(name, id, channel);
-}
-
-size_t AnimatedModel::Animation::FindBoneIndex(const std::string& name) const
-{
-    for (size_t i = 0; i < bones.size(); i++)
-    {
-        if (bones[i].GetName() == name) return i;
-    }
-
-    return -1;
-}
-
-Bone& AnimatedModel::Animation::GetBone(size_t index)
-{
-    return bones[index];
-}
-
-AnimatedModel::AnimatedModel(const std::string& path) :
+AnimationInstance::AnimationInstance(std::shared_ptr<const ModelAsset> asset) :
+    asset(asset),
+    currentClip(nullptr),
     currentTime(0.0),
     looping(true),
-    boneCount(0),
-    Model(path)
+    finalBoneMatrices(asset->BoneCount()),
+    skinnedMeshes(asset->Meshes().size(), SkinnedMesh{{nullptr, nullptr}, 0, false}),
+    shadingMode(Mesh::Normal),
+    updateCount(0),
+    updateInterval(1),
+    poseStale(true)
 {
-    if (scene->mNumAnimations == 0)
-        throw std::runtime_error("File is missing animations: " + path);
-
-    // Re-process meshes to add bone data for them
-    for (auto& mesh : meshes)
-    {
-        auto meshData = scene->mMeshes[mesh.SceneMeshIndex()];
-
-        std::vector<std::vector<VertexBoneData>> vertexBoneMap(mesh.VertexCount());
-
-        // Write BoneInfos into boneInfoMap and create a mapping that allows each vertex to look up which bones are affecting it
-        for (auto boneIndex = 0; boneIndex < meshData->mNumBones; boneIndex++)
-        {
-            auto boneName = std::string(meshData->mBones[boneIndex]->mName.C_Str());
-
-            size_t boneId;
-
-            // Find existing BoneInfo or create new
-            auto entry = boneInfoMap.find(boneName);
-            if (entry == boneInfoMap.end())
-            {
-                BoneInfo newBoneInfo;
-                newBoneInfo.id = boneCount++;
-                newBoneInfo.offset = meshData->mBones[boneIndex]->mOffsetMatrix;
-
-                boneInfoMap[boneName] = newBoneInfo;
-
-                boneId = newBoneInfo.id;
-            }
-            else
-            {
-                boneId = (*entry).second.id;
-            }
-
-            auto weights = meshData->mBones[boneIndex]->mWeights;
-
-            // Save which vertices are affected by this bone
-            for (auto weightIndex = 0; weightIndex < meshData->mBones[boneIndex]->mNumWeights; weightIndex++)
-            {
-                VertexBoneData boneData;
-                boneData.boneId = boneId;
-                boneData.boneWeight = weights[weightIndex].mWeight;
-                vertexBoneMap[weights[weightIndex].mVertexId].push_back(boneData);
-            }
-        }
-
-        mesh.SetVertexBoneMap(vertexBoneMap);
-    }
-
-    // Read animation nodes
-    ReadAnimationNode(rootAnimationNode, scene->mRootNode);
-    
-    // Read animations
-    for (auto i = 0; i < scene->mNumAnimations; i++)
-    {
-        auto animData = scene->mAnimations[i];
-        auto anim = Animation(animData);
-
-        for (auto i = 0; i < animData->mNumChannels; i++)
-        {
-            auto channel = animData->mChannels[i];
-            // Channel name matches bone name
-            auto boneName = std::string(channel->mNodeName.C_Str());
-
-            // Sometimes there are channels that don't match any name in mesh->mBones (?)
-            if (boneInfoMap.find(boneName) == boneInfoMap.end())
-            {
-                boneInfoMap[boneName].id = boneCount++;
-            }
-
-            anim.AddBone(boneName, boneInfoMap[boneName].id, channel);
-        }
-
-        animations.push_back(anim);
-    }
-
-    // Ensure there is one matrix for each bone
-    finalBoneMatrices.resize(boneCount);
-
     ChangeAnimation(0);
 }
 
-/// Copy Assimp's nodes into a nicer format
-void AnimatedModel::ReadAnimationNode(AnimationNode& dst, const aiNode* src)
+AnimationInstance::~AnimationInstance()
 {
-    dst.name = std::string(src->mName.C_Str());
-    dst.transformation = src->mTransformation;
-
-    for (auto i = 0; i < src->mNumChildren; i++)
+    for (auto& skinned : skinnedMeshes)
     {
-        AnimationNode newNode;
-        ReadAnimationNode(newNode, src->mChildren[i]);
-        dst.children.push_back(newNode);
-    }
-}
-
-void AnimatedModel::ReadAnimations()
-{
-    for (auto i = 0; i < scene->mNumAnimations; i++)
-    {
-        auto animData = scene->mAnimations[i];
-        auto anim = Animation(animData);
-
-        for (auto i = 0; i < animData->mNumChannels; i++)
+        for (auto buffer : skinned.buffers)
         {
-            auto channel = animData->mChannels[i];
-            // Channel name matches bone name
-            auto boneName = std::string(channel->mNodeName.C_Str());
-
-            // Sometimes there are channels that don't match any name in mesh->mBones (?)
-            if (boneInfoMap.find(boneName) == boneInfoMap.end())
-            {
-                boneInfoMap[boneName].id = boneCount++;
-            }
-
-            anim.AddBone(boneName, boneInfoMap[boneName].id, channel);
+            if (buffer != nullptr) buffer->lpVtbl->Release(buffer);
         }
-
-        animations.push_back(anim);
     }
 }
 
-void AnimatedModel::UpdateAnimation()
+void AnimationInstance::UpdateAnimation(size_t interval, size_t phase)
 {
-    if (currentAnimation == nullptr) return;
+    TRACE_SCOPE("AnimationInstance::UpdateAnimation");
+    PROFILE_SCOPE("AnimationInstance::UpdateAnimation");
+
+    if (currentClip == nullptr) return;
 
     if (AnimationEnded())
     {
@@ -180,7 +46,7 @@ void AnimatedModel::UpdateAnimation()
         if (looping)
         {
             // Loop back to start
-            currentTime = fmod(currentTime, currentAnimation->duration);
+            currentTime = fmod(currentTime, currentClip->duration);
         }
         else
         {
@@ -189,107 +55,145 @@ void AnimatedModel::UpdateAnimation()
         }
     }
 
-    ComputeBoneTransform(rootAnimationNode, aiMatrix4x4());
+    // A shorter interval means the model came closer, so it should not keep showing an old pose until its turn
+    bool evaluate = poseStale || interval < updateInterval || (updateCount + phase) % interval == 0;
+    updateInterval = interval;
+    updateCount++;
 
-    for (auto& mesh : meshes)
+    if (evaluate)
     {
-        mesh.ApplyBoneTransformations(finalBoneMatrices);
+#ifdef PATCH_POSE_CACHE
+        float poseTime;
+        auto key = PoseCache::MakeKey(asset.get(), currentClip - asset->clips.data(), currentTime,
+            currentClip->ticksPerSecond * DELTA_TIME, poseTime);
+        auto cached = PoseCache::Find(key);
+        if (cached != nullptr)
+        {
+            SkinMeshes(*cached);
+        }
+        else
+        {
+            asset->skeleton->Evaluate(currentClip->jointChannels, currentClip->bones, cursors, poseTime, globalTransforms, finalBoneMatrices);
+            Skinning::BuildPalette(finalBoneMatrices, palette);
+            PoseCache::Insert(key, asset, palette);
+            SkinMeshes(palette);
+        }
+#else
+        asset->skeleton->Evaluate(currentClip->jointChannels, currentClip->bones, cursors, currentTime, globalTransforms, finalBoneMatrices);
+        Skinning::BuildPalette(finalBoneMatrices, palette);
+        SkinMeshes(palette);
+#endif
+
+        poseStale = false;
     }
 
-    // Increment animation timer
-    currentTime += currentAnimation->ticksPerSecond * DELTA_TIME;
+    // Increment animation timer even when the pose was not evaluated, so that the next evaluation catches up
+
+    currentTime += currentClip->ticksPerSecond * DELTA_TIME;
 }
 
-void AnimatedModel::ChangeAnimation(const std::string& name)
+void AnimationInstance::ChangeAnimation(const std::string& name)
 {
-    currentTime = 0.0;
-    currentAnimation = nullptr;
-
-    // Find by name
-    for (auto i = 0; i < animations.size(); i++)
-    {
-        if (animations[i].name == name)
-        {
-            currentAnimation = &animations[i];
-        }
-    }
+    ChangeAnimation(asset->FindClip(name));
 }
 
-void AnimatedModel::ChangeAnimation(size_t index)
+void AnimationInstance::ChangeAnimation(size_t index)
 {
     currentTime = 0.0;
-    currentAnimation = nullptr;
+    currentClip = nullptr;
+    poseStale = true;
 
-    if (index < animations.size())
+    if (index < asset->clips.size())
     {
-        currentAnimation = &animations[index];
+        currentClip = &asset->clips[index];
     }
+
+    ResetCursors();
 }
 
-void AnimatedModel::ComputeBoneTransform(const AnimationNode& node, const aiMatrix4x4& parentTransform)
+void AnimationInstance::ResetCursors()
 {
-    auto nodeTransform = node.transformation;
-
-    auto boneIndex = currentAnimation->FindBoneIndex(node.name);
-    if (boneIndex != -1)
-    {
-        // Update bone
-        auto& bone = currentAnimation->GetBone(boneIndex);
-        bone.Update(currentTime);
-        nodeTransform = bone.GetLocalTransform();
-    }
+    cursors.assign(currentClip != nullptr ? currentClip->bones.size() : 0, KeyframeCursor());
+}
 
-    // Apply bone's transformation into parent's transformation
-    auto globalTransform = parentTransform * nodeTransform;
+void AnimationInstance::SkinMeshes(const std::vector<Skinning::PaletteMatrix>& pose)
+{
+    const auto& meshes = asset->Meshes();
 
-    auto entry = boneInfoMap.find(node.name);
-    if (entry != boneInfoMap.end())
+    for (size_t i = 0; i < meshes.size(); i++)
     {
-        // Save bone transformation
-        auto boneInfo = (*entry).second;
-        finalBoneMatrices[boneInfo.id] = globalTransform * boneInfo.offset;
-    }
+        if (!meshes[i].IsSkinned()) continue;
 
-    for (const auto& child : node.children)
-    {
-        ComputeBoneTransform(child, globalTransform);
+        auto& skinned = skinnedMeshes[i];
+        if (skinned.buffers[0] == nullptr)
+        {
+            skinned.buffers[0] = meshes[i].CreateSkinnedBuffer();
+            skinned.buffers[1] = meshes[i].CreateSkinnedBuffer();
+        }
+
+        // Write the buffer that was not drawn last
+        auto nextIndex = skinned.hasVertices ? 1 - skinned.drawnIndex : skinned.drawnIndex;
+        meshes[i].Skin(pose, skinned.buffers[nextIndex]);
+        skinned.drawnIndex = nextIndex;
+        skinned.hasVertices = true;
     }
 }
 
-void AnimatedModel::AnimationLoopingEnabled(bool loop)
+void AnimationInstance::AnimationLoopingEnabled(bool loop)
 {
     looping = loop;
 }
 
-float AnimatedModel::AnimationTime() const
+float AnimationInstance::AnimationTime() const
 {
     return currentTime;
 }
 
-float AnimatedModel::AnimationRatio() const
+float AnimationInstance::AnimationRatio() const
 {
-    if (currentAnimation == nullptr || currentAnimation->duration == 0.0) return 0.0;
-    return currentTime / currentAnimation->duration;
+    if (currentClip == nullptr || currentClip->duration == 0.0) return 0.0;
+    return currentTime / currentClip->duration;
 }
 
-bool AnimatedModel::CurrentFrame(size_t frame) const
+bool AnimationInstance::CurrentFrame(size_t frame) const
 {
-    if (currentAnimation == nullptr) return false;
+    if (currentClip == nullptr) return false;
 
-    auto currentFrame = size_t(currentTime / (currentAnimation->ticksPerSecond * DELTA_TIME));
+    auto currentFrame = size_t(currentTime / (currentClip->ticksPerSecond * DELTA_TIME));
     return frame >= currentFrame && frame < currentFrame + 1;
 }
 
-bool AnimatedModel::CurrentFrameRatio(float ratio) const
+bool AnimationInstance::CurrentFrameRatio(float ratio) const
+{
+    if (currentClip == nullptr) return false;
+    return CurrentFrame(size_t(ratio * currentClip->duration / (currentClip->ticksPerSecond * DELTA_TIME)));
+}
+
+bool AnimationInstance::AnimationEnded() const
+{
+    if (currentClip == nullptr) return true;
+    return currentTime >= currentClip->duration;
+}
+
+void AnimationInstance::Draw()
+{
+    const auto& meshes = asset->Meshes();
+
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        const auto& skinned = skinnedMeshes[i];
+        meshes[i].Draw(shadingMode, skinned.hasVertices ? skinned.buffers[skinned.drawnIndex] : nullptr);
+    }
+}
+
+void AnimationInstance::UseNormalShading()
 {
-    if (currentAnimation == nullptr) return false;
-    return CurrentFrame(size_t(ratio * currentAnimation->duration / (currentAnimation->ticksPerSecond * DELTA_TIME)));
+    shadingMode = Mesh::Normal;
 }
 
-bool AnimatedModel::AnimationEnded() const
+void AnimationInstance::UseTransparentShading()
 {
-    if (currentAnimation == nullptr) return true;
-    return currentTime >= currentAnimation->duration;
+    shadingMode = Mesh::Transparent;
 }
 
 #endif // USE_NEWGFX
@@ -1,52 +1,63 @@
 #pragma once
 
 #include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
-#include <unordered_map>
+#include <d3d8.h>
 #include <assimp/matrix4x4.h>
-#include "model.h"
-#include "bone.h"
+#include "model_asset.h"
+#include "skinning.h"
 
-class AnimatedModel : public Model
+/**
+ * Playback state and pose of one animated copy of a ModelAsset. Skinned vertices go into the instance's own vertex buffers,
+ * so any number of instances of the same asset can be in different poses.
+ */
+class AnimationInstance
 {
 private:
-    class Animation
+    /// One mesh's skinned vertices, a frame's draw reads one buffer while the next frame writes the other
+    struct SkinnedMesh
     {
-    private:
-        friend class AnimatedModel;
-
-        std::string name;
-        float duration;
-        float ticksPerSecond;
-        std::vector<Bone> bones;
-
-        Animation(const aiAnimation* anim);
-        void AddBone(const std::string& name, size_t id, const aiNodeAnim* channel);
-        size_t FindBoneIndex(const std::string& name) const;
-        Bone& GetBone(size_t index);
-    };
-
-    struct AnimationNode
-    {
-    public:
-        std::string name;
-        aiMatrix4x4 transformation;
-        std::vector<AnimationNode> children;
+        IDirect3DVertexBuffer8* buffers[2];
+        size_t drawnIndex;
+        /// False until the first skinning, the mesh's untransformed vertices are drawn until then
+        bool hasVertices;
     };
 
-    AnimationNode rootAnimationNode;
-    std::vector<Animation> animations;
-    Animation* currentAnimation;
+    std::shared_ptr<const ModelAsset> asset;
+    const ModelAsset::Clip* currentClip;
     float currentTime;
     bool looping;
     std::vector<aiMatrix4x4> finalBoneMatrices;
-    std::unordered_map<std::string, BoneInfo> boneInfoMap;
-    size_t boneCount;
+    /// Scratch space for Skeleton::Evaluate
+    std::vector<aiMatrix4x4> globalTransforms;
+    /// Playback position in each bone of the current clip
+    std::vector<KeyframeCursor> cursors;
+    /// finalBoneMatrices in the layout that the skinning kernel reads
+    std::vector<Skinning::PaletteMatrix> palette;
+    /// One per mesh of the asset, the buffers are created on the first skinning
+    std::vector<SkinnedMesh> skinnedMeshes;
+    Mesh::ShadingMode shadingMode;
+    /// Number of UpdateAnimation calls so far
+    size_t updateCount;
+    /// Interval of the previous UpdateAnimation call
+    size_t updateInterval;
+    /// Set when the pose no longer matches the animation, e.g. after changing animations
+    bool poseStale;
 
 public:
-    AnimatedModel(const std::string& path);
-    void UpdateAnimation();
+    /// Starts playing the asset's first clip
+    explicit AnimationInstance(std::shared_ptr<const ModelAsset> asset);
+    AnimationInstance(const AnimationInstance&) = delete;
+    AnimationInstance& operator=(const AnimationInstance&) = delete;
+    ~AnimationInstance();
+    /**
+     * @brief Advances the animation by one frame.
+     * The pose is only recomputed on every interval'th call, offset by phase so that models with the same interval take turns.
+     * It is recomputed right away when the interval gets shorter or the animation changes.
+     */
+    void UpdateAnimation(size_t interval = 1, size_t phase = 0);
     void ChangeAnimation(const std::string& name);
     void ChangeAnimation(size_t index);
     void AnimationLoopingEnabled(bool looping);
@@ -59,9 +70,12 @@ public:
     /// Returns true when the argument matches the currently playing frame with the timeline being scaled to a range of 0..1
     bool CurrentFrameRatio(float ratio) const;
     bool AnimationEnded() const;
+    void Draw();
+    void UseNormalShading();
+    void UseTransparentShading();
 
 private:
-    void ReadAnimationNode(AnimationNode& dst, const aiNode* src);
-    void ReadAnimations();
-    void ComputeBoneTransform(const AnimationNode& node, const aiMatrix4x4& parentTransform);
+    void ResetCursors();
+    /// Writes the pose into the buffers that were not drawn last
+    void SkinMeshes(const std::vector<Skinning::PaletteMatrix>& pose);
 };
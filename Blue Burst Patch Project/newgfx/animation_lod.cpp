@@ -0,0 +1,45 @@
+#ifdef PATCH_ANIMATION_LOD
+
+#include <cmath>
+#include "animation_lod.h"
+#include "entity.h"
+#include "entitylist.h"
+
+namespace AnimationLod
+{
+    struct Tier
+    {
+        /// Applies to models closer than this to the nearest player
+        float maxDistance;
+        size_t interval;
+    };
+
+    /// Nearest first. Models further away than the last one get FURTHEST_INTERVAL.
+    const Tier TIERS[] = {
+        {150.0f, 1},
+        {300.0f, 2},
+        {600.0f, 4}
+    };
+    const size_t FURTHEST_INTERVAL = 8;
+
+    size_t UpdateInterval(const Vec3f& position, bool drawnLastFrame)
+    {
+        if (!drawnLastFrame) return FURTHEST_INTERVAL;
+
+        float nearest = INFINITY;
+        for (auto ptr : EntityList::Players())
+        {
+            auto player = Entity::BaseEntityWrapper(ptr);
+            nearest = std::fmin(nearest, (float) DistanceSquaredXZ(player.position(), position));
+        }
+
+        for (const auto& tier : TIERS)
+        {
+            if (nearest < Squared(tier.maxDistance)) return tier.interval;
+        }
+
+        return FURTHEST_INTERVAL;
+    }
+};
+
+#endif // PATCH_ANIMATION_LOD
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include "mathutil.h"
+
+/**
+ * Picks how often an animated model recomputes its pose. The animation clock still advances every frame,
+ * so a model that skips frames jumps to the correct pose when it is evaluated and plays at the same speed.
+ */
+namespace AnimationLod
+{
+    /**
+     * @brief Number of frames between pose evaluations for a model at the position.
+     * 1 near a player, then 2, 4 and 8 with distance to the nearest player. Models that were not drawn during the previous frame always get 8.
+     */
+    size_t UpdateInterval(const Vec3f& position, bool drawnLastFrame);
+};
@@ -0,0 +1,400 @@
+#ifdef ASSET_COMPILER
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_map>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include "asset_compiler.h"
+#include "compiled_asset.h"
+#include "model_asset.h"
+#include "skinning.h"
+
+namespace AssetCompiler
+{
+    const size_t IMAGE_CHANNEL_COUNT = 4;
+
+    /// Appends sections to the file and remembers where they went
+    class Writer
+    {
+    private:
+        std::vector<uint8_t> data;
+
+    public:
+        Writer()
+        {
+            data.resize(sizeof(CompiledAsset::Header));
+        }
+
+        template<typename T>
+        uint32_t Append(const T* items, size_t count)
+        {
+            // Every section starts 4-byte aligned
+            data.resize((data.size() + 3) & ~size_t(3));
+
+            auto offset = data.size();
+            if (offset + count * sizeof(T) > UINT32_MAX)
+                throw std::runtime_error("Compiled asset would be larger than 4 GiB");
+
+            data.resize(offset + count * sizeof(T));
+            if (count > 0) memcpy(data.data() + offset, items, count * sizeof(T));
+            return uint32_t(offset);
+        }
+
+        template<typename T>
+        uint32_t Append(const std::vector<T>& items)
+        {
+            return Append(items.data(), items.size());
+        }
+
+        /// Fills in the header and hands over the data
+        std::vector<uint8_t> Finish(CompiledAsset::Header header)
+        {
+            data.resize((data.size() + 3) & ~size_t(3));
+            header.fileSize = uint32_t(data.size());
+            memcpy(data.data(), &header, sizeof(header));
+            return std::move(data);
+        }
+    };
+
+    uint32_t PackColor(const aiColor4D& color)
+    {
+        const uint32_t a = (uint32_t) (color.a * 255.0) << 24;
+        const uint32_t r = (uint32_t) (color.r * 255.0) << 16;
+        const uint32_t g = (uint32_t) (color.g * 255.0) << 8;
+        const uint32_t b = (uint32_t) (color.b * 255.0);
+        return a | r | g | b;
+    }
+
+    void CopyMatrix(const aiMatrix4x4& matrix, float (&values)[16])
+    {
+        memcpy(values, &matrix.a1, sizeof(values));
+    }
+
+    class Compiler
+    {
+    private:
+        const aiScene* scene;
+        std::string directory;
+        Options options;
+        Writer writer;
+        CompiledAsset::Header header{};
+
+        std::unordered_map<std::string, BoneInfo> boneInfoMap;
+        std::vector<CompiledAsset::MeshRecord> meshRecords;
+        /// Per mesh, the bones affecting each vertex
+        std::vector<std::vector<std::vector<VertexBoneData>>> vertexBoneMaps;
+        std::vector<CompiledAsset::TextureRecord> textureRecords;
+        /// Texture path to index into textureRecords
+        std::unordered_map<std::string, uint32_t> textureIndices;
+
+    public:
+        Compiler(const aiScene* scene, const std::string& directory, const Options& options) :
+            scene(scene),
+            directory(directory),
+            options(options)
+        {
+            header.magic = CompiledAsset::MAGIC;
+            header.version = CompiledAsset::VERSION;
+        }
+
+        std::vector<uint8_t> Compile()
+        {
+            if (scene->mNumAnimations == 0)
+                throw std::runtime_error("File is missing animations");
+
+            // Meshes are stored depth first, in the order the nodes reference them
+            AddNode(scene->mRootNode);
+            WriteInfluences();
+            AddChannelBones();
+
+            Skeleton skeleton(scene->mRootNode, boneInfoMap);
+            WriteClips(skeleton);
+
+            std::vector<CompiledAsset::JointRecord> jointRecords;
+            for (const auto& joint : skeleton.Joints())
+            {
+                CompiledAsset::JointRecord record;
+                record.parent = joint.parent == Skeleton::NONE ? CompiledAsset::NONE : uint32_t(joint.parent);
+                record.boneSlot = joint.boneSlot == Skeleton::NONE ? CompiledAsset::NONE : uint32_t(joint.boneSlot);
+                CopyMatrix(joint.bindTransform, record.bindTransform);
+                CopyMatrix(joint.offset, record.offset);
+                jointRecords.push_back(record);
+            }
+
+            header.boneCount = uint32_t(boneInfoMap.size());
+            header.jointCount = uint32_t(jointRecords.size());
+            header.jointOffset = writer.Append(jointRecords);
+            header.meshCount = uint32_t(meshRecords.size());
+            header.meshOffset = writer.Append(meshRecords);
+            header.textureCount = uint32_t(textureRecords.size());
+            header.textureOffset = writer.Append(textureRecords);
+
+            return writer.Finish(header);
+        }
+
+    private:
+        void AddNode(const aiNode* node)
+        {
+            for (size_t i = 0; i < node->mNumMeshes; i++)
+            {
+                AddMesh(scene->mMeshes[node->mMeshes[i]]);
+            }
+
+            for (size_t i = 0; i < node->mNumChildren; i++)
+            {
+                AddNode(node->mChildren[i]);
+            }
+        }
+
+        void AddMesh(const aiMesh* mesh)
+        {
+            std::vector<Vertex> vertices(mesh->mNumVertices);
+            for (size_t i = 0; i < vertices.size(); i++)
+            {
+                auto& vertex = vertices[i];
+                vertex.position = mesh->mVertices[i];
+                vertex.normal = mesh->HasNormals() ? mesh->mNormals[i] : aiVector3D();
+                vertex.color = mesh->HasVertexColors(0) ? PackColor(mesh->mColors[0][i]) : 0xffffffff;
+
+                if (mesh->HasTextureCoords(0))
+                    vertex.texCoords = aiVector2D(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+                else
+                    vertex.texCoords = aiVector2D(0.0, 0.0);
+            }
+
+            std::vector<uint32_t> indices;
+            for (size_t i = 0; i < mesh->mNumFaces; i++)
+            {
+                const auto& face = mesh->mFaces[i];
+                indices.insert(indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+            }
+
+            // Bone ids are handed out in the order the bones are first seen
+            std::vector<std::vector<VertexBoneData>> vertexBoneMap(vertices.size());
+            for (size_t boneIndex = 0; boneIndex < mesh->mNumBones; boneIndex++)
+            {
+                const auto bone = mesh->mBones[boneIndex];
+                auto boneName = std::string(bone->mName.C_Str());
+
+                auto entry = boneInfoMap.find(boneName);
+                if (entry == boneInfoMap.end())
+                {
+                    BoneInfo info;
+                    info.id = boneInfoMap.size();
+                    info.offset = bone->mOffsetMatrix;
+                    entry = boneInfoMap.emplace(boneName, info).first;
+                }
+
+                for (size_t i = 0; i < bone->mNumWeights; i++)
+                {
+                    vertexBoneMap[bone->mWeights[i].mVertexId].push_back({entry->second.id, bone->mWeights[i].mWeight});
+                }
+            }
+
+            CompiledAsset::MeshRecord record;
+            record.vertexCount = uint32_t(vertices.size());
+            record.vertexOffset = writer.Append(vertices);
+            record.indexCount = uint32_t(indices.size());
+            record.indexOffset = writer.Append(indices);
+            record.influenceOffset = CompiledAsset::NONE;
+            record.texture = AddTexture(scene->mMaterials[mesh->mMaterialIndex]);
+
+            meshRecords.push_back(record);
+            vertexBoneMaps.push_back(std::move(vertexBoneMap));
+        }
+
+        /// Influences can only be packed once every bone id is known
+        void WriteInfluences()
+        {
+            for (size_t i = 0; i < meshRecords.size(); i++)
+            {
+                meshRecords[i].influenceOffset = writer.Append(Skinning::PackInfluences(vertexBoneMaps[i]));
+            }
+        }
+
+        /// Only the first diffuse texture is used
+        uint32_t AddTexture(const aiMaterial* material)
+        {
+            if (material->GetTextureCount(aiTextureType_DIFFUSE) == 0) return CompiledAsset::NONE;
+
+            aiString texturePath;
+            material->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath);
+            std::string path = texturePath.C_Str();
+
+            auto found = textureIndices.find(path);
+            if (found != textureIndices.end()) return found->second;
+
+            int width, height, origNumChannels;
+            stbi_uc* img;
+            if (auto embedded = scene->GetEmbeddedTexture(path.c_str()))
+            {
+                // If mHeight == 0 the data is compressed and mWidth is the size of the buffer
+                auto byteSize = embedded->mHeight == 0 ? embedded->mWidth : embedded->mWidth * embedded->mHeight * sizeof(aiTexel);
+                img = stbi_load_from_memory(reinterpret_cast<stbi_uc*>(embedded->pcData), byteSize,
+                    &width, &height, &origNumChannels, IMAGE_CHANNEL_COUNT);
+            }
+            else
+            {
+                img = stbi_load((std::filesystem::path(directory) / path).string().c_str(),
+                    &width, &height, &origNumChannels, IMAGE_CHANNEL_COUNT);
+            }
+
+            if (img == nullptr)
+                throw std::runtime_error("Failed to load texture " + path);
+
+            // stb_image rows are top to bottom, flip them and convert from RGBA to BGRA for D3DFMT_A8R8G8B8
+            TexturePipeline::Image base{uint32_t(width), uint32_t(height), std::vector<uint8_t>(size_t(width) * height * IMAGE_CHANNEL_COUNT)};
+            auto rowSize = size_t(width) * IMAGE_CHANNEL_COUNT;
+            for (int y = 0; y < height; y++)
+            {
+                TexturePipeline::SwapRedBlue(img + size_t(height - 1 - y) * rowSize, &base.pixels[size_t(y) * rowSize], width);
+            }
+            stbi_image_free(img);
+
+            // DXT1 when every pixel is opaque, DXT5 otherwise, uncompressed if D3D8 won't take the size
+            auto format = TexturePipeline::Format::Bgra;
+            if (options.compressTextures && TexturePipeline::CanCompress(base.width, base.height))
+                format = TexturePipeline::HasTransparency(base) ? TexturePipeline::Format::Dxt5 : TexturePipeline::Format::Dxt1;
+
+            CompiledAsset::TextureRecord record;
+            record.width = base.width;
+            record.height = base.height;
+            record.format = uint32_t(format);
+
+            std::vector<uint8_t> levels;
+            auto chain = TexturePipeline::BuildMipChain(std::move(base), options.mipFilter);
+            for (const auto& level : chain)
+            {
+                auto data = TexturePipeline::Compress(level, format);
+                levels.insert(levels.end(), data.begin(), data.end());
+            }
+
+            record.mipCount = uint32_t(chain.size());
+            record.dataOffset = writer.Append(levels);
+
+            auto index = uint32_t(textureRecords.size());
+            textureRecords.push_back(record);
+            textureIndices[path] = index;
+            return index;
+        }
+
+        /// Channels that don't match any mesh bone get bone ids too
+        void AddChannelBones()
+        {
+            for (size_t animIdx = 0; animIdx < scene->mNumAnimations; animIdx++)
+            {
+                const auto anim = scene->mAnimations[animIdx];
+                for (size_t i = 0; i < anim->mNumChannels; i++)
+                {
+                    auto boneName = std::string(anim->mChannels[i]->mNodeName.C_Str());
+                    if (boneInfoMap.find(boneName) == boneInfoMap.end())
+                    {
+                        BoneInfo info{};
+                        info.id = boneInfoMap.size();
+                        boneInfoMap.emplace(boneName, info);
+                    }
+                }
+            }
+        }
+
+        void WriteClips(const Skeleton& skeleton)
+        {
+            std::vector<CompiledAsset::ClipRecord> clipRecords;
+            for (size_t animIdx = 0; animIdx < scene->mNumAnimations; animIdx++)
+            {
+                const auto anim = scene->mAnimations[animIdx];
+
+                CompiledAsset::ClipRecord record{};
+                strncpy(record.name, anim->mName.C_Str(), sizeof(record.name) - 1);
+                record.duration = float(anim->mDuration);
+                // 25-ish seems to be a common value
+                record.ticksPerSecond = anim->mTicksPerSecond == 0.0 ? 25.0f : float(anim->mTicksPerSecond);
+                record.sampleStep = record.ticksPerSecond * DELTA_TIME;
+
+                std::vector<Bone> bones;
+                for (size_t i = 0; i < anim->mNumChannels; i++)
+                {
+                    auto channel = anim->mChannels[i];
+                    auto boneName = std::string(channel->mNodeName.C_Str());
+                    bones.emplace_back(boneName, boneInfoMap[boneName].id, channel);
+                    bones.back().Resample(record.sampleStep, record.duration);
+                }
+
+                // One track per joint that has a channel, channels that match no node are dropped
+                auto jointChannels = skeleton.MapChannels(bones);
+                std::vector<CompiledAsset::TrackRecord> tracks;
+                for (size_t joint = 0; joint < jointChannels.size(); joint++)
+                {
+                    if (jointChannels[joint] == Skeleton::NONE) continue;
+                    tracks.push_back(WriteTrack(uint32_t(joint), bones[jointChannels[joint]]));
+                }
+
+                record.trackCount = uint32_t(tracks.size());
+                record.trackOffset = writer.Append(tracks);
+                clipRecords.push_back(record);
+            }
+
+            header.clipCount = uint32_t(clipRecords.size());
+            header.clipOffset = writer.Append(clipRecords);
+        }
+
+        CompiledAsset::TrackRecord WriteTrack(uint32_t joint, const Bone& bone)
+        {
+            std::vector<float> positions;
+            for (const auto& key : bone.Positions())
+            {
+                positions.insert(positions.end(), {key.position.x, key.position.y, key.position.z});
+            }
+
+            std::vector<int16_t> rotations;
+            for (const auto& key : bone.Rotations())
+            {
+                auto q = key.orientation;
+                q.Normalize();
+                for (auto component : {q.w, q.x, q.y, q.z})
+                {
+                    rotations.push_back(int16_t(std::lround(std::clamp(component, -1.0f, 1.0f) * CompiledAsset::ROTATION_SCALE)));
+                }
+            }
+
+            std::vector<float> scales;
+            for (const auto& key : bone.Scales())
+            {
+                scales.insert(scales.end(), {key.scale.x, key.scale.y, key.scale.z});
+            }
+
+            CompiledAsset::TrackRecord track;
+            track.joint = joint;
+            track.positionCount = uint32_t(bone.Positions().size());
+            track.positionOffset = writer.Append(positions);
+            track.rotationCount = uint32_t(bone.Rotations().size());
+            track.rotationOffset = writer.Append(rotations);
+            track.scaleCount = uint32_t(bone.Scales().size());
+            track.scaleOffset = writer.Append(scales);
+            return track;
+        }
+    };
+
+    std::vector<uint8_t> Compile(const aiScene* scene, const std::string& directory, const Options& options)
+    {
+        return Compiler(scene, directory, options).Compile();
+    }
+
+    std::vector<uint8_t> CompileFile(const std::string& path, const Options& options)
+    {
+        Assimp::Importer importer;
+        auto scene = importer.ReadFile(path, aiProcessPreset_TargetRealtime_Fast | aiProcess_TransformUVCoords);
+        if (scene == nullptr || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || scene->mRootNode == nullptr)
+            throw std::runtime_error(importer.GetErrorString());
+
+        return Compile(scene, std::filesystem::path(path).parent_path().string(), options);
+    }
+};
+
+#endif // ASSET_COMPILER
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <assimp/scene.h>
+#include "texture_pipeline.h"
+
+/**
+ * Turns an imported model into a compiled asset (see compiled_asset.h), which is the only format ModelAsset is created from.
+ * Tracks are resampled to one keyframe per game frame and textures get their whole mip chain.
+ * Doesn't touch Direct3D, so it can run on any thread.
+ * Only built into the host tools (ASSET_COMPILER), the client reads compiled assets and doesn't link assimp.
+ */
+namespace AssetCompiler
+{
+    struct Options
+    {
+        TexturePipeline::MipFilter mipFilter = TexturePipeline::MipFilter::Kaiser;
+        /// DXT1 for opaque textures and DXT5 otherwise, for sizes that D3D8 can compress
+        bool compressTextures = true;
+    };
+
+    /// Textures that aren't embedded are read from directory
+    std::vector<uint8_t> Compile(const aiScene* scene, const std::string& directory, const Options& options = Options());
+    /// Imports the model file with assimp and compiles it
+    std::vector<uint8_t> CompileFile(const std::string& path, const Options& options = Options());
+};
@@ -1,10 +1,14 @@
 #ifdef USE_NEWGFX
 
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
+#include <utility>
 #include "bone.h"
+#include "profiler.h"
 
 Bone::Bone(const std::string& name, size_t id, const aiNodeAnim* channel) :
-    name(name), id(id)
+    name(name), id(id), sampleStep(0.0f)
 {
     // Extract the position, rotation and scaling keyframes
     for (auto i = 0; i < channel->mNumPositionKeys; i++)
@@ -32,52 +36,83 @@ Bone::Bone(const std::string& name, size_t id, const aiNodeAnim* channel) :
     }
 }
 
+Bone::Bone(std::vector<KeyPosition> positions, std::vector<KeyRotation> rotations, std::vector<KeyScale> scales, float sampleStep) :
+    positions(std::move(positions)),
+    rotations(std::move(rotations)),
+    scales(std::move(scales)),
+    id(0),
+    sampleStep(sampleStep)
+{
+    if (this->positions.empty() || this->rotations.empty() || this->scales.empty())
+        throw std::runtime_error("Bone is missing keyframes");
+}
+
 const std::string& Bone::GetName() const
 {
     return name;
 }
 
-aiMatrix4x4 Bone::GetLocalTransform() const
+const std::vector<KeyPosition>& Bone::Positions() const
+{
+    return positions;
+}
+
+const std::vector<KeyRotation>& Bone::Rotations() const
+{
+    return rotations;
+}
+
+const std::vector<KeyScale>& Bone::Scales() const
+{
+    return scales;
+}
+
+float Bone::SampleStep() const
 {
-    return localTransform;
+    return sampleStep;
 }
 
-/// Apply the transformations at the specified timestamp
-void Bone::Update(float animationTime)
+/// Local transform at the specified timestamp
+aiMatrix4x4 Bone::Sample(float animationTime, KeyframeCursor& cursor) const
 {
-    auto translation = InterpolatePosition(animationTime);
-    auto rotation = InterpolateRotation(animationTime);
-    auto scale = InterpolateScaling(animationTime);
-    localTransform = aiMatrix4x4(scale, rotation, translation);
+    PROFILE_SCOPE("Bone::Sample");
+
+    auto translation = InterpolatePosition(animationTime, cursor.position);
+    auto rotation = InterpolateRotation(animationTime, cursor.rotation);
+    auto scale = InterpolateScaling(animationTime, cursor.scale);
+    return aiMatrix4x4(scale, rotation, translation);
 }
 
-/// Find the keyframe whose timestamp is nearest to the current time
+/**
+ * Finds the pair of keyframes around the current time and returns how far between them the time is.
+ * Needs at least 2 keyframes. Times outside of the keyframes are clamped to the first or last one.
+ */
 template<typename T>
-size_t FindNearestKeyframeIndex(const std::vector<T>& keyframes, float animationTime)
+float FindKeyframeSegment(const std::vector<T>& keyframes, float sampleStep, float animationTime, size_t& cursor, size_t& index)
 {
-    if (keyframes.size() == 2) return 0;
+    if (sampleStep > 0.0f)
+    {
+        // Evenly spaced, the index follows from the time
+        auto frame = std::max(animationTime, 0.0f) / sampleStep;
+        index = std::min(size_t(frame), keyframes.size() - 2);
+        return std::clamp(frame - float(index), 0.0f, 1.0f);
+    }
 
-    size_t i = 0;
-    auto it = keyframes.begin();
-    auto penult = keyframes.end() - 1;
+    // Playback moves forwards, so the search continues from the previous sample.
+    // Start over when it went backwards, e.g. when the animation looped.
+    if (cursor > keyframes.size() - 2 || animationTime < keyframes[cursor].timeStamp) cursor = 0;
 
-    while (it != penult)
+    while (cursor < keyframes.size() - 2 && animationTime >= keyframes[cursor + 1].timeStamp)
     {
-        auto nextFrame = *(it + 1);
-        if (animationTime < nextFrame.timeStamp) return i;
-        it++;
-        i++;
+        cursor++;
     }
 
-    throw std::runtime_error("Failed to find keyframe");
-}
+    index = cursor;
 
-/// Computes the ratio of the current time between two timestamps. For use with lerp.
-float TimestampRatio(float lastTimeStamp, float nextTimeStamp, float animationTime)
-{
-    auto midWayLength = animationTime - lastTimeStamp;
-    auto framesDiff = nextTimeStamp - lastTimeStamp;
-    return midWayLength / framesDiff;
+    auto lastTimeStamp = keyframes[index].timeStamp;
+    auto framesDiff = keyframes[index + 1].timeStamp - lastTimeStamp;
+    if (framesDiff <= 0.0f) return 0.0f;
+    return std::clamp((animationTime - lastTimeStamp) / framesDiff, 0.0f, 1.0f);
 }
 
 template<typename T>
@@ -86,58 +121,82 @@ T Lerp(const T& x, const T& y, float a)
     return x * (1.0f - a) + y * a;
 }
 
-aiVector3D Bone::InterpolatePosition(float animationTime)
+/// Cheaper than slerp and close enough when the keyframes are near each other
+aiQuaternion Nlerp(const aiQuaternion& x, const aiQuaternion& y, float a)
 {
-    auto lerpedPosition = positions[0].position;
+    // Go the short way around
+    auto dot = x.w * y.w + x.x * y.x + x.y * y.y + x.z * y.z;
+    auto sign = dot < 0.0f ? -1.0f : 1.0f;
+
+    aiQuaternion result(
+        x.w * (1.0f - a) + y.w * a * sign,
+        x.x * (1.0f - a) + y.x * a * sign,
+        x.y * (1.0f - a) + y.y * a * sign,
+        x.z * (1.0f - a) + y.z * a * sign);
+    return result.Normalize();
+}
 
+aiVector3D Bone::InterpolatePosition(float animationTime, size_t& cursor) const
+{
     // Can only interpolate if we have more than one keyframe, otherwise just use the one
-    if (positions.size() > 1)
-    {
-        // Get the current and next keyframes
-        auto idx0 = FindNearestKeyframeIndex(positions, animationTime);
-        auto frame0 = positions[idx0];
-        auto frame1 = positions[idx0 + 1];
-
-        // Interpolate between them
-        auto scaleFactor = TimestampRatio(frame0.timeStamp, frame1.timeStamp, animationTime);
-        lerpedPosition = Lerp(frame0.position, frame1.position, scaleFactor);
-    }
+    if (positions.size() == 1) return positions[0].position;
 
-    return lerpedPosition;
+    size_t idx0;
+    auto scaleFactor = FindKeyframeSegment(positions, sampleStep, animationTime, cursor, idx0);
+    return Lerp(positions[idx0].position, positions[idx0 + 1].position, scaleFactor);
 }
 
-aiQuaternion Bone::InterpolateRotation(float animationTime)
+aiQuaternion Bone::InterpolateRotation(float animationTime, size_t& cursor) const
 {
-    auto lerpedRotation = rotations[0].orientation;
+    if (rotations.size() == 1) return aiQuaternion(rotations[0].orientation).Normalize();
 
-    if (rotations.size() > 1)
-    {
-        auto idx0 = FindNearestKeyframeIndex(rotations, animationTime);
-        auto frame0 = rotations[idx0];
-        auto frame1 = rotations[idx0 + 1];
+    size_t idx0;
+    auto scaleFactor = FindKeyframeSegment(rotations, sampleStep, animationTime, cursor, idx0);
+    const auto& frame0 = rotations[idx0].orientation;
+    const auto& frame1 = rotations[idx0 + 1].orientation;
 
-        auto scaleFactor = TimestampRatio(frame0.timeStamp, frame1.timeStamp, animationTime);
-        aiQuaternion::Interpolate(lerpedRotation, frame0.orientation, frame1.orientation, scaleFactor);
-    }
-    
+    if (sampleStep > 0.0f) return Nlerp(frame0, frame1, scaleFactor);
+
+    aiQuaternion lerpedRotation;
+    aiQuaternion::Interpolate(lerpedRotation, frame0, frame1, scaleFactor);
     return lerpedRotation.Normalize();
 }
 
-aiVector3D Bone::InterpolateScaling(float animationTime)
+aiVector3D Bone::InterpolateScaling(float animationTime, size_t& cursor) const
 {
-    auto lerpedScale = scales[0].scale;
+    if (scales.size() == 1) return scales[0].scale;
 
-    if (scales.size() > 1)
-    {
-        auto idx0 = FindNearestKeyframeIndex(scales, animationTime);
-        auto frame0 = scales[idx0];
-        auto frame1 = scales[idx0 + 1];
+    size_t idx0;
+    auto scaleFactor = FindKeyframeSegment(scales, sampleStep, animationTime, cursor, idx0);
+    return Lerp(scales[idx0].scale, scales[idx0 + 1].scale, scaleFactor);
+}
+
+void Bone::Resample(float step, float duration)
+{
+    if (step <= 0.0f || sampleStep > 0.0f) return;
 
-        auto scaleFactor = TimestampRatio(frame0.timeStamp, frame1.timeStamp, animationTime);
-        lerpedScale = Lerp(frame0.scale, frame1.scale, scaleFactor);
+    // Enough keyframes to reach duration, and at least 2 so that sampling always has a pair to interpolate
+    auto count = std::max(size_t(std::ceil(duration / step)) + 1, size_t(2));
+
+    KeyframeCursor cursor;
+    std::vector<KeyPosition> newPositions(count);
+    std::vector<KeyRotation> newRotations(count);
+    std::vector<KeyScale> newScales(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        auto time = float(i) * step;
+        newPositions[i] = {InterpolatePosition(time, cursor.position), time};
+        newRotations[i] = {InterpolateRotation(time, cursor.rotation), time};
+        newScales[i] = {InterpolateScaling(time, cursor.scale), time};
     }
 
-    return lerpedScale;
+    // Tracks with a single keyframe are constant and already as cheap as they get
+    if (positions.size() > 1) positions = std::move(newPositions);
+    if (rotations.size() > 1) rotations = std::move(newRotations);
+    if (scales.size() > 1) scales = std::move(newScales);
+
+    sampleStep = step;
 }
 
 #endif // USE_NEWGFX
@@ -7,6 +7,12 @@
 #include <assimp/quaternion.h>
 #include <assimp/anim.h>
 
+struct BoneInfo
+{
+    size_t id;
+    aiMatrix4x4 offset;
+};
+
 struct KeyPosition
 {
     aiVector3D position;
@@ -25,24 +31,45 @@ struct KeyScale
     float timeStamp;
 };
 
+/// Where playback is in each of a bone's tracks, so that the next sample can continue the search from there
+struct KeyframeCursor
+{
+    size_t position = 0;
+    size_t rotation = 0;
+    size_t scale = 0;
+};
+
+/// Keyframes of one node in one animation. Doesn't change after loading, playback state is kept in a KeyframeCursor.
 class Bone
 {
 private:
     std::vector<KeyPosition> positions;
     std::vector<KeyRotation> rotations;
     std::vector<KeyScale> scales;
-    aiMatrix4x4 localTransform; // Default constructor sets values to identity
     std::string name;
     size_t id;
+    /// Time between keyframes after Resample, 0 if the tracks keep their original keyframes
+    float sampleStep;
 
 public:
     Bone(const std::string& name, size_t id, const aiNodeAnim* channel);
-    void Update(float animationTime);
+    /// A bone from keyframes that were already extracted, sampleStep is 0 unless they are evenly spaced that far apart from 0
+    Bone(std::vector<KeyPosition> positions, std::vector<KeyRotation> rotations, std::vector<KeyScale> scales, float sampleStep);
+    /**
+     * @brief Replaces the keyframes with ones spaced step ticks apart, covering the time from 0 to duration.
+     * Sampling then indexes the keyframes directly instead of searching.
+     */
+    void Resample(float step, float duration);
+    /// Local transform at the time, the cursor should only be used with this bone
+    aiMatrix4x4 Sample(float animationTime, KeyframeCursor& cursor) const;
     const std::string& GetName() const;
-    aiMatrix4x4 GetLocalTransform() const;
+    const std::vector<KeyPosition>& Positions() const;
+    const std::vector<KeyRotation>& Rotations() const;
+    const std::vector<KeyScale>& Scales() const;
+    float SampleStep() const;
 
 private:
-    aiVector3D InterpolatePosition(float animationTime);
-    aiQuaternion InterpolateRotation(float animationTime);
-    aiVector3D InterpolateScaling(float animationTime);
+    aiVector3D InterpolatePosition(float animationTime, size_t& cursor) const;
+    aiQuaternion InterpolateRotation(float animationTime, size_t& cursor) const;
+    aiVector3D InterpolateScaling(float animationTime, size_t& cursor) const;
 };
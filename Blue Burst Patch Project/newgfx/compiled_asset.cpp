@@ -0,0 +1,120 @@
+#ifdef USE_NEWGFX
+
+#include <cmath>
+#include <cstring>
+#include "compiled_asset.h"
+
+namespace CompiledAsset
+{
+    View::View(const void* data, size_t size) :
+        data(reinterpret_cast<const uint8_t*>(data)),
+        size(size)
+    {
+        if (size < sizeof(Header))
+            throw std::runtime_error("Compiled asset is truncated");
+
+        const auto& header = GetHeader();
+        if (header.magic != MAGIC)
+            throw std::runtime_error("Not a compiled asset");
+        if (header.version != VERSION)
+            throw std::runtime_error("Compiled asset has version " + std::to_string(header.version) +
+                ", expected " + std::to_string(VERSION) + ", recompile it");
+        if (header.fileSize != size)
+            throw std::runtime_error("Compiled asset is truncated");
+    }
+
+    const Header& View::GetHeader() const
+    {
+        return *reinterpret_cast<const Header*>(data);
+    }
+
+    std::string CompiledPath(const std::string& modelPath)
+    {
+        auto dot = modelPath.find_last_of('.');
+        auto slash = modelPath.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return modelPath + EXTENSION;
+        return modelPath.substr(0, dot) + EXTENSION;
+    }
+
+    aiMatrix4x4 ToMatrix(const float (&values)[16])
+    {
+        aiMatrix4x4 matrix;
+        memcpy(&matrix.a1, values, sizeof(values));
+        return matrix;
+    }
+
+    std::vector<Skeleton::Joint> ReadJoints(const View& view)
+    {
+        const auto& header = view.GetHeader();
+        auto records = view.Array<JointRecord>(header.jointOffset, header.jointCount);
+
+        std::vector<Skeleton::Joint> joints(header.jointCount);
+        for (size_t i = 0; i < joints.size(); i++)
+        {
+            const auto& record = records[i];
+            if (record.parent != NONE && record.parent >= i)
+                throw std::runtime_error("Compiled asset has a joint before its parent");
+            if (record.boneSlot != NONE && record.boneSlot >= header.boneCount)
+                throw std::runtime_error("Compiled asset has a joint with an invalid bone slot");
+
+            auto& joint = joints[i];
+            joint.parent = record.parent == NONE ? Skeleton::NONE : record.parent;
+            joint.boneSlot = record.boneSlot == NONE ? Skeleton::NONE : record.boneSlot;
+            joint.bindTransform = ToMatrix(record.bindTransform);
+            joint.offset = ToMatrix(record.offset);
+        }
+
+        return joints;
+    }
+
+    std::vector<Bone> ReadTracks(const View& view, const ClipRecord& clip, std::vector<size_t>& jointChannels)
+    {
+        const auto& header = view.GetHeader();
+        auto tracks = view.Array<TrackRecord>(clip.trackOffset, clip.trackCount);
+
+        std::vector<Bone> bones;
+        bones.reserve(clip.trackCount);
+        jointChannels.assign(header.jointCount, Skeleton::NONE);
+
+        for (size_t trackIdx = 0; trackIdx < clip.trackCount; trackIdx++)
+        {
+            const auto& track = tracks[trackIdx];
+            if (track.joint >= header.jointCount)
+                throw std::runtime_error("Compiled asset has a track for a joint that doesn't exist");
+
+            auto positionData = view.Array<float>(track.positionOffset, uint64_t(track.positionCount) * 3);
+            auto rotationData = view.Array<int16_t>(track.rotationOffset, uint64_t(track.rotationCount) * 4);
+            auto scaleData = view.Array<float>(track.scaleOffset, uint64_t(track.scaleCount) * 3);
+
+            std::vector<KeyPosition> positions(track.positionCount);
+            for (size_t i = 0; i < positions.size(); i++)
+            {
+                positions[i].position = aiVector3D(positionData[i * 3], positionData[i * 3 + 1], positionData[i * 3 + 2]);
+                positions[i].timeStamp = float(i) * clip.sampleStep;
+            }
+
+            std::vector<KeyRotation> rotations(track.rotationCount);
+            for (size_t i = 0; i < rotations.size(); i++)
+            {
+                auto q = rotationData + i * 4;
+                rotations[i].orientation = aiQuaternion(q[0] / ROTATION_SCALE, q[1] / ROTATION_SCALE, q[2] / ROTATION_SCALE, q[3] / ROTATION_SCALE);
+                rotations[i].orientation.Normalize();
+                rotations[i].timeStamp = float(i) * clip.sampleStep;
+            }
+
+            std::vector<KeyScale> scales(track.scaleCount);
+            for (size_t i = 0; i < scales.size(); i++)
+            {
+                scales[i].scale = aiVector3D(scaleData[i * 3], scaleData[i * 3 + 1], scaleData[i * 3 + 2]);
+                scales[i].timeStamp = float(i) * clip.sampleStep;
+            }
+
+            jointChannels[track.joint] = bones.size();
+            bones.emplace_back(std::move(positions), std::move(rotations), std::move(scales), clip.sampleStep);
+        }
+
+        return bones;
+    }
+};
+
+#endif // USE_NEWGFX
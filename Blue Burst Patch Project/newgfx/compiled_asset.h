@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bone.h"
+#include "skeleton.h"
+#include "texture_pipeline.h"
+
+/**
+ * Binary model format written by the asset compiler (asset_compiler.h) and read by ModelAsset without assimp.
+ * Everything is stored the way the client uses it: vertex and index streams ready to upload, packed skinning influences,
+ * a flattened skeleton, clips resampled to one keyframe per game frame and textures with their whole mip chain.
+ * All offsets are from the start of the file and 4-byte aligned. Bump VERSION whenever a record changes.
+ */
+namespace CompiledAsset
+{
+    const uint32_t MAGIC = 0x41504242; // "BBPA"
+    const uint32_t VERSION = 2;
+    const char EXTENSION[] = ".bbpa";
+    /// Parent of the root joint, bone slot of joints that aren't bones, texture of meshes without one
+    const uint32_t NONE = 0xffffffff;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t fileSize;
+        /// Number of final bone matrices
+        uint32_t boneCount;
+        uint32_t meshCount;
+        uint32_t meshOffset;
+        uint32_t jointCount;
+        uint32_t jointOffset;
+        uint32_t clipCount;
+        uint32_t clipOffset;
+        uint32_t textureCount;
+        uint32_t textureOffset;
+    };
+
+    struct MeshRecord
+    {
+        /// Vertex structs
+        uint32_t vertexCount;
+        uint32_t vertexOffset;
+        /// 32-bit triangle list indices
+        uint32_t indexCount;
+        uint32_t indexOffset;
+        /// Skinning::VertexInfluences, one per vertex, or NONE if the mesh isn't skinned
+        uint32_t influenceOffset;
+        /// Index of the diffuse texture or NONE
+        uint32_t texture;
+    };
+
+    struct JointRecord
+    {
+        /// Always less than the joint's own index, or NONE
+        uint32_t parent;
+        uint32_t boneSlot;
+        /// Row-major like aiMatrix4x4
+        float bindTransform[16];
+        float offset[16];
+    };
+
+    struct ClipRecord
+    {
+        char name[64];
+        float duration;
+        float ticksPerSecond;
+        /// Ticks between keyframes in every track
+        float sampleStep;
+        uint32_t trackCount;
+        uint32_t trackOffset;
+    };
+
+    /// Keyframes of one joint. Constant tracks have a single keyframe.
+    struct TrackRecord
+    {
+        uint32_t joint;
+        /// float[3] each
+        uint32_t positionCount;
+        uint32_t positionOffset;
+        /// Unit quaternions as int16_t[4] in w, x, y, z order, scaled by ROTATION_SCALE
+        uint32_t rotationCount;
+        uint32_t rotationOffset;
+        /// float[3] each
+        uint32_t scaleCount;
+        uint32_t scaleOffset;
+    };
+
+    const float ROTATION_SCALE = 32767.0f;
+
+    struct TextureRecord
+    {
+        /// Size of the top level
+        uint32_t width;
+        uint32_t height;
+        /// A TexturePipeline::Format
+        uint32_t format;
+        uint32_t mipCount;
+        /// Every level one after another, largest first, each laid out as TexturePipeline::LevelSize describes
+        uint32_t dataOffset;
+    };
+
+    /// Validates a compiled asset in memory and hands out bounds-checked pointers into it
+    class View
+    {
+    private:
+        const uint8_t* data;
+        size_t size;
+
+    public:
+        /// Throws if the data is not a compiled asset of the current version
+        View(const void* data, size_t size);
+        const Header& GetHeader() const;
+
+        /// Throws unless count Ts starting at offset lie inside the data
+        template<typename T>
+        const T* Array(uint32_t offset, uint64_t count) const
+        {
+            if (offset % alignof(T) != 0 || offset > size || count * sizeof(T) > size - offset)
+                throw std::runtime_error("Compiled asset has a section out of bounds");
+
+            return reinterpret_cast<const T*>(data + offset);
+        }
+    };
+
+    /// Where the compiled version of a model file is expected: the same path with the extension replaced
+    std::string CompiledPath(const std::string& modelPath);
+
+    std::vector<Skeleton::Joint> ReadJoints(const View& view);
+    /**
+     * @brief Decodes a clip's tracks into bones.
+     * jointChannels is filled with the index of the bone that moves each joint, or Skeleton::NONE.
+     */
+    std::vector<Bone> ReadTracks(const View& view, const ClipRecord& clip, std::vector<size_t>& jointChannels);
+};
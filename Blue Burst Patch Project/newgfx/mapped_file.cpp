@@ -0,0 +1,53 @@
+#ifdef USE_NEWGFX
+
+#include <stdexcept>
+#include "mapped_file.h"
+
+MappedFile::MappedFile(const std::string& path) :
+    file(INVALID_HANDLE_VALUE),
+    mapping(nullptr),
+    data(nullptr),
+    size(0)
+{
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Failed to open file: " + path);
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || fileSize.QuadPart > MAXDWORD)
+    {
+        CloseHandle(file);
+        throw std::runtime_error("File is empty or too large to map: " + path);
+    }
+
+    size = (size_t) fileSize.QuadPart;
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping != nullptr) data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (data == nullptr)
+    {
+        if (mapping != nullptr) CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map file: " + path);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    UnmapViewOfFile(data);
+    CloseHandle(mapping);
+    CloseHandle(file);
+}
+
+const void* MappedFile::Data() const
+{
+    return data;
+}
+
+size_t MappedFile::Size() const
+{
+    return size;
+}
+
+#endif // USE_NEWGFX
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <windows.h>
+
+/// A read-only view of a whole file, unmapped when destroyed
+class MappedFile
+{
+private:
+    HANDLE file;
+    HANDLE mapping;
+    const void* data;
+    size_t size;
+
+public:
+    /// Throws if the file can't be opened or mapped
+    MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+    const void* Data() const;
+    size_t Size() const;
+};
@@ -5,26 +5,10 @@
 #include <cassert>
 #include "mesh.h"
 #include "common.h"
+#include "profiler.h"
 
 auto ApplyTransformStack = reinterpret_cast<void (__cdecl *)()>(0x0082f1d0);
 
-Mesh::Mesh(const size_t sceneMeshIndex,
-           const std::vector<Vertex>& vertices,
-           const std::vector<uint32_t>& indices,
-           const std::vector<Texture>& textures,
-           const std::vector<std::vector<VertexBoneData>>& boneData) :
-    sceneMeshIndex(sceneMeshIndex),
-    untransformedVertices(vertices),
-    indices(indices),
-    textures(textures),
-    vertexBoneMap(boneData),
-    shadingMode(ShadingMode::Normal)
-{
-    assert(vertices.size() > 0 && vertices.size() == boneData.size());
-
-    SetupMesh();
-}
-
 Mesh::Mesh(const size_t sceneMeshIndex,
            const std::vector<Vertex>& vertices,
            const std::vector<uint32_t>& indices,
@@ -69,12 +53,32 @@ void Mesh::SetupMesh()
     indexBuffer->lpVtbl->Unlock(indexBuffer);
 }
 
+IDirect3DVertexBuffer8* Mesh::CreateSkinnedBuffer() const
+{
+    auto vbSize = vectorSize(untransformedVertices);
+
+    // Dynamic so that the driver can hand out fresh memory on every discarding lock instead of waiting for the GPU
+    IDirect3DVertexBuffer8* buffer;
+    if (FAILED((*d3dDevice)->lpVtbl->CreateVertexBuffer(*d3dDevice, vbSize, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, 0, D3DPOOL_DEFAULT, &buffer)))
+        throw std::runtime_error("Failed to create skinned vertex buffer");
+
+    return buffer;
+}
+
+void Mesh::ReleaseBuffers()
+{
+    if (vertexBuffer != nullptr) vertexBuffer->lpVtbl->Release(vertexBuffer);
+    if (indexBuffer != nullptr) indexBuffer->lpVtbl->Release(indexBuffer);
+    vertexBuffer = nullptr;
+    indexBuffer = nullptr;
+}
+
 auto isRenderingShadows = reinterpret_cast<bool32*>(0x00acbf1c);
 auto shadowTextureFactor = reinterpret_cast<float*>(0x00acbf24);
 auto SetAmbientLight = reinterpret_cast<void (__stdcall *)(float r, float g, float b)>(0x00843980);
 auto defaultAmbientLight = reinterpret_cast<float*>(0x00a9d480);
 
-void Mesh::NormalShading()
+void Mesh::NormalShading() const
 {
     // Mesh is affected by lighting
     (*d3dDevice)->lpVtbl->SetRenderState(*d3dDevice, D3DRS_LIGHTING, true);
@@ -93,13 +97,13 @@ void Mesh::NormalShading()
     (*d3dDevice)->lpVtbl->SetTextureStageState(*d3dDevice, 0, D3DTSS_ALPHAARG2, D3DTA_CURRENT);
 }
 
-void Mesh::TransparentShading()
+void Mesh::TransparentShading() const
 {
     (*d3dDevice)->lpVtbl->SetRenderState(*d3dDevice, D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
     (*d3dDevice)->lpVtbl->SetRenderState(*d3dDevice, D3DRS_DESTBLEND, D3DBLEND_ONE);
 }
 
-void Mesh::ShadowShading()
+void Mesh::ShadowShading() const
 {
     (*d3dDevice)->lpVtbl->SetRenderState(*d3dDevice, D3DRS_LIGHTING, false);
     (*d3dDevice)->lpVtbl->SetRenderState(*d3dDevice, D3DRS_ALPHAREF, 0);
@@ -114,10 +118,12 @@ void Mesh::ShadowShading()
     (*d3dDevice)->lpVtbl->SetTextureStageState(*d3dDevice, 0, D3DTSS_ALPHAARG2, D3DTA_TFACTOR);
 }
 
-void Mesh::Draw()
+void Mesh::Draw(ShadingMode shadingMode, IDirect3DVertexBuffer8* skinnedVertices) const
 {
     ApplyTransformStack();
 
+    DWORD previousMipFilter = D3DTEXF_NONE;
+
     if (textures.size() > 0)
     {
         // Use ambient light color that is also used by the game elsewhere
@@ -129,7 +135,10 @@ void Mesh::Draw()
         // Two texture coordinates
         (*d3dDevice)->lpVtbl->SetTextureStageState(*d3dDevice, 0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_COUNT2);
         // TODO: Allow more than one texture?
-        (*d3dDevice)->lpVtbl->SetTexture(*d3dDevice, 0, (IDirect3DBaseTexture8*) textures[0].object);
+        (*d3dDevice)->lpVtbl->SetTexture(*d3dDevice, 0, (IDirect3DBaseTexture8*) textures[0].object.get());
+        // Blend between mip levels, the game's own setting is restored after drawing
+        (*d3dDevice)->lpVtbl->GetTextureStageState(*d3dDevice, 0, D3DTSS_MIPFILTER, &previousMipFilter);
+        (*d3dDevice)->lpVtbl->SetTextureStageState(*d3dDevice, 0, D3DTSS_MIPFILTER, D3DTEXF_LINEAR);
 
         if (*isRenderingShadows) shadingMode = ShadingMode::Shadow;
 
@@ -148,7 +157,8 @@ void Mesh::Draw()
     }
 
     // Activate vertex buffer
-    (*d3dDevice)->lpVtbl->SetStreamSource(*d3dDevice, 0, vertexBuffer, sizeof(Vertex));
+    auto drawnBuffer = skinnedVertices != nullptr ? skinnedVertices : vertexBuffer;
+    (*d3dDevice)->lpVtbl->SetStreamSource(*d3dDevice, 0, drawnBuffer, sizeof(Vertex));
     // Activate index buffer
     (*d3dDevice)->lpVtbl->SetIndices(*d3dDevice, indexBuffer, 0);
     // Draw triangleCount triangles using vertexCount vertices starting from the beginning of each buffer
@@ -162,6 +172,7 @@ void Mesh::Draw()
     if (textures.size() > 0)
     {
         (*d3dDevice)->lpVtbl->SetTexture(*d3dDevice, 0, nullptr);
+        (*d3dDevice)->lpVtbl->SetTextureStageState(*d3dDevice, 0, D3DTSS_MIPFILTER, previousMipFilter);
         // Disable normalized normals because Ninja doesn't use it
         (*d3dDevice)->lpVtbl->SetRenderState(*d3dDevice, D3DRS_NORMALIZENORMALS, false);
     }
@@ -174,44 +185,30 @@ void Mesh::Draw()
     }
 }
 
-void Mesh::SetVertexBoneMap(const std::vector<std::vector<VertexBoneData>>& boneData)
+void Mesh::SetInfluences(const std::vector<Skinning::VertexInfluences>& packed)
 {
-    assert(boneData.size() == untransformedVertices.size());
-    vertexBoneMap = boneData;
+    assert(packed.size() == untransformedVertices.size());
+    influences = packed;
 }
 
-void Mesh::ApplyBoneTransformations(const std::vector<aiMatrix4x4>& transforms)
+bool Mesh::IsSkinned() const
 {
-    if (vertexBoneMap.size() != untransformedVertices.size()) return;
-
-    Vertex* vertices;
-    if (FAILED(vertexBuffer->lpVtbl->Lock(vertexBuffer, 0, 0, reinterpret_cast<BYTE**>(&vertices), 0)))
-        throw std::runtime_error("Failed to lock vertex buffer");
+    return influences.size() == untransformedVertices.size();
+}
 
-    for (auto vertIdx = 0; vertIdx < untransformedVertices.size(); vertIdx++)
-    {
-        auto& vert = vertices[vertIdx];
+void Mesh::Skin(const std::vector<Skinning::PaletteMatrix>& palette, IDirect3DVertexBuffer8* dst) const
+{
+    PROFILE_SCOPE("Mesh::Skin");
 
-        // Clear previous transformation
-        vert.position = untransformedVertices[vertIdx].position;
-        vert.normal = untransformedVertices[vertIdx].normal;
+    if (!IsSkinned()) return;
 
-        auto bones = vertexBoneMap[vertIdx];
-        if (bones.empty()) continue;
+    Vertex* vertices;
+    if (FAILED(dst->lpVtbl->Lock(dst, 0, 0, reinterpret_cast<BYTE**>(&vertices), D3DLOCK_DISCARD)))
+        throw std::runtime_error("Failed to lock vertex buffer");
 
-        // For each bone that affects this vertex
-        auto totalTransform = transforms[bones[0].boneId] * bones[0].boneWeight;
-        for (auto i = 1; i < bones.size(); i++)
-        {
-            // Apply bone's transformation 
-            totalTransform = totalTransform + (transforms[bones[i].boneId] * bones[i].boneWeight);
-        }
+    Skinning::SkinVertices(untransformedVertices.data(), influences.data(), untransformedVertices.size(), palette.data(), vertices);
 
-        vert.position *= totalTransform;
-        vert.normal *= totalTransform;
-    }
-    
-    vertexBuffer->lpVtbl->Unlock(vertexBuffer);
+    dst->lpVtbl->Unlock(dst);
 }
 
 size_t Mesh::VertexCount() const
@@ -229,14 +226,4 @@ size_t Mesh::SceneMeshIndex() const
     return sceneMeshIndex;
 }
 
-void Mesh::UseNormalShading()
-{
-    shadingMode = ShadingMode::Normal;
-}
-
-void Mesh::UseTransparentShading()
-{
-    shadingMode = ShadingMode::Transparent;
-}
-
 #endif // USE_NEWGFX
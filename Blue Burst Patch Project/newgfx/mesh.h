@@ -9,6 +9,8 @@
 #include <assimp/vector2.h>
 #include <assimp/matrix4x4.h>
 #include <assimp/material.h>
+#include "skinning.h"
+#include "texture_cache.h"
 
 struct Vertex
 {
@@ -29,52 +31,55 @@ struct Texture
 {
     std::string path;
     aiTextureType type;
-    IDirect3DTexture8* object;
+    /// Shared with every other mesh that uses the same image
+    TextureCache::Handle object;
 };
 
+/// Geometry and textures of one mesh. Doesn't change after loading, so it can be drawn by any number of model instances.
 class Mesh
 {
+public:
+    enum ShadingMode
+    {
+        Normal,
+        Transparent,
+        Shadow
+    };
+
 private:
     const size_t sceneMeshIndex;
     const std::vector<Vertex> untransformedVertices;
     const std::vector<uint32_t> indices;
     const std::vector<Texture> textures;
-    std::vector<std::vector<VertexBoneData>> vertexBoneMap;
+    /// Empty if the mesh is not skinned
+    std::vector<Skinning::VertexInfluences> influences;
 
     IDirect3DVertexBuffer8* vertexBuffer;
     IDirect3DIndexBuffer8* indexBuffer;
 
-    enum ShadingMode
-    {
-        Normal,
-        Transparent,
-        Shadow
-    };
-
-    ShadingMode shadingMode;
-
 public:
-    Mesh(const size_t sceneMeshIndex,
-         const std::vector<Vertex>& vertices,
-         const std::vector<uint32_t>& indices,
-         const std::vector<Texture>& textures,
-         const std::vector<std::vector<VertexBoneData>>& boneData);
     Mesh(const size_t sceneMeshIndex,
          const std::vector<Vertex>& vertices,
          const std::vector<uint32_t>& indices,
          const std::vector<Texture>& textures);
-    void SetVertexBoneMap(const std::vector<std::vector<VertexBoneData>>& boneData);
-    void Draw();
-    void ApplyBoneTransformations(const std::vector<aiMatrix4x4>& transforms);
+    /// Influences that were packed ahead of time, one per vertex
+    void SetInfluences(const std::vector<Skinning::VertexInfluences>& packed);
+    /// Draws skinnedVertices if given, otherwise the untransformed vertices
+    void Draw(ShadingMode shadingMode, IDirect3DVertexBuffer8* skinnedVertices = nullptr) const;
+    bool IsSkinned() const;
+    /// A dynamic vertex buffer for Skin to write into, owned by the caller
+    IDirect3DVertexBuffer8* CreateSkinnedBuffer() const;
+    /// Discards the contents of dst and writes the vertices posed by the palette into it
+    void Skin(const std::vector<Skinning::PaletteMatrix>& palette, IDirect3DVertexBuffer8* dst) const;
+    /// Meshes are copied around while loading, so the owning model releases the buffers when it's done with them
+    void ReleaseBuffers();
     size_t VertexCount() const;
     size_t TextureCount() const;
     size_t SceneMeshIndex() const;
-    void UseNormalShading();
-    void UseTransparentShading();
 
 private:
     void SetupMesh();
-    void NormalShading();
-    void TransparentShading();
-    void ShadowShading();
+    void NormalShading() const;
+    void TransparentShading() const;
+    void ShadowShading() const;
 };
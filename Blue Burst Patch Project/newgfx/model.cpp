@@ -4,277 +4,179 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
-#include <cstddef>
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
-#include <assimp/vector3.h>
-#include <assimp/vector2.h>
-#include <assimp/color4.h>
-#include <assimp/material.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
 #include "common.h"
+#include "compiled_asset.h"
 #include "model.h"
+#include "profiler.h"
+#include "texture_cache.h"
+#include "texture_pipeline.h"
 
-// Force images to always have 4 channels
-const size_t IMAGE_CHANNEL_COUNT = 4;
-
-uint32_t PackColor(const aiColor4D* color)
+D3DFORMAT ToD3DFormat(TexturePipeline::Format format)
 {
-    const uint32_t a = (uint32_t) (color->a * 255.0) << 24;
-    const uint32_t r = (uint32_t) (color->r * 255.0) << 16;
-    const uint32_t g = (uint32_t) (color->g * 255.0) << 8;
-    const uint32_t b = (uint32_t) (color->b * 255.0);
-    return a | r | g | b;
+    switch (format)
+    {
+        case TexturePipeline::Format::Dxt1:
+            return D3DFMT_DXT1;
+        case TexturePipeline::Format::Dxt5:
+            return D3DFMT_DXT5;
+        default:
+            // The only 4-component 32-bit format with alpha in d3d8
+            return D3DFMT_A8R8G8B8;
+    }
 }
 
-IDirect3DTexture8* TextureFromData(int width, int height, stbi_uc* img, bool flipY = true)
+/// Creates a texture from the data of each of its mip levels, largest first
+IDirect3DTexture8* CreateTexture(TexturePipeline::Format format, uint32_t width, uint32_t height, const std::vector<const uint8_t*>& levels)
 {
-    // The only 4-component 32-bit format with alpha in d3d8
-    auto dstFmt = D3DFMT_A8R8G8B8;
+    PROFILE_SCOPE("CreateTexture");
 
-    // Create texture object
-    const auto mipCount = 1;
     const auto usageFlags = 0;
     IDirect3DTexture8* texture = nullptr;
-    if (FAILED((*d3dDevice)->lpVtbl->CreateTexture(*d3dDevice, width, height, mipCount, usageFlags, dstFmt, D3DPOOL_MANAGED, &texture)))
+    if (FAILED((*d3dDevice)->lpVtbl->CreateTexture(*d3dDevice, width, height, levels.size(), usageFlags, ToD3DFormat(format), D3DPOOL_MANAGED, &texture)))
         throw std::runtime_error("Failed to create texture");
-    
-    // Lock texture object so that we can write to its buffer
-    const auto lockMipLevel = 0;
-    D3DLOCKED_RECT lockedRect; // We write to this
-    const auto rectToLock = nullptr; // Null means entire texture
-    const auto lockFlags = 0;
-    if (FAILED(texture->lpVtbl->LockRect(texture, lockMipLevel, &lockedRect, rectToLock, lockFlags)))
-        throw std::runtime_error("Failed to lock texture");
 
-    // Copy pixel data from image into texture object
-    // We do it row by row because the size of a row might be padded (pitch) in the destination buffer
-    auto textureDst = reinterpret_cast<uint8_t*>(lockedRect.pBits);
-    auto rowSize = width * IMAGE_CHANNEL_COUNT;
-    // Iterate rows in specified order
-    for (int y = flipY ? height - 1 : 0,
-             end = flipY ? -1 : height,
-             step = flipY ? -1 : 1;
-         y != end; y += step)
+    for (size_t level = 0; level < levels.size(); level++)
     {
-        auto textureSrc = img + y * rowSize;
+        D3DLOCKED_RECT lockedRect; // We write to this
+        const auto rectToLock = nullptr; // Null means entire level
+        const auto lockFlags = 0;
+        if (FAILED(texture->lpVtbl->LockRect(texture, level, &lockedRect, rectToLock, lockFlags)))
+        {
+            texture->lpVtbl->Release(texture);
+            throw std::runtime_error("Failed to lock texture");
+        }
 
-        // Convert pixels from RGBA to BGRA
-        for (auto x = 0; x < rowSize; x += IMAGE_CHANNEL_COUNT)
+        // Copy row by row because the size of a row might be padded (pitch) in the destination buffer.
+        // Rows of DXT textures are rows of 4x4 blocks.
+        auto textureDst = reinterpret_cast<uint8_t*>(lockedRect.pBits);
+        auto rowSize = TexturePipeline::RowPitch(format, width);
+        auto rowCount = TexturePipeline::RowCount(format, height);
+        for (uint32_t row = 0; row < rowCount; row++)
         {
-            textureDst[x + 0] = textureSrc[x + 2]; // B
-            textureDst[x + 1] = textureSrc[x + 1]; // G
-            textureDst[x + 2] = textureSrc[x + 0]; // R
-            textureDst[x + 3] = textureSrc[x + 3]; // A
+            memcpy(textureDst + row * lockedRect.Pitch, levels[level] + row * rowSize, rowSize);
         }
 
-        // Pitch = row width + padding
-        textureDst += lockedRect.Pitch;
-    }
+        texture->lpVtbl->UnlockRect(texture, level);
 
-    texture->lpVtbl->UnlockRect(texture, lockMipLevel);
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
 
     return texture;
 }
 
-IDirect3DTexture8* TextureFromFile(const std::string& filename, const std::string& directory, bool flipY = true)
+Model::Model(const CompiledAsset::View& view)
 {
-    // Read file from FS
-    auto path = joinPath({directory, filename});
-    
-    int width, height, origNumChannels;
-    auto img = stbi_load(path.c_str(), &width, &height, &origNumChannels, IMAGE_CHANNEL_COUNT);
-    if (img == nullptr)
-        throw std::runtime_error("Failed to load image file: " + path);
-
-    return TextureFromData(width, height, img, flipY);
-}
-
-IDirect3DTexture8* TextureFromEmbedded(const aiTexture* embedded, bool flipY = true)
-{
-    // If mHeight == 0 it means data is compressed
-    bool compressed = embedded->mHeight == 0;
-    // If compressed mWidth is size of buffer
-    auto byteSize = compressed ? embedded->mWidth : embedded->mWidth * embedded->mHeight * sizeof(aiTexel);
-
-    int width, height, origNumChannels;
-    auto img = stbi_load_from_memory(
-        reinterpret_cast<stbi_uc*>(embedded->pcData), byteSize,
-        &width, &height, &origNumChannels, IMAGE_CHANNEL_COUNT);
-    if (img == nullptr)
-        throw std::runtime_error("Failed to load embedded texture");
-
-    return TextureFromData(width, height, img, flipY);
-}
-
-Model::Model(const std::string& path)
-{
-    Assimp::Importer importer;
-    // Read file
-    auto maybeScene = importer.ReadFile(path, aiProcessPreset_TargetRealtime_Fast | aiProcess_TransformUVCoords);
-
-    if (maybeScene == nullptr || maybeScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || maybeScene->mRootNode == nullptr)
-        throw std::runtime_error(importer.GetErrorString());
-    
-    // Take ownership of scene
-    scene = importer.GetOrphanedScene();
-    
-    // Save the directory so that we can search for related resources there
-    directory = dirname(path);
+    PROFILE_SCOPE("Model::Model");
 
-    // Start processing nodes starting from the root node
-    ProcessNode(scene->mRootNode);
-}
-
-Model::~Model()
-{
-    delete scene;
-}
+    const auto& header = view.GetHeader();
 
-void Model::Draw()
-{
-    for (auto& mesh : meshes)
+    // Meshes that use the same texture share it
+    std::vector<Texture> textures(header.textureCount);
+    auto textureRecords = view.Array<CompiledAsset::TextureRecord>(header.textureOffset, header.textureCount);
+    for (size_t i = 0; i < textures.size(); i++)
     {
-        mesh.Draw();
-    }
-}
+        const auto& record = textureRecords[i];
+        auto format = TexturePipeline::Format(record.format);
+        if (format != TexturePipeline::Format::Bgra && format != TexturePipeline::Format::Dxt1 && format != TexturePipeline::Format::Dxt5)
+            throw std::runtime_error("Compiled asset has a texture in an unknown format");
+        if (record.width == 0 || record.height == 0 || record.mipCount == 0 ||
+            record.mipCount > TexturePipeline::MipLevelCount(record.width, record.height))
+            throw std::runtime_error("Compiled asset has a texture with an invalid size");
+        if (format != TexturePipeline::Format::Bgra && !TexturePipeline::CanCompress(record.width, record.height))
+            throw std::runtime_error("Compiled asset has a compressed texture that isn't made of whole blocks");
+
+        // Levels follow each other
+        std::vector<const uint8_t*> levels;
+        uint64_t offset = record.dataOffset;
+        for (uint32_t level = 0, width = record.width, height = record.height; level < record.mipCount; level++)
+        {
+            auto size = TexturePipeline::LevelSize(format, width, height);
+            if (offset > UINT32_MAX)
+                throw std::runtime_error("Compiled asset has a section out of bounds");
+
+            levels.push_back(view.Array<uint8_t>(uint32_t(offset), size));
+            offset += size;
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
 
-void Model::ProcessNode(aiNode* node)
-{
-    // Process meshes in node
-    for (size_t i = 0; i < node->mNumMeshes; i++)
-    {
-        ProcessMesh(node->mMeshes[i]);
-    }
+        auto key = TextureCache::MakeKey(levels[0], size_t(offset - record.dataOffset));
+        auto label = "compiled " + std::to_string(record.width) + "x" + std::to_string(record.height) + " texture";
 
-    // Process child nodes
-    for (size_t i = 0; i < node->mNumChildren; i++)
-    {
-        ProcessNode(node->mChildren[i]);
+        textures[i].type = aiTextureType_DIFFUSE;
+        textures[i].object = TextureCache::Acquire(key, label, [&]() {
+            return CreateTexture(format, record.width, record.height, levels);
+        });
     }
-}
-
-void Model::ProcessMesh(size_t meshIndex)
-{
-    auto mesh = scene->mMeshes[meshIndex];
-
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-    std::vector<Texture> textures;
 
-    // Get vertices
-    for (auto i = 0; i < mesh->mNumVertices; i++)
+    auto meshRecords = view.Array<CompiledAsset::MeshRecord>(header.meshOffset, header.meshCount);
+    for (size_t i = 0; i < header.meshCount; i++)
     {
-        Vertex vertex;
-        vertex.position = mesh->mVertices[i];
+        const auto& record = meshRecords[i];
+        auto vertices = view.Array<Vertex>(record.vertexOffset, record.vertexCount);
+        auto indices = view.Array<uint32_t>(record.indexOffset, record.indexCount);
 
-        if (mesh->HasNormals())
+        for (size_t j = 0; j < record.indexCount; j++)
         {
-            vertex.normal = mesh->mNormals[i];
+            if (indices[j] >= record.vertexCount)
+                throw std::runtime_error("Compiled asset has an index out of range");
         }
 
-        if (mesh->HasVertexColors(0))
+        std::vector<Texture> meshTextures;
+        if (record.texture != CompiledAsset::NONE)
         {
-            vertex.color = PackColor(mesh->mColors[i]);
-        }
-        else
-        {
-            vertex.color = 0xffffffff;
-        }
+            if (record.texture >= textures.size())
+                throw std::runtime_error("Compiled asset has a mesh with an invalid texture");
 
-        if (mesh->mTextureCoords != nullptr)
-        {
-            vertex.texCoords.x = mesh->mTextureCoords[0][i].x;
-            vertex.texCoords.y = mesh->mTextureCoords[0][i].y;
-        }
-        else
-        {
-            vertex.texCoords = aiVector2D(0.0, 0.0);
+            meshTextures.push_back(textures[record.texture]);
         }
 
-        vertices.push_back(vertex);
-    }
-
-    // Get indices from faces to match D3DPT_TRIANGLELIST
-    for (auto i = 0; i < mesh->mNumFaces; i++)
-    {
-        aiFace face = mesh->mFaces[i];
-        for (auto j = 0; j < face.mNumIndices; j++)
-        {
-            indices.push_back(face.mIndices[j]);
-        }
-    }
-
-    // Load textures (only diffuse for now)
-    auto material = scene->mMaterials[mesh->mMaterialIndex];
-    auto diffuseMaps = LoadMaterialTextures(material, aiTextureType_DIFFUSE);
-    textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-
-    meshes.emplace_back(meshIndex, vertices, indices, textures);
-}
-
-std::vector<Texture> Model::LoadMaterialTextures(aiMaterial* material, aiTextureType textureType)
-{
-    std::vector<Texture> textures;
-
-    // Load textures
-    for (auto i = 0; i < material->GetTextureCount(textureType); i++)
-    {
-        aiString texturePath;
-        material->GetTexture(textureType, i, &texturePath);
-
-        Texture texture;
-        texture.path = texturePath.C_Str();
-        texture.type = textureType;
+        meshes.emplace_back(i,
+            std::vector<Vertex>(vertices, vertices + record.vertexCount),
+            std::vector<uint32_t>(indices, indices + record.indexCount),
+            meshTextures);
 
-        // Asterisk prefix means embedded texture (but not always?)
-        if (texture.path[0] == '*')
+        if (record.influenceOffset != CompiledAsset::NONE)
         {
-            texture.object = TextureFromEmbedded(scene->GetEmbeddedTexture(texture.path.c_str()));
-        }
-        else
-        {
-            // Another way of getting an embedded texture
-            aiString texturePath;
-            material->Get(AI_MATKEY_TEXTURE(aiTextureType_DIFFUSE, 0), texturePath);
-            auto maybeEmbedded = scene->GetEmbeddedTexture(texturePath.C_Str());
+            auto influences = view.Array<Skinning::VertexInfluences>(record.influenceOffset, record.vertexCount);
 
-            if (maybeEmbedded)
-            {
-                // Is embedded
-                texture.path = std::string(texturePath.C_Str());
-                texture.object = TextureFromEmbedded(maybeEmbedded);
-            }
-            else
+            // Slot 0 is the identity matrix, bone n is in slot n + 1
+            for (size_t j = 0; j < record.vertexCount; j++)
             {
-                // Not embedded
-                texture.object = TextureFromFile(texture.path, this->directory);
+                for (auto slot : influences[j].slot)
+                {
+                    if (slot > header.boneCount)
+                        throw std::runtime_error("Compiled asset has an influence on a bone that doesn't exist");
+                }
             }
-        }
 
-        textures.push_back(texture);
+            meshes.back().SetInfluences(std::vector<Skinning::VertexInfluences>(influences, influences + record.vertexCount));
+        }
     }
-
-    return textures;
 }
 
-void Model::UseNormalShading()
+Model::~Model()
 {
     for (auto& mesh : meshes)
     {
-        mesh.UseNormalShading();
+        mesh.ReleaseBuffers();
     }
 }
 
-void Model::UseTransparentShading()
+void Model::Draw(Mesh::ShadingMode shadingMode) const
 {
-    for (auto& mesh : meshes)
+    for (const auto& mesh : meshes)
     {
-        mesh.UseTransparentShading();
+        mesh.Draw(shadingMode);
     }
 }
 
+const std::vector<Mesh>& Model::Meshes() const
+{
+    return meshes;
+}
+
 #endif // USE_NEWGFX
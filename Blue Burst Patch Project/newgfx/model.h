@@ -1,37 +1,27 @@
 #pragma once
 
-#include <cstddef>
-#include <string>
 #include <vector>
-#include <assimp/mesh.h>
-#include <assimp/scene.h>
-#include <assimp/material.h>
-#include <assimp/texture.h>
-#include <assimp/matrix4x4.h>
 #include "mesh.h"
 
-struct BoneInfo
+namespace CompiledAsset
 {
-    size_t id;
-    aiMatrix4x4 offset;
+    class View;
 };
 
+/// Meshes loaded from a compiled asset. Owns their Direct3D buffers, so it can't be copied.
 class Model
 {
 protected:
     std::vector<Mesh> meshes;
-    std::string directory;
-    const aiScene* scene;
 
 public:
-    Model(const std::string& path);
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
     ~Model();
-    void Draw();
-    void UseNormalShading();
-    void UseTransparentShading();
+    void Draw(Mesh::ShadingMode shadingMode = Mesh::Normal) const;
+    const std::vector<Mesh>& Meshes() const;
 
-private:
-    void ProcessMesh(size_t meshIndex);
-    void ProcessNode(aiNode* node);
-    std::vector<Texture> LoadMaterialTextures(aiMaterial* material, aiTextureType textureType);
+protected:
+    /// Meshes and textures of a compiled asset
+    Model(const CompiledAsset::View& view);
 };
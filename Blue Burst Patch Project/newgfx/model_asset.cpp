@@ -0,0 +1,58 @@
+#ifdef USE_NEWGFX
+#include <cstring>
+#include <stdexcept>
+#include "model_asset.h"
+
+ModelAsset::Clip::Clip(const CompiledAsset::View& view, const CompiledAsset::ClipRecord& record)
+{
+    name = std::string(record.name, strnlen(record.name, sizeof(record.name)));
+    duration = record.duration;
+    ticksPerSecond = record.ticksPerSecond;
+    bones = CompiledAsset::ReadTracks(view, record, jointChannels);
+}
+
+ModelAsset::ModelAsset(const CompiledAsset::View& view) :
+    Model(view),
+    boneCount(view.GetHeader().boneCount)
+{
+    const auto& header = view.GetHeader();
+
+    skeleton.reset(new Skeleton(CompiledAsset::ReadJoints(view)));
+
+    auto clipRecords = view.Array<CompiledAsset::ClipRecord>(header.clipOffset, header.clipCount);
+    for (size_t i = 0; i < header.clipCount; i++)
+    {
+        clips.push_back(Clip(view, clipRecords[i]));
+    }
+
+    if (clips.empty())
+        throw std::runtime_error("Compiled asset is missing animations");
+}
+
+std::shared_ptr<const ModelAsset> ModelAsset::FromCompiled(const CompiledAsset::View& view)
+{
+    // The constructor is private, so make_shared can't be used
+    return std::shared_ptr<const ModelAsset>(new ModelAsset(view));
+}
+
+size_t ModelAsset::FindClip(const std::string& name) const
+{
+    for (size_t i = 0; i < clips.size(); i++)
+    {
+        if (clips[i].name == name) return i;
+    }
+
+    return -1;
+}
+
+size_t ModelAsset::ClipCount() const
+{
+    return clips.size();
+}
+
+size_t ModelAsset::BoneCount() const
+{
+    return boneCount;
+}
+
+#endif // USE_NEWGFX
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "model.h"
+#include "bone.h"
+#include "compiled_asset.h"
+#include "skeleton.h"
+
+// Game runs at 30 fps
+const float DELTA_TIME = 1.0 / 30.0;
+
+class AnimationInstance;
+
+/**
+ * An animated model's meshes, skeleton and animation clips. Doesn't change after loading.
+ * Share one between any number of AnimationInstances through a std::shared_ptr, the last instance to go away frees it.
+ */
+class ModelAsset : public Model
+{
+private:
+    friend class AnimationInstance;
+
+    class Clip
+    {
+    private:
+        friend class ModelAsset;
+        friend class AnimationInstance;
+
+        std::string name;
+        float duration;
+        float ticksPerSecond;
+        std::vector<Bone> bones;
+        /// Index into bones of the channel that moves each skeleton joint
+        std::vector<size_t> jointChannels;
+
+        Clip(const CompiledAsset::View& view, const CompiledAsset::ClipRecord& record);
+    };
+
+    std::unique_ptr<Skeleton> skeleton;
+    std::vector<Clip> clips;
+    size_t boneCount;
+
+public:
+    /**
+     * @brief Creates the model from a compiled asset that is already in memory.
+     * Model files are turned into compiled assets by the AssetCompiler, see ModelLoader for loading them.
+     */
+    static std::shared_ptr<const ModelAsset> FromCompiled(const CompiledAsset::View& view);
+    /// Index of the clip with the name, or -1
+    size_t FindClip(const std::string& name) const;
+    size_t ClipCount() const;
+    size_t BoneCount() const;
+
+private:
+    ModelAsset(const CompiledAsset::View& view);
+};
@@ -0,0 +1,96 @@
+#ifdef USE_NEWGFX
+
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <windows.h>
+#include "compiled_asset.h"
+#include "mapped_file.h"
+#include "model_asset.h"
+#include "model_loader.h"
+#include "profiler.h"
+#include "trace.h"
+
+namespace ModelLoader
+{
+    /// Mapped files are read one byte per page so that the main thread doesn't have to fault them in
+    const size_t PAGE_SIZE = 4096;
+
+    class PendingModel
+    {
+    public:
+        std::string path;
+        /// The compiled asset next to the model file
+        std::unique_ptr<MappedFile> file;
+        std::exception_ptr error;
+        /// Null if the model was loaded without a worker
+        HANDLE thread = nullptr;
+
+        ~PendingModel()
+        {
+            if (thread != nullptr) CloseHandle(thread);
+        }
+    };
+
+    DWORD WINAPI Worker(LPVOID param)
+    {
+        // The worker holds its own reference, so a prefetch that is never finished is freed when the worker is done
+        std::unique_ptr<std::shared_ptr<PendingModel>> reference(reinterpret_cast<std::shared_ptr<PendingModel>*>(param));
+        auto& pending = **reference;
+
+#ifdef PATCH_TRACING
+        Tracing::ScopedZone zone(Tracing::PersistentName("ModelLoader::Worker " + pending.path));
+#endif
+
+        try
+        {
+            // The client doesn't include assimp, models have to be compiled ahead of time
+            auto compiledPath = CompiledAsset::CompiledPath(pending.path);
+            if (GetFileAttributesA(compiledPath.c_str()) == INVALID_FILE_ATTRIBUTES)
+                throw std::runtime_error("Missing compiled model " + compiledPath + ", create it from " + pending.path + " with host/asset_compiler");
+
+            pending.file.reset(new MappedFile(compiledPath));
+
+            auto bytes = reinterpret_cast<const volatile uint8_t*>(pending.file->Data());
+            for (size_t i = 0; i < pending.file->Size(); i += PAGE_SIZE)
+            {
+                bytes[i];
+            }
+        }
+        catch (...)
+        {
+            pending.error = std::current_exception();
+        }
+
+        return 0;
+    }
+
+    std::shared_ptr<PendingModel> Prefetch(const std::string& path)
+    {
+        auto pending = std::make_shared<PendingModel>();
+        pending->path = path;
+
+        // The worker doesn't touch the handle, so it can be stored after the worker started
+        auto reference = new std::shared_ptr<PendingModel>(pending);
+        pending->thread = CreateThread(nullptr, 0, Worker, reference, 0, nullptr);
+        if (pending->thread == nullptr) Worker(reference);
+
+        return pending;
+    }
+
+    std::shared_ptr<const ModelAsset> Finish(const std::shared_ptr<PendingModel>& pending)
+    {
+        PROFILE_SCOPE("ModelLoader::Finish");
+        TRACE_SCOPE("ModelLoader::Finish");
+
+        // Usually done already because the game's own loading takes longer
+        if (pending->thread != nullptr) WaitForSingleObject(pending->thread, INFINITE);
+
+        if (pending->error) std::rethrow_exception(pending->error);
+
+        // The model copies what it needs, so the file can be unmapped afterwards
+        return ModelAsset::FromCompiled(CompiledAsset::View(pending->file->Data(), pending->file->Size()));
+    }
+};
+
+#endif // USE_NEWGFX
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+class ModelAsset;
+
+/**
+ * Loads compiled models on worker threads so that reading them overlaps the game's own loading,
+ * leaving only the Direct3D resources to be created on the main thread. Start loading with Prefetch as soon as
+ * the map is known, e.g. at the start of its init list, and call Finish where the model is needed.
+ */
+namespace ModelLoader
+{
+    class PendingModel;
+
+    /**
+     * @brief Starts mapping the model's compiled asset (see CompiledAsset::CompiledPath) on a worker thread.
+     * The model file itself isn't read, Finish throws if the compiled asset is missing.
+     */
+    std::shared_ptr<PendingModel> Prefetch(const std::string& path);
+    /**
+     * @brief Waits for the worker to finish and creates the model. Main thread only.
+     * Errors from the worker are rethrown here.
+     */
+    std::shared_ptr<const ModelAsset> Finish(const std::shared_ptr<PendingModel>& pending);
+};
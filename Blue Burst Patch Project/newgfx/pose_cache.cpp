@@ -0,0 +1,142 @@
+#ifdef PATCH_POSE_CACHE
+
+#include <cmath>
+#include <functional>
+#include <unordered_map>
+#include "hooking.h"
+#include "keyboard.h"
+#include "model_asset.h"
+#include "pose_cache.h"
+#include "skinning.h"
+
+namespace PoseCache
+{
+    /// Entries that have not been used in this many frames are freed
+    const uint32_t ENTRY_LIFETIME = 30;
+    /// What Ctrl+Q cycles through
+    const size_t QUANTUM_CHOICES[] = {1, 2, 4, 8};
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            auto hash = std::hash<const void*>()(key.asset);
+            hash = hash * 31 + key.clip;
+            hash = hash * 31 + (uint32_t) key.step;
+            return hash;
+        }
+    };
+
+    struct Entry
+    {
+        std::shared_ptr<const ModelAsset> asset;
+        std::vector<Skinning::PaletteMatrix> palette;
+        uint32_t usedFrame;
+    };
+
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    size_t quantum = 1;
+
+    uint32_t frame = 0;
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t hitsLastFrame = 0;
+    uint32_t missesLastFrame = 0;
+
+    bool Key::operator==(const Key& other) const
+    {
+        return asset == other.asset && clip == other.clip && step == other.step;
+    }
+
+    Key MakeKey(const ModelAsset* asset, size_t clip, float animationTime, float ticksPerFrame, float& quantizedTime)
+    {
+        // Rounded rather than truncated because the time only approximately lands on whole frames
+        float quantumTicks = ticksPerFrame * float(quantum);
+        auto step = (int32_t) std::lround(animationTime / quantumTicks);
+        quantizedTime = float(step) * quantumTicks;
+        return Key{asset, (uint32_t) clip, step};
+    }
+
+    const std::vector<Skinning::PaletteMatrix>* Find(const Key& key)
+    {
+        auto found = entries.find(key);
+        if (found == entries.end())
+        {
+            misses++;
+            return nullptr;
+        }
+
+        hits++;
+        found->second.usedFrame = frame;
+        return &found->second.palette;
+    }
+
+    void Insert(const Key& key, const std::shared_ptr<const ModelAsset>& asset, const std::vector<Skinning::PaletteMatrix>& palette)
+    {
+        auto& entry = entries[key];
+        entry.asset = asset;
+        entry.palette = palette;
+        entry.usedFrame = frame;
+    }
+
+    size_t Quantum()
+    {
+        return quantum;
+    }
+
+    void SetQuantum(size_t frames)
+    {
+        if (frames == 0) frames = 1;
+        if (frames == quantum) return;
+
+        // Keys mean something else with a different quantum
+        quantum = frames;
+        entries.clear();
+    }
+
+    uint32_t HitsLastFrame()
+    {
+        return hitsLastFrame;
+    }
+
+    uint32_t MissesLastFrame()
+    {
+        return missesLastFrame;
+    }
+
+    void __cdecl OnFrameEnd(void*)
+    {
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (frame - it->second.usedFrame > ENTRY_LIFETIME) it = entries.erase(it);
+            else it++;
+        }
+
+        hitsLastFrame = hits;
+        missesLastFrame = misses;
+        hits = 0;
+        misses = 0;
+        frame++;
+    }
+
+    void ApplyPoseCachePatch()
+    {
+        Hooking::afterSceneUpdate.AddCallback(OnFrameEnd, nullptr, "Pose cache");
+
+        Keyboard::onKeyDown({Keyboard::Keycode::Ctrl, Keyboard::Keycode::Q}, []() {
+            const size_t count = sizeof(QUANTUM_CHOICES) / sizeof(QUANTUM_CHOICES[0]);
+            for (size_t i = 0; i < count; i++)
+            {
+                if (QUANTUM_CHOICES[i] == quantum)
+                {
+                    SetQuantum(QUANTUM_CHOICES[(i + 1) % count]);
+                    return;
+                }
+            }
+
+            SetQuantum(QUANTUM_CHOICES[0]);
+        });
+    }
+};
+
+#endif // PATCH_POSE_CACHE
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ModelAsset;
+
+namespace Skinning
+{
+    struct PaletteMatrix;
+};
+
+/**
+ * Shares evaluated poses between AnimationInstances of the same asset that are at the same point of the same clip,
+ * like a room full of enemies that were spawned together and are playing their idle animation.
+ * Animation time is rounded to a quantum of game frames, so a larger quantum gives more hits and choppier animation.
+ */
+namespace PoseCache
+{
+    struct Key
+    {
+        const ModelAsset* asset;
+        uint32_t clip;
+        /// Animation time divided by the quantum
+        int32_t step;
+
+        bool operator==(const Key& other) const;
+    };
+
+    /// The key for the time and the time to evaluate the pose at on a miss, which is the time rounded to the quantum
+    Key MakeKey(const ModelAsset* asset, size_t clip, float animationTime, float ticksPerFrame, float& quantizedTime);
+    /// The cached palette or nullptr, it stays valid until the end of the frame
+    const std::vector<Skinning::PaletteMatrix>* Find(const Key& key);
+    /// The asset is kept alive until the entry is evicted
+    void Insert(const Key& key, const std::shared_ptr<const ModelAsset>& asset, const std::vector<Skinning::PaletteMatrix>& palette);
+
+    /// Game frames per quantum, 1 shares only poses at exactly the same time
+    size_t Quantum();
+    void SetQuantum(size_t frames);
+
+    uint32_t HitsLastFrame();
+    uint32_t MissesLastFrame();
+
+    void ApplyPoseCachePatch();
+};
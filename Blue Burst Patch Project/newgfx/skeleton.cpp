@@ -0,0 +1,100 @@
+#ifdef USE_NEWGFX
+
+#include <utility>
+#include "profiler.h"
+#include "skeleton.h"
+
+Skeleton::Skeleton(const aiNode* root, const std::unordered_map<std::string, BoneInfo>& boneInfoMap)
+{
+    AddNode(root, NONE, boneInfoMap);
+}
+
+Skeleton::Skeleton(std::vector<Joint> joints) :
+    joints(std::move(joints))
+{
+}
+
+/// Depth-first so that parents are always added before their children
+void Skeleton::AddNode(const aiNode* node, size_t parent, const std::unordered_map<std::string, BoneInfo>& boneInfoMap)
+{
+    Joint joint;
+    joint.name = std::string(node->mName.C_Str());
+    joint.parent = parent;
+    joint.bindTransform = node->mTransformation;
+    joint.boneSlot = NONE;
+
+    auto entry = boneInfoMap.find(joint.name);
+    if (entry != boneInfoMap.end())
+    {
+        joint.boneSlot = (*entry).second.id;
+        joint.offset = (*entry).second.offset;
+    }
+
+    auto index = joints.size();
+    joints.push_back(joint);
+
+    for (size_t i = 0; i < node->mNumChildren; i++)
+    {
+        AddNode(node->mChildren[i], index, boneInfoMap);
+    }
+}
+
+const std::vector<Skeleton::Joint>& Skeleton::Joints() const
+{
+    return joints;
+}
+
+std::vector<size_t> Skeleton::MapChannels(const std::vector<Bone>& bones) const
+{
+    std::vector<size_t> jointChannels(joints.size(), NONE);
+
+    for (size_t jointIdx = 0; jointIdx < joints.size(); jointIdx++)
+    {
+        // First match wins, like the name search this replaces
+        for (size_t boneIdx = 0; boneIdx < bones.size(); boneIdx++)
+        {
+            if (bones[boneIdx].GetName() == joints[jointIdx].name)
+            {
+                jointChannels[jointIdx] = boneIdx;
+                break;
+            }
+        }
+    }
+
+    return jointChannels;
+}
+
+void Skeleton::Evaluate(const std::vector<size_t>& jointChannels,
+                        const std::vector<Bone>& bones,
+                        std::vector<KeyframeCursor>& cursors,
+                        float animationTime,
+                        std::vector<aiMatrix4x4>& globalTransforms,
+                        std::vector<aiMatrix4x4>& finalBoneMatrices) const
+{
+    PROFILE_SCOPE("Skeleton::Evaluate");
+
+    globalTransforms.resize(joints.size());
+
+    for (size_t i = 0; i < joints.size(); i++)
+    {
+        const auto& joint = joints[i];
+
+        auto localTransform = joint.bindTransform;
+        auto channel = jointChannels[i];
+        if (channel != NONE)
+        {
+            localTransform = bones[channel].Sample(animationTime, cursors[channel]);
+        }
+
+        // Parents come first, so their global transform is already up to date
+        if (joint.parent == NONE) globalTransforms[i] = localTransform;
+        else globalTransforms[i] = globalTransforms[joint.parent] * localTransform;
+
+        if (joint.boneSlot != NONE)
+        {
+            finalBoneMatrices[joint.boneSlot] = globalTransforms[i] * joint.offset;
+        }
+    }
+}
+
+#endif // USE_NEWGFX
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <assimp/matrix4x4.h>
+#include <assimp/scene.h>
+#include "bone.h"
+
+/**
+ * A model's node hierarchy flattened into an array where every node comes after its parent.
+ * Names are resolved once when the model is loaded, so evaluating a pose is a single forward loop
+ * without string comparisons or hash lookups.
+ */
+class Skeleton
+{
+public:
+    /// Parent of the root, channel of nodes that an animation does not move, bone slot of nodes that are not bones
+    static constexpr size_t NONE = (size_t) -1;
+
+    struct Joint
+    {
+        std::string name;
+        /// Always less than the joint's own index, NONE for the root
+        size_t parent;
+        /// Local transform of the node when no animation channel moves it
+        aiMatrix4x4 bindTransform;
+        /// Index into the final bone matrices, NONE if no mesh is skinned to this node
+        size_t boneSlot;
+        aiMatrix4x4 offset;
+    };
+
+private:
+    std::vector<Joint> joints;
+
+public:
+    Skeleton(const aiNode* root, const std::unordered_map<std::string, BoneInfo>& boneInfoMap);
+    /// Joints that are already in order, e.g. from a compiled asset
+    explicit Skeleton(std::vector<Joint> joints);
+
+    const std::vector<Joint>& Joints() const;
+
+    /**
+     * @brief Resolves an animation's bones to joints.
+     * Returns the index into bones of the channel that moves each joint, or NONE.
+     */
+    std::vector<size_t> MapChannels(const std::vector<Bone>& bones) const;
+
+    /**
+     * @brief Samples the animated bones at the time and writes the pose into finalBoneMatrices.
+     * jointChannels comes from MapChannels for the same bones, cursors has one entry per bone.
+     * globalTransforms is scratch space and is resized as needed.
+     */
+    void Evaluate(const std::vector<size_t>& jointChannels,
+                  const std::vector<Bone>& bones,
+                  std::vector<KeyframeCursor>& cursors,
+                  float animationTime,
+                  std::vector<aiMatrix4x4>& globalTransforms,
+                  std::vector<aiMatrix4x4>& finalBoneMatrices) const;
+
+private:
+    void AddNode(const aiNode* node, size_t parent, const std::unordered_map<std::string, BoneInfo>& boneInfoMap);
+};
@@ -0,0 +1,137 @@
+#ifdef USE_NEWGFX
+
+#include <algorithm>
+#include <xmmintrin.h>
+#include "mesh.h"
+#include "skinning.h"
+
+namespace Skinning
+{
+    std::vector<VertexInfluences> PackInfluences(const std::vector<std::vector<VertexBoneData>>& vertexBoneMap)
+    {
+        std::vector<VertexInfluences> packed(vertexBoneMap.size());
+        std::vector<VertexBoneData> bones;
+
+        for (size_t vertIdx = 0; vertIdx < vertexBoneMap.size(); vertIdx++)
+        {
+            auto& out = packed[vertIdx];
+            for (size_t i = 0; i < MAX_INFLUENCES; i++)
+            {
+                out.slot[i] = IDENTITY_SLOT;
+                out.weight[i] = 0.0f;
+            }
+
+            bones = vertexBoneMap[vertIdx];
+            if (bones.empty())
+            {
+                out.weight[0] = 1.0f;
+                continue;
+            }
+
+            float total = 0.0f;
+            for (const auto& bone : bones)
+            {
+                total += bone.boneWeight;
+            }
+
+            // Heaviest first
+            std::sort(bones.begin(), bones.end(), [](const VertexBoneData& a, const VertexBoneData& b) {
+                return a.boneWeight > b.boneWeight;
+            });
+
+            size_t kept = std::min(bones.size(), MAX_INFLUENCES);
+            float keptTotal = 0.0f;
+            for (size_t i = 0; i < kept; i++)
+            {
+                keptTotal += bones[i].boneWeight;
+            }
+
+            float scale = keptTotal > 0.0f ? total / keptTotal : 1.0f;
+            for (size_t i = 0; i < kept; i++)
+            {
+                out.slot[i] = (uint16_t) (bones[i].boneId + 1);
+                out.weight[i] = bones[i].boneWeight * scale;
+            }
+        }
+
+        return packed;
+    }
+
+    void ToPaletteMatrix(const aiMatrix4x4& m, PaletteMatrix& out)
+    {
+        const float rows[4][4] = {
+            {m.a1, m.a2, m.a3, m.a4},
+            {m.b1, m.b2, m.b3, m.b4},
+            {m.c1, m.c2, m.c3, m.c4},
+            {m.d1, m.d2, m.d3, m.d4}
+        };
+
+        for (size_t column = 0; column < 4; column++)
+        {
+            for (size_t row = 0; row < 4; row++)
+            {
+                out.column[column][row] = rows[row][column];
+            }
+        }
+    }
+
+    void BuildPalette(const std::vector<aiMatrix4x4>& boneMatrices, std::vector<PaletteMatrix>& palette)
+    {
+        palette.resize(boneMatrices.size() + 1);
+        ToPaletteMatrix(aiMatrix4x4(), palette[IDENTITY_SLOT]);
+
+        for (size_t i = 0; i < boneMatrices.size(); i++)
+        {
+            ToPaletteMatrix(boneMatrices[i], palette[i + 1]);
+        }
+    }
+
+    void SkinVertices(const Vertex* src, const VertexInfluences* influences, size_t count, const PaletteMatrix* palette, Vertex* dst)
+    {
+        for (size_t vertIdx = 0; vertIdx < count; vertIdx++)
+        {
+            const auto& influence = influences[vertIdx];
+
+            // Weighted sum of the columns of each bone's matrix
+            __m128 columns[4];
+            __m128 weight = _mm_set1_ps(influence.weight[0]);
+            const auto& first = palette[influence.slot[0]];
+            for (size_t c = 0; c < 4; c++)
+            {
+                columns[c] = _mm_mul_ps(_mm_loadu_ps(first.column[c]), weight);
+            }
+
+            for (size_t i = 1; i < MAX_INFLUENCES; i++)
+            {
+                weight = _mm_set1_ps(influence.weight[i]);
+                const auto& matrix = palette[influence.slot[i]];
+                for (size_t c = 0; c < 4; c++)
+                {
+                    columns[c] = _mm_add_ps(columns[c], _mm_mul_ps(_mm_loadu_ps(matrix.column[c]), weight));
+                }
+            }
+
+            const auto& in = src[vertIdx];
+            auto& out = dst[vertIdx];
+
+            __m128 position = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(columns[0], _mm_set1_ps(in.position.x)), _mm_mul_ps(columns[1], _mm_set1_ps(in.position.y))),
+                _mm_add_ps(_mm_mul_ps(columns[2], _mm_set1_ps(in.position.z)), columns[3]));
+            __m128 normal = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(columns[0], _mm_set1_ps(in.normal.x)), _mm_mul_ps(columns[1], _mm_set1_ps(in.normal.y))),
+                _mm_mul_ps(columns[2], _mm_set1_ps(in.normal.z)));
+
+            float result[8];
+            _mm_storeu_ps(result, position);
+            _mm_storeu_ps(result + 4, normal);
+
+            // The destination can be write-combined memory, so every field is written once and in order
+            out.position = aiVector3D(result[0], result[1], result[2]);
+            out.normal = aiVector3D(result[4], result[5], result[6]);
+            out.color = in.color;
+            out.texCoords = in.texCoords;
+        }
+    }
+};
+
+#endif // USE_NEWGFX
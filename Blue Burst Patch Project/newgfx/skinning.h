@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <assimp/matrix4x4.h>
+
+struct Vertex;
+struct VertexBoneData;
+
+/// CPU skinning with a fixed number of bone influences per vertex, blended 4 floats at a time with SSE
+namespace Skinning
+{
+    const size_t MAX_INFLUENCES = 4;
+    /// Palette slot that always holds the identity matrix, vertices without bones use it
+    const uint16_t IDENTITY_SLOT = 0;
+
+    /// Unused influences have a weight of 0
+    struct VertexInfluences
+    {
+        uint16_t slot[MAX_INFLUENCES];
+        float weight[MAX_INFLUENCES];
+    };
+
+    /// A bone matrix stored by columns so that a blended matrix can be applied to a vertex with four multiply-adds
+    struct PaletteMatrix
+    {
+        float column[4][4];
+    };
+
+    /**
+     * @brief Packs the bones of each vertex into fixed-size arrays.
+     * Vertices with more than MAX_INFLUENCES bones keep the heaviest ones with their weights scaled back up to the original total.
+     * Bone ids map to palette slot id + 1.
+     */
+    std::vector<VertexInfluences> PackInfluences(const std::vector<std::vector<VertexBoneData>>& vertexBoneMap);
+
+    /// Fills the palette with the identity matrix followed by the bone matrices in bone id order
+    void BuildPalette(const std::vector<aiMatrix4x4>& boneMatrices, std::vector<PaletteMatrix>& palette);
+
+    /**
+     * @brief Writes count skinned vertices into dst, which may be a write-only vertex buffer.
+     * Every field of every destination vertex is written. Normals are not translated.
+     */
+    void SkinVertices(const Vertex* src, const VertexInfluences* influences, size_t count, const PaletteMatrix* palette, Vertex* dst);
+};
@@ -0,0 +1,114 @@
+#ifdef USE_NEWGFX
+
+#include <unordered_map>
+#include "logger.h"
+#include "texture_cache.h"
+
+namespace TextureCache
+{
+    const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+    const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return size_t(key.hash ^ (key.hash >> 32));
+        }
+    };
+
+    struct Entry
+    {
+        std::weak_ptr<IDirect3DTexture8> texture;
+        std::string label;
+        size_t bytes;
+    };
+
+    /// Never destroyed, models that are freed during static destruction still remove their textures from it
+    std::unordered_map<Key, Entry, KeyHash>& entries = *new std::unordered_map<Key, Entry, KeyHash>();
+    size_t totalBytes = 0;
+
+    bool Key::operator==(const Key& other) const
+    {
+        return hash == other.hash && size == other.size;
+    }
+
+    Key MakeKey(const void* data, size_t size)
+    {
+        auto bytes = reinterpret_cast<const uint8_t*>(data);
+        uint64_t hash = FNV_OFFSET_BASIS;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * FNV_PRIME;
+        }
+
+        return Key{hash, size};
+    }
+
+    /// Sum of the sizes that the driver reports for each level
+    size_t TextureBytes(IDirect3DTexture8* texture)
+    {
+        size_t bytes = 0;
+        auto levelCount = texture->lpVtbl->GetLevelCount(texture);
+        for (DWORD level = 0; level < levelCount; level++)
+        {
+            D3DSURFACE_DESC desc;
+            if (SUCCEEDED(texture->lpVtbl->GetLevelDesc(texture, level, &desc))) bytes += desc.Size;
+        }
+
+        return bytes;
+    }
+
+    Handle Acquire(const Key& key, const std::string& label, const std::function<IDirect3DTexture8*()>& create)
+    {
+        auto found = entries.find(key);
+        if (found != entries.end())
+        {
+            if (auto texture = found->second.texture.lock()) return texture;
+        }
+
+        auto object = create();
+        auto bytes = TextureBytes(object);
+
+        Handle texture(object, [key](IDirect3DTexture8* object) {
+            auto found = entries.find(key);
+            if (found != entries.end())
+            {
+                totalBytes -= found->second.bytes;
+                entries.erase(found);
+            }
+
+            object->lpVtbl->Release(object);
+        });
+
+        entries[key] = Entry{texture, label, bytes};
+        totalBytes += bytes;
+
+        Log(L"TextureCache: Loaded %S, %u KB, %u KB in %u textures", label.c_str(),
+            (unsigned) (bytes / 1024), (unsigned) (totalBytes / 1024), (unsigned) entries.size());
+        return texture;
+    }
+
+    std::vector<TextureInfo> Textures()
+    {
+        std::vector<TextureInfo> textures;
+        for (const auto& [key, entry] : entries)
+        {
+            textures.push_back(TextureInfo{entry.label, entry.bytes, size_t(entry.texture.use_count())});
+        }
+
+        return textures;
+    }
+
+    size_t TextureCount()
+    {
+        return entries.size();
+    }
+
+    size_t TotalBytes()
+    {
+        return totalBytes;
+    }
+};
+
+#endif // USE_NEWGFX
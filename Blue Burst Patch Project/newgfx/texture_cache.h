@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <d3d8.h>
+
+/**
+ * Textures shared by every mesh and model that uses the same image. Entries are keyed by a hash of the source data,
+ * so an atlas that several models reference, or the same file under another name, is only loaded and counted once.
+ * Handles are reference counted and the texture is released when the last one goes away. Main thread only.
+ */
+namespace TextureCache
+{
+    typedef std::shared_ptr<IDirect3DTexture8> Handle;
+
+    struct Key
+    {
+        /// FNV-1a of the source data
+        uint64_t hash;
+        uint64_t size;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct TextureInfo
+    {
+        /// Where the texture came from
+        std::string label;
+        /// Video memory taken by every level of the texture
+        size_t bytes;
+        /// Number of handles
+        size_t users;
+    };
+
+    Key MakeKey(const void* data, size_t size);
+
+    /**
+     * @brief Returns the texture cached for the key, or creates it with create and caches it.
+     * label is only used for reporting.
+     */
+    Handle Acquire(const Key& key, const std::string& label, const std::function<IDirect3DTexture8*()>& create);
+
+    /// Every texture that is currently loaded
+    std::vector<TextureInfo> Textures();
+    size_t TextureCount();
+    size_t TotalBytes();
+};
@@ -0,0 +1,579 @@
+#ifdef USE_NEWGFX
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+#include "texture_pipeline.h"
+
+namespace TexturePipeline
+{
+    const float PI = 3.14159265f;
+    /// Shape of the Kaiser window, higher trades sharpness for less ringing
+    const float KAISER_ALPHA = 4.0f;
+    /// Half the width of the Kaiser filter in destination pixels
+    const float KAISER_RADIUS = 2.0f;
+
+    const size_t BLOCK_SIZE = 4;
+    const size_t BLOCK_PIXELS = BLOCK_SIZE * BLOCK_SIZE;
+    const size_t DXT1_BLOCK_BYTES = 8;
+    const size_t DXT5_BLOCK_BYTES = 16;
+
+    void SwapRedBlue(const uint8_t* src, uint8_t* dst, size_t count)
+    {
+        const __m128i greenAlpha = _mm_set1_epi32(0xff00ff00);
+        const __m128i lowByte = _mm_set1_epi32(0x000000ff);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * CHANNEL_COUNT));
+            auto kept = _mm_and_si128(pixels, greenAlpha);
+            auto first = _mm_slli_epi32(_mm_and_si128(pixels, lowByte), 16);
+            auto third = _mm_and_si128(_mm_srli_epi32(pixels, 16), lowByte);
+            pixels = _mm_or_si128(kept, _mm_or_si128(first, third));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * CHANNEL_COUNT), pixels);
+        }
+
+        for (; i < count; i++)
+        {
+            auto s = src + i * CHANNEL_COUNT;
+            auto d = dst + i * CHANNEL_COUNT;
+            uint8_t first = s[0];
+            d[0] = s[2];
+            d[1] = s[1];
+            d[2] = first;
+            d[3] = s[3];
+        }
+    }
+
+    uint32_t MipLevelCount(uint32_t width, uint32_t height)
+    {
+        uint32_t count = 1;
+        while (width > 1 || height > 1)
+        {
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+            count++;
+        }
+
+        return count;
+    }
+
+    Image DownsampleBox(const Image& image, uint32_t width, uint32_t height)
+    {
+        Image result{width, height, std::vector<uint8_t>(size_t(width) * height * CHANNEL_COUNT)};
+
+        // A dimension that is already 1 is averaged with itself, an odd one drops its last pixel
+        for (uint32_t y = 0; y < height; y++)
+        {
+            auto row0 = &image.pixels[size_t(std::min(y * 2, image.height - 1)) * image.width * CHANNEL_COUNT];
+            auto row1 = &image.pixels[size_t(std::min(y * 2 + 1, image.height - 1)) * image.width * CHANNEL_COUNT];
+            auto dst = &result.pixels[size_t(y) * width * CHANNEL_COUNT];
+
+            for (uint32_t x = 0; x < width; x++)
+            {
+                auto x0 = size_t(std::min(x * 2, image.width - 1)) * CHANNEL_COUNT;
+                auto x1 = size_t(std::min(x * 2 + 1, image.width - 1)) * CHANNEL_COUNT;
+                for (size_t c = 0; c < CHANNEL_COUNT; c++)
+                {
+                    dst[x * CHANNEL_COUNT + c] = uint8_t((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+                }
+            }
+        }
+
+        return result;
+    }
+
+    float Sinc(float x)
+    {
+        if (std::fabs(x) < 1e-5f) return 1.0f;
+        x *= PI;
+        return std::sin(x) / x;
+    }
+
+    /// Modified Bessel function of the first kind, order 0
+    float BesselI0(float x)
+    {
+        float sum = 1.0f;
+        float term = 1.0f;
+        for (int k = 1; k < 20; k++)
+        {
+            float factor = x / (2.0f * k);
+            term *= factor * factor;
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    float KaiserWindow(float x)
+    {
+        return BesselI0(KAISER_ALPHA * std::sqrt(std::max(0.0f, 1.0f - x * x))) / BesselI0(KAISER_ALPHA);
+    }
+
+    struct FilterTap
+    {
+        uint32_t source;
+        float weight;
+    };
+
+    /// The source pixels and their weights for each destination pixel along one axis
+    std::vector<std::vector<FilterTap>> KaiserTaps(uint32_t sourceSize, uint32_t size)
+    {
+        std::vector<std::vector<FilterTap>> taps(size);
+        float scale = float(sourceSize) / float(size);
+        float radius = KAISER_RADIUS * scale;
+
+        for (uint32_t i = 0; i < size; i++)
+        {
+            float center = (float(i) + 0.5f) * scale - 0.5f;
+            float total = 0.0f;
+
+            for (auto s = int(std::ceil(center - radius)); s <= int(std::floor(center + radius)); s++)
+            {
+                float distance = float(s) - center;
+                float weight = Sinc(distance / scale) * KaiserWindow(distance / radius);
+                if (weight == 0.0f) continue;
+
+                // Edges repeat the outermost pixel
+                auto source = uint32_t(std::clamp(s, 0, int(sourceSize) - 1));
+                taps[i].push_back({source, weight});
+                total += weight;
+            }
+
+            for (auto& tap : taps[i])
+            {
+                tap.weight /= total;
+            }
+        }
+
+        return taps;
+    }
+
+    Image DownsampleKaiser(const Image& image, uint32_t width, uint32_t height)
+    {
+        auto horizontalTaps = KaiserTaps(image.width, width);
+        auto verticalTaps = KaiserTaps(image.height, height);
+
+        // Horizontal pass into floats so that rounding only happens once
+        std::vector<float> rows(size_t(width) * image.height * CHANNEL_COUNT);
+        for (uint32_t y = 0; y < image.height; y++)
+        {
+            auto src = &image.pixels[size_t(y) * image.width * CHANNEL_COUNT];
+            auto dst = &rows[size_t(y) * width * CHANNEL_COUNT];
+
+            for (uint32_t x = 0; x < width; x++)
+            {
+                for (const auto& tap : horizontalTaps[x])
+                {
+                    for (size_t c = 0; c < CHANNEL_COUNT; c++)
+                    {
+                        dst[x * CHANNEL_COUNT + c] += tap.weight * src[tap.source * CHANNEL_COUNT + c];
+                    }
+                }
+            }
+        }
+
+        Image result{width, height, std::vector<uint8_t>(size_t(width) * height * CHANNEL_COUNT)};
+        for (uint32_t y = 0; y < height; y++)
+        {
+            auto dst = &result.pixels[size_t(y) * width * CHANNEL_COUNT];
+
+            for (size_t i = 0; i < size_t(width) * CHANNEL_COUNT; i++)
+            {
+                float sum = 0.0f;
+                for (const auto& tap : verticalTaps[y])
+                {
+                    sum += tap.weight * rows[size_t(tap.source) * width * CHANNEL_COUNT + i];
+                }
+
+                // The negative lobes can overshoot
+                dst[i] = uint8_t(std::clamp(std::lround(sum), 0l, 255l));
+            }
+        }
+
+        return result;
+    }
+
+    Image Downsample(const Image& image, MipFilter filter)
+    {
+        auto width = std::max(image.width / 2, 1u);
+        auto height = std::max(image.height / 2, 1u);
+
+        switch (filter)
+        {
+            case MipFilter::Kaiser:
+                return DownsampleKaiser(image, width, height);
+            default:
+                return DownsampleBox(image, width, height);
+        }
+    }
+
+    std::vector<Image> BuildMipChain(Image base, MipFilter filter)
+    {
+        std::vector<Image> levels;
+        levels.reserve(MipLevelCount(base.width, base.height));
+        levels.push_back(std::move(base));
+
+        // Each level is made from the one before it
+        while (levels.back().width > 1 || levels.back().height > 1)
+        {
+            levels.push_back(Downsample(levels.back(), filter));
+        }
+
+        return levels;
+    }
+
+    bool CanCompress(uint32_t width, uint32_t height)
+    {
+        return width % BLOCK_SIZE == 0 && height % BLOCK_SIZE == 0;
+    }
+
+    bool HasTransparency(const Image& image)
+    {
+        for (size_t i = 3; i < image.pixels.size(); i += CHANNEL_COUNT)
+        {
+            if (image.pixels[i] != 0xff) return true;
+        }
+
+        return false;
+    }
+
+    size_t BlockBytes(Format format)
+    {
+        return format == Format::Dxt1 ? DXT1_BLOCK_BYTES : DXT5_BLOCK_BYTES;
+    }
+
+    size_t RowPitch(Format format, uint32_t width)
+    {
+        if (format == Format::Bgra) return size_t(width) * CHANNEL_COUNT;
+        return std::max(size_t((width + 3) / 4), size_t(1)) * BlockBytes(format);
+    }
+
+    uint32_t RowCount(Format format, uint32_t height)
+    {
+        if (format == Format::Bgra) return height;
+        return std::max((height + 3) / 4, 1u);
+    }
+
+    size_t LevelSize(Format format, uint32_t width, uint32_t height)
+    {
+        return RowPitch(format, width) * RowCount(format, height);
+    }
+
+    /// RGB in 0..255
+    struct Color
+    {
+        float r, g, b;
+    };
+
+    Color operator+(const Color& x, const Color& y) { return {x.r + y.r, x.g + y.g, x.b + y.b}; }
+    Color operator-(const Color& x, const Color& y) { return {x.r - y.r, x.g - y.g, x.b - y.b}; }
+    Color operator*(const Color& x, float s) { return {x.r * s, x.g * s, x.b * s}; }
+    float Dot(const Color& x, const Color& y) { return x.r * y.r + x.g * y.g + x.b * y.b; }
+
+    uint16_t To565(const Color& color)
+    {
+        auto r = uint16_t(std::clamp(std::lround(color.r * 31.0f / 255.0f), 0l, 31l));
+        auto g = uint16_t(std::clamp(std::lround(color.g * 63.0f / 255.0f), 0l, 63l));
+        auto b = uint16_t(std::clamp(std::lround(color.b * 31.0f / 255.0f), 0l, 31l));
+        return uint16_t(r << 11 | g << 5 | b);
+    }
+
+    /// Bits are replicated the way hardware expands them
+    Color From565(uint16_t value)
+    {
+        auto r = (value >> 11) & 31;
+        auto g = (value >> 5) & 63;
+        auto b = value & 31;
+        return {float(r << 3 | r >> 2), float(g << 2 | g >> 4), float(b << 3 | b >> 2)};
+    }
+
+    /**
+     * @brief Picks the nearest palette entry for every pixel that is included and returns the squared error.
+     * Pixels that aren't included get index 3, which is transparent in 3-color mode.
+     */
+    float FitIndices(const Color (&pixels)[BLOCK_PIXELS], const bool (&included)[BLOCK_PIXELS],
+        uint16_t c0, uint16_t c1, bool threeColor, uint8_t (&indices)[BLOCK_PIXELS])
+    {
+        auto p0 = From565(c0);
+        auto p1 = From565(c1);
+        Color palette[4] = {p0, p1};
+        if (threeColor)
+        {
+            palette[2] = (p0 + p1) * 0.5f;
+        }
+        else
+        {
+            palette[2] = (p0 * 2.0f + p1) * (1.0f / 3.0f);
+            palette[3] = (p0 + p1 * 2.0f) * (1.0f / 3.0f);
+        }
+
+        float error = 0.0f;
+        for (size_t i = 0; i < BLOCK_PIXELS; i++)
+        {
+            if (!included[i])
+            {
+                indices[i] = 3;
+                continue;
+            }
+
+            float best = INFINITY;
+            for (uint8_t j = 0; j < (threeColor ? 3 : 4); j++)
+            {
+                auto difference = pixels[i] - palette[j];
+                float distance = Dot(difference, difference);
+                if (distance < best)
+                {
+                    best = distance;
+                    indices[i] = j;
+                }
+            }
+
+            error += best;
+        }
+
+        return error;
+    }
+
+    /// Endpoints from a least squares fit to the current indices, returns false if they can't be solved for
+    bool RefineEndpoints(const Color (&pixels)[BLOCK_PIXELS], const bool (&included)[BLOCK_PIXELS],
+        const uint8_t (&indices)[BLOCK_PIXELS], Color& end0, Color& end1)
+    {
+        // How far each index is towards endpoint 1 in 4-color mode
+        const float weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+        float a = 0.0f, b = 0.0f, c = 0.0f;
+        Color x0 = {0, 0, 0}, x1 = {0, 0, 0};
+        for (size_t i = 0; i < BLOCK_PIXELS; i++)
+        {
+            if (!included[i]) continue;
+            float t = weights[indices[i]];
+            a += (1.0f - t) * (1.0f - t);
+            b += (1.0f - t) * t;
+            c += t * t;
+            x0 = x0 + pixels[i] * (1.0f - t);
+            x1 = x1 + pixels[i] * t;
+        }
+
+        float determinant = a * c - b * b;
+        if (std::fabs(determinant) < 1e-6f) return false;
+
+        end0 = (x0 * c - x1 * b) * (1.0f / determinant);
+        end1 = (x1 * a - x0 * b) * (1.0f / determinant);
+        return true;
+    }
+
+    void WriteColorBlock(uint8_t* out, uint16_t c0, uint16_t c1, const uint8_t (&indices)[BLOCK_PIXELS])
+    {
+        uint32_t bits = 0;
+        for (size_t i = 0; i < BLOCK_PIXELS; i++)
+        {
+            bits |= uint32_t(indices[i]) << (i * 2);
+        }
+
+        out[0] = uint8_t(c0);
+        out[1] = uint8_t(c0 >> 8);
+        out[2] = uint8_t(c1);
+        out[3] = uint8_t(c1 >> 8);
+        memcpy(out + 4, &bits, sizeof(bits));
+    }
+
+    /**
+     * @brief Encodes the color half of a block, endpoints are found along the principal axis of the colors.
+     * With punchThrough, pixels with alpha below 128 become transparent in 3-color mode.
+     */
+    void EncodeColorBlock(const uint8_t (&block)[BLOCK_PIXELS][CHANNEL_COUNT], bool punchThrough, uint8_t* out)
+    {
+        Color pixels[BLOCK_PIXELS];
+        bool included[BLOCK_PIXELS];
+        bool anyTransparent = false;
+        size_t count = 0;
+        Color mean = {0, 0, 0};
+
+        for (size_t i = 0; i < BLOCK_PIXELS; i++)
+        {
+            pixels[i] = {float(block[i][2]), float(block[i][1]), float(block[i][0])};
+            included[i] = !punchThrough || block[i][3] >= 128;
+            anyTransparent |= !included[i];
+
+            if (included[i])
+            {
+                mean = mean + pixels[i];
+                count++;
+            }
+        }
+
+        uint8_t indices[BLOCK_PIXELS];
+        if (count == 0)
+        {
+            FitIndices(pixels, included, 0, 0, true, indices);
+            WriteColorBlock(out, 0, 0, indices);
+            return;
+        }
+
+        mean = mean * (1.0f / float(count));
+
+        // Covariance, then a few rounds of power iteration for its largest eigenvector
+        float cov[6] = {};
+        for (size_t i = 0; i < BLOCK_PIXELS; i++)
+        {
+            if (!included[i]) continue;
+            auto d = pixels[i] - mean;
+            cov[0] += d.r * d.r; cov[1] += d.r * d.g; cov[2] += d.r * d.b;
+            cov[3] += d.g * d.g; cov[4] += d.g * d.b; cov[5] += d.b * d.b;
+        }
+
+        Color axis = {1.0f, 1.0f, 1.0f};
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            Color next = {
+                cov[0] * axis.r + cov[1] * axis.g + cov[2] * axis.b,
+                cov[1] * axis.r + cov[3] * axis.g + cov[4] * axis.b,
+                cov[2] * axis.r + cov[4] * axis.g + cov[5] * axis.b};
+            float length = std::sqrt(Dot(next, next));
+            if (length < 1e-6f) break;
+            axis = next * (1.0f / length);
+        }
+
+        float low = INFINITY, high = -INFINITY;
+        for (size_t i = 0; i < BLOCK_PIXELS; i++)
+        {
+            if (!included[i]) continue;
+            float t = Dot(pixels[i] - mean, axis);
+            low = std::min(low, t);
+            high = std::max(high, t);
+        }
+
+        auto c0 = To565(mean + axis * high);
+        auto c1 = To565(mean + axis * low);
+
+        if (anyTransparent)
+        {
+            // 3-color mode is selected by c0 <= c1
+            if (c0 > c1) std::swap(c0, c1);
+            FitIndices(pixels, included, c0, c1, true, indices);
+            WriteColorBlock(out, c0, c1, indices);
+            return;
+        }
+
+        // 4-color mode is selected by c0 > c1, equal endpoints only need index 0
+        if (c0 < c1) std::swap(c0, c1);
+        if (c0 == c1)
+        {
+            memset(indices, 0, sizeof(indices));
+            WriteColorBlock(out, c0, c1, indices);
+            return;
+        }
+
+        float error = FitIndices(pixels, included, c0, c1, false, indices);
+
+        Color end0, end1;
+        if (RefineEndpoints(pixels, included, indices, end0, end1))
+        {
+            auto r0 = To565(end0);
+            auto r1 = To565(end1);
+            if (r0 < r1) std::swap(r0, r1);
+
+            uint8_t refined[BLOCK_PIXELS];
+            if (r0 != r1 && FitIndices(pixels, included, r0, r1, false, refined) < error)
+            {
+                c0 = r0;
+                c1 = r1;
+                memcpy(indices, refined, sizeof(indices));
+            }
+        }
+
+        WriteColorBlock(out, c0, c1, indices);
+    }
+
+    /// 8 interpolated alpha values between the block's smallest and largest alpha
+    void EncodeAlphaBlock(const uint8_t (&block)[BLOCK_PIXELS][CHANNEL_COUNT], uint8_t* out)
+    {
+        uint8_t a0 = 0, a1 = 255;
+        for (size_t i = 0; i < BLOCK_PIXELS; i++)
+        {
+            a0 = std::max(a0, block[i][3]);
+            a1 = std::min(a1, block[i][3]);
+        }
+
+        uint64_t bits = 0;
+        if (a0 != a1)
+        {
+            // a0 > a1 selects the 8 value mode
+            int palette[8] = {a0, a1};
+            for (int i = 1; i < 7; i++)
+            {
+                palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+            }
+
+            for (size_t i = 0; i < BLOCK_PIXELS; i++)
+            {
+                uint64_t best = 0;
+                int bestDistance = 256;
+                for (uint64_t j = 0; j < 8; j++)
+                {
+                    int distance = std::abs(palette[j] - block[i][3]);
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        best = j;
+                    }
+                }
+
+                bits |= best << (i * 3);
+            }
+        }
+
+        out[0] = a0;
+        out[1] = a1;
+        for (size_t i = 0; i < 6; i++)
+        {
+            out[2 + i] = uint8_t(bits >> (i * 8));
+        }
+    }
+
+    std::vector<uint8_t> Compress(const Image& image, Format format)
+    {
+        if (format == Format::Bgra) return image.pixels;
+
+        std::vector<uint8_t> result(LevelSize(format, image.width, image.height));
+        auto blockBytes = BlockBytes(format);
+        auto blocksWide = RowCount(format, image.width);
+        auto blocksHigh = RowCount(format, image.height);
+
+        uint8_t block[BLOCK_PIXELS][CHANNEL_COUNT];
+        for (uint32_t by = 0; by < blocksHigh; by++)
+        {
+            for (uint32_t bx = 0; bx < blocksWide; bx++)
+            {
+                // Blocks past the edge of small mip levels repeat the edge pixels
+                for (uint32_t y = 0; y < BLOCK_SIZE; y++)
+                {
+                    auto sy = std::min(by * 4 + y, image.height - 1);
+                    for (uint32_t x = 0; x < BLOCK_SIZE; x++)
+                    {
+                        auto sx = std::min(bx * 4 + x, image.width - 1);
+                        memcpy(block[y * BLOCK_SIZE + x], &image.pixels[(size_t(sy) * image.width + sx) * CHANNEL_COUNT], CHANNEL_COUNT);
+                    }
+                }
+
+                auto out = &result[(size_t(by) * blocksWide + bx) * blockBytes];
+                if (format == Format::Dxt1)
+                {
+                    EncodeColorBlock(block, true, out);
+                }
+                else
+                {
+                    EncodeAlphaBlock(block, out);
+                    EncodeColorBlock(block, false, out + 8);
+                }
+            }
+        }
+
+        return result;
+    }
+};
+
+#endif // USE_NEWGFX
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * CPU side of texture loading: channel swizzling, mip chain generation and DXT compression.
+ * Nothing here touches Direct3D, so it can be run and tested on the host.
+ */
+namespace TexturePipeline
+{
+    const size_t CHANNEL_COUNT = 4;
+
+    /// 32-bit pixels, rows in the order they are uploaded and without padding
+    struct Image
+    {
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> pixels;
+    };
+
+    enum class MipFilter
+    {
+        /// Averages 2x2 pixels, cheap enough for loading at runtime
+        Box,
+        /// Kaiser-windowed sinc, sharper distant mips for offline use
+        Kaiser
+    };
+
+    /// Values are stored in compiled assets
+    enum class Format : uint32_t
+    {
+        /// Uncompressed D3DFMT_A8R8G8B8
+        Bgra = 0,
+        /// 4x4 blocks of 8 bytes, 1-bit alpha
+        Dxt1 = 1,
+        /// 4x4 blocks of 16 bytes, interpolated alpha
+        Dxt5 = 2
+    };
+
+    /**
+     * @brief Converts count pixels between RGBA and BGRA by swapping the first and third byte.
+     * src and dst may be the same. Runs 4 pixels at a time with SSE2.
+     */
+    void SwapRedBlue(const uint8_t* src, uint8_t* dst, size_t count);
+
+    /// Number of mip levels from width x height down to 1x1
+    uint32_t MipLevelCount(uint32_t width, uint32_t height);
+    /// The next smaller mip level, half the size rounded down but at least 1x1
+    Image Downsample(const Image& image, MipFilter filter);
+    /// The base image followed by every smaller mip level
+    std::vector<Image> BuildMipChain(Image base, MipFilter filter);
+
+    /// D3D8 only accepts DXT textures whose top level is made of whole blocks
+    bool CanCompress(uint32_t width, uint32_t height);
+    /// True if any pixel is not fully opaque
+    bool HasTransparency(const Image& image);
+
+    /// Bytes in one row of pixels, or one row of 4x4 blocks for DXT
+    size_t RowPitch(Format format, uint32_t width);
+    /// Number of rows of pixels, or rows of 4x4 blocks for DXT
+    uint32_t RowCount(Format format, uint32_t height);
+    size_t LevelSize(Format format, uint32_t width, uint32_t height);
+
+    /**
+     * @brief Encodes a BGRA image in the format, levels smaller than a block are padded by repeating edge pixels.
+     * DXT1 stores pixels with alpha below 128 as transparent and the rest as opaque.
+     */
+    std::vector<uint8_t> Compress(const Image& image, Format format);
+};
@@ -8,6 +8,8 @@
 #include <string>
 #include <cstring>
 #include "omnispawn.h"
+#include "patching.h"
+#include "trace.h"
 #include "common.h"
 #include "map.h"
 #include "enemy.h"
@@ -1718,10 +1720,10 @@ namespace Omnispawn
     /// Patch BP getter functions to allow new BP indices
     void PatchBPGetters()
     {
-        PatchJMP(0x0077a684, 0x0077a696, (int) GetOmnispawnBPStatsEntry);
-        PatchJMP(0x0077a698, 0x0077a6b1, (int) GetOmnispawnBPAttacksEntry);
-        PatchJMP(0x0077a6b4, 0x0077a6c9, (int) GetOmnispawnBPResistsEntry);
-        PatchJMP(0x0077a6cc, 0x0077a6e5, (int) GetOmnispawnBPAnimationsEntry);
+        PatchJMP(0x0077a684, 0x0077a696, (int) (size_t) GetOmnispawnBPStatsEntry);
+        PatchJMP(0x0077a698, 0x0077a6b1, (int) (size_t) GetOmnispawnBPAttacksEntry);
+        PatchJMP(0x0077a6b4, 0x0077a6c9, (int) (size_t) GetOmnispawnBPResistsEntry);
+        PatchJMP(0x0077a6cc, 0x0077a6e5, (int) (size_t) GetOmnispawnBPAnimationsEntry);
     }
 
     /// Replace all hardcoded arguments to BP getter functions
@@ -1733,19 +1735,19 @@ namespace Omnispawn
             HardcodedBPIndexLocations codeLocs = entry.second;
 
             for (size_t loc : codeLocs.stats) {
-                *(uint8_t*)loc = bpI;
+                Patching::Write(loc, bpI);
             }
 
             for (size_t loc : codeLocs.resists) {
-                *(uint8_t*)loc = bpI;
+                Patching::Write(loc, bpI);
             }
 
             for (size_t loc : codeLocs.attacks) {
-                *(uint8_t*)loc = bpI;
+                Patching::Write(loc, bpI);
             }
 
             for (size_t loc : codeLocs.animations) {
-                *(uint8_t*)loc = bpI;
+                Patching::Write(loc, bpI);
             }
         }
     }
@@ -1754,7 +1756,7 @@ namespace Omnispawn
     void PatchRagolAssetLoading()
     {
         // jnz -> jmp
-        *(uint8_t*)0x00782496 = 0xeb;
+        Patching::Write<uint8_t>(0x00782496, 0xeb);
     }
 
     typedef uint32_t (__cdecl *LoadMapSoundDataFunction)(uint32_t);
@@ -1763,8 +1765,16 @@ namespace Omnispawn
     /// Loads all map-specific .pac files
     void __cdecl LoadSoundDataAllMaps()
     {
+        TRACE_SCOPE("LoadSoundDataAllMaps");
+
         for (uint32_t i = 0; i <= (uint32_t) MapType::MAX_INDEX; i++)
         {
+#ifdef PATCH_TRACING
+            static const char* zoneNames[(size_t) MapType::MAX_INDEX + 1] = {};
+            if (zoneNames[i] == nullptr) zoneNames[i] = Tracing::PersistentName("LoadMapSoundData " + std::to_string(i));
+            Tracing::ScopedZone zone(zoneNames[i]);
+#endif
+
             if (LoadMapSoundData(i) == 0)
             {
                 return;
@@ -136,5 +136,8 @@ namespace Omnispawn
         EP4_END_INDEX = Girtablulu
     };
 
+    /// Transforms a NewBPIndex (new) to a BPIndex (old)
+    uint8_t DecodeNewBpIndex(NewBPIndex i, BattleParam::BPEntryType entryType);
+
     void ApplyOmnispawnPatch();
 };
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "helpers.h"
+#include "patching.h"
+
+namespace Patching
+{
+    const size_t PAGE_SIZE = 0x1000;
+
+    struct PendingWrite
+    {
+        size_t addr;
+        size_t size;
+        /// Offset into pendingBytes
+        size_t offset;
+        const char* owner;
+    };
+
+    /// Contiguous bytes that are written together
+    struct Range
+    {
+        size_t addr;
+        std::vector<uint8_t> bytes;
+
+        size_t End() const { return addr + bytes.size(); }
+    };
+
+    std::vector<PendingWrite> pendingWrites;
+    /// Data of all pending writes, kept in one buffer to avoid an allocation per write
+    std::vector<uint8_t> pendingBytes;
+    /// Original bytes of every range that has been written, in the order they were written
+    std::vector<Range> appliedRanges;
+    bool committed = false;
+    const char* currentOwner = nullptr;
+
+    OwnerScope::OwnerScope(const char* owner) : previousOwner(currentOwner)
+    {
+        currentOwner = owner;
+    }
+
+    OwnerScope::~OwnerScope()
+    {
+        currentOwner = previousOwner;
+    }
+
+    std::string DescribeWrite(const PendingWrite& write)
+    {
+        std::stringstream ss;
+        ss << (write.owner != nullptr ? write.owner : "unnamed patch")
+            << " [" << std::hex << write.addr << ", " << (write.addr + write.size) << ")";
+        return ss.str();
+    }
+
+    /// Makes the pages writable, writes the ranges, restores the protection and flushes the instruction cache
+    void ApplyRanges(const std::vector<Range>& ranges)
+    {
+        if (ranges.empty()) return;
+
+        // Ranges are sorted so the pages will be too
+        std::vector<size_t> pages;
+        for (const auto& range : ranges)
+        {
+            for (size_t page = range.addr & ~(PAGE_SIZE - 1); page < range.End(); page += PAGE_SIZE)
+            {
+                if (pages.empty() || pages.back() != page) pages.push_back(page);
+            }
+        }
+
+        std::vector<DWORD> oldProtections(pages.size());
+        for (size_t i = 0; i < pages.size(); i++)
+        {
+            if (!VirtualProtect((void*) pages[i], PAGE_SIZE, PAGE_EXECUTE_READWRITE, &oldProtections[i]))
+            {
+                for (size_t j = 0; j < i; j++)
+                {
+                    DWORD unused;
+                    VirtualProtect((void*) pages[j], PAGE_SIZE, oldProtections[j], &unused);
+                }
+
+                std::stringstream ss;
+                ss << "Patching: Could not change protection of page " << std::hex << pages[i];
+                throw std::runtime_error(ss.str());
+            }
+        }
+
+        for (const auto& range : ranges)
+        {
+            Range original = {range.addr, std::vector<uint8_t>((uint8_t*) range.addr, (uint8_t*) range.End())};
+            appliedRanges.push_back(std::move(original));
+            memcpy((void*) range.addr, range.bytes.data(), range.bytes.size());
+        }
+
+        for (size_t i = 0; i < pages.size(); i++)
+        {
+            DWORD unused;
+            VirtualProtect((void*) pages[i], PAGE_SIZE, oldProtections[i], &unused);
+        }
+
+        size_t begin = ranges.front().addr;
+        size_t end = ranges.back().End();
+        FlushInstructionCache(GetCurrentProcess(), (void*) begin, end - begin);
+    }
+
+    void WriteBytes(size_t addr, const void* data, size_t size)
+    {
+        if (size == 0) return;
+
+        if (committed)
+        {
+            Range range = {addr, std::vector<uint8_t>((const uint8_t*) data, (const uint8_t*) data + size)};
+            ApplyRanges({range});
+            return;
+        }
+
+        pendingWrites.push_back(PendingWrite{addr, size, pendingBytes.size(), currentOwner});
+        pendingBytes.insert(pendingBytes.end(), (const uint8_t*) data, (const uint8_t*) data + size);
+    }
+
+    void CommitPatches()
+    {
+        if (committed)
+        {
+            throw std::runtime_error("Patching: Tried to commit patches twice");
+        }
+
+        // Stable so that writes to the same address keep their order in the conflict report
+        std::stable_sort(pendingWrites.begin(), pendingWrites.end(), [](const PendingWrite& a, const PendingWrite& b) {
+            return a.addr < b.addr;
+        });
+
+        std::vector<Range> ranges;
+        std::vector<std::string> conflicts;
+        /// The write that reaches furthest in the current range
+        const PendingWrite* furthest = nullptr;
+
+        for (const auto& write : pendingWrites)
+        {
+            const uint8_t* data = pendingBytes.data() + write.offset;
+
+            if (ranges.empty() || write.addr > ranges.back().End())
+            {
+                ranges.push_back(Range{write.addr, std::vector<uint8_t>(data, data + write.size)});
+                furthest = &write;
+                continue;
+            }
+
+            auto& range = ranges.back();
+            size_t overlap = std::min(range.End(), write.addr + write.size) - write.addr;
+
+            // Identical bytes written twice do not conflict, e.g. a shared operand listed by two patches
+            if (overlap > 0 && memcmp(range.bytes.data() + (write.addr - range.addr), data, overlap) != 0)
+            {
+                conflicts.push_back(DescribeWrite(*furthest) + " conflicts with " + DescribeWrite(write));
+            }
+
+            if (write.addr + write.size > range.End())
+            {
+                range.bytes.insert(range.bytes.end(), data + overlap, data + write.size);
+                furthest = &write;
+            }
+        }
+
+        if (!conflicts.empty())
+        {
+            std::string report = "Patching: " + std::to_string(conflicts.size()) + " conflicting patches, nothing was applied";
+            Log(L"%S", report.c_str());
+
+            for (const auto& conflict : conflicts)
+            {
+                report += "\n  " + conflict;
+                Log(L"  %S", conflict.c_str());
+            }
+
+            // The exception most likely takes the process down before the writer thread gets to run
+            Logging::Flush();
+            throw std::runtime_error(report);
+        }
+
+        ApplyRanges(ranges);
+
+        committed = true;
+        pendingWrites.clear();
+        pendingWrites.shrink_to_fit();
+        pendingBytes.clear();
+        pendingBytes.shrink_to_fit();
+    }
+
+    void RollbackPatches()
+    {
+        // Newest first so that overlapping writes done after committing unwind correctly
+        while (!appliedRanges.empty())
+        {
+            Range original = std::move(appliedRanges.back());
+            appliedRanges.pop_back();
+
+            ApplyRanges({original});
+            // ApplyRanges saved the bytes we just overwrote, which are not needed
+            appliedRanges.pop_back();
+        }
+    }
+};
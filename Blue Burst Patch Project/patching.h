@@ -15,3 +15,56 @@
 #else
 #define XASM(...) asm (#__VA_ARGS__)
 #endif
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Every write into the game's code or data during startup goes through the patch journal.
+ * Writes are queued until CommitPatches is called, which applies all of them at once
+ * and refuses to apply anything if two patches disagree about the contents of the same bytes.
+ */
+namespace Patching
+{
+    /**
+     * @brief Queues the bytes to be written at the address.
+     * The data is copied so it does not need to outlive the call.
+     * After CommitPatches the bytes are written immediately instead.
+     */
+    void WriteBytes(size_t addr, const void* data, size_t size);
+
+    template<typename T>
+    void Write(size_t addr, const T& value)
+    {
+        WriteBytes(addr, &value, sizeof(T));
+    }
+
+    /// Writes queued while this is alive are attributed to the owner in conflict reports
+    class OwnerScope
+    {
+    private:
+        const char* previousOwner;
+
+    public:
+        OwnerScope(const char* owner);
+        ~OwnerScope();
+    };
+
+    /// Runs the function with its writes attributed to the owner
+    template<typename F>
+    void ApplyAs(const char* owner, F apply)
+    {
+        OwnerScope scope(owner);
+        apply();
+    }
+
+    /**
+     * @brief Applies all queued writes with one protection change per page and one instruction cache flush.
+     * Overlapping writes are merged if they agree on the overlapping bytes.
+     * Otherwise nothing is applied and std::runtime_error is thrown describing every conflict.
+     */
+    void CommitPatches();
+
+    /// Restores the original bytes of every applied write, newest first
+    void RollbackPatches();
+};
@@ -0,0 +1,89 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "profile_report.h"
+
+namespace ProfileReport
+{
+    bool Write(const char* path, const std::vector<Entry>& entries)
+    {
+        FILE* file = nullptr;
+        if (fopen_s(&file, path, "w") != 0 || file == nullptr) return false;
+
+        fputs("{\n", file);
+
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            const auto& entry = entries[i];
+
+            fputs("  \"", file);
+            for (char c : entry.name)
+            {
+                if (c == '"' || c == '\\') fputc('\\', file);
+                fputc(c, file);
+            }
+
+            fprintf(file, "\": {\"count\": %llu, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f}%s\n",
+                (unsigned long long) entry.count, entry.p50, entry.p99, entry.max,
+                i + 1 < entries.size() ? "," : "");
+        }
+
+        fputs("}\n", file);
+        fclose(file);
+        return true;
+    }
+
+    bool ReadBaseline(const char* path, std::map<std::string, BaselineEntry>& baseline)
+    {
+        FILE* file = nullptr;
+        if (fopen_s(&file, path, "r") != 0 || file == nullptr) return false;
+
+        // Not a general JSON parser, it relies on Write putting every entry on its own line
+        char line[1024];
+        while (fgets(line, sizeof(line), file) != nullptr)
+        {
+            const char* p = strchr(line, '"');
+            if (p == nullptr) continue;
+
+            std::string name;
+            for (p++; *p != 0 && *p != '"'; p++)
+            {
+                if (*p == '\\' && p[1] != 0) p++;
+                name += *p;
+            }
+
+            const char* p50 = strstr(p, "\"p50\":");
+            if (p50 == nullptr) continue;
+
+            const char* tolerance = strstr(p, "\"tolerance\":");
+            baseline[name] = BaselineEntry{
+                strtod(p50 + strlen("\"p50\":"), nullptr),
+                tolerance != nullptr ? strtod(tolerance + strlen("\"tolerance\":"), nullptr) : DEFAULT_TOLERANCE
+            };
+        }
+
+        fclose(file);
+        return true;
+    }
+
+    std::vector<Regression> FindRegressions(const std::vector<Entry>& entries, const std::map<std::string, BaselineEntry>& baseline)
+    {
+        std::vector<Regression> regressions;
+
+        for (const auto& entry : entries)
+        {
+            auto found = baseline.find(entry.name);
+            if (found == baseline.end() || entry.count == 0) continue;
+
+            double limit = found->second.p50 * (1.0 + found->second.tolerance);
+            if (entry.p50 > limit)
+            {
+                regressions.push_back(Regression{entry.name, entry.p50, found->second.p50, limit});
+            }
+        }
+
+        return regressions;
+    }
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Timing reports in JSON, one entry per line, and their comparison with a baseline, which is simply a report written earlier.
+ * Used by the profiler in the game and by the benchmarks in host/. Durations are in microseconds.
+ */
+namespace ProfileReport
+{
+    /// Allowed slowdown of an entry's median compared to the baseline, as a fraction of the baseline
+    const double DEFAULT_TOLERANCE = 0.1;
+
+    struct Entry
+    {
+        std::string name;
+        uint64_t count;
+        double p50;
+        double p99;
+        double max;
+    };
+
+    struct BaselineEntry
+    {
+        double p50;
+        double tolerance;
+    };
+
+    struct Regression
+    {
+        std::string name;
+        double p50;
+        double baseline;
+        double limit;
+    };
+
+    /// Returns false if the file could not be opened
+    bool Write(const char* path, const std::vector<Entry>& entries);
+
+    /**
+     * @brief Reads a report written by Write. Entries can have a "tolerance" field that overrides DEFAULT_TOLERANCE.
+     * Returns false if the file could not be opened.
+     */
+    bool ReadBaseline(const char* path, std::map<std::string, BaselineEntry>& baseline);
+
+    /// Entries whose median got slower than their baseline allows. Entries without samples or without a baseline are skipped.
+    std::vector<Regression> FindRegressions(const std::vector<Entry>& entries, const std::map<std::string, BaselineEntry>& baseline);
+};
@@ -0,0 +1,172 @@
+#ifdef PATCH_PROFILER
+
+#include <algorithm>
+#include <limits>
+#include <list>
+#include <map>
+#include <vector>
+#include "helpers.h"
+#include "keyboard.h"
+#include "newgfx/texture_cache.h"
+#include "profile_report.h"
+#include "profiler.h"
+
+namespace Profiler
+{
+    const char* REPORT_PATH = "log\\profile.json";
+    /// Optional, in the game directory
+    const char* BASELINE_PATH = "profile_baseline.json";
+
+    /// Histograms are never removed so references to them stay valid
+    std::list<Histogram> histograms;
+
+    /// Reference point for converting rdtsc cycles to wall clock time
+    struct CalibrationPoint
+    {
+        uint64_t cycles;
+        LARGE_INTEGER counter;
+
+        CalibrationPoint()
+        {
+            QueryPerformanceCounter(&counter);
+            cycles = Timestamp();
+        }
+    };
+
+    const CalibrationPoint startPoint;
+
+    double CyclesPerMicrosecond()
+    {
+        CalibrationPoint now;
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+
+        double elapsedMicroseconds = double(now.counter.QuadPart - startPoint.counter.QuadPart) * 1000000.0 / double(frequency.QuadPart);
+        if (elapsedMicroseconds <= 0.0) return 1.0;
+
+        return double(now.cycles - startPoint.cycles) / elapsedMicroseconds;
+    }
+
+    Histogram::Histogram(const std::string& name) :
+        name(name), samples{}, nextSample(0), sampleCount(0), totalCount(0) {}
+
+    void Histogram::Record(uint64_t cycles)
+    {
+        samples[nextSample] = (uint32_t) std::min<uint64_t>(cycles, std::numeric_limits<uint32_t>::max());
+        nextSample = (nextSample + 1) % SAMPLE_COUNT;
+        sampleCount = std::min(sampleCount + 1, SAMPLE_COUNT);
+        totalCount++;
+    }
+
+    const std::string& Histogram::Name() const
+    {
+        return name;
+    }
+
+    Histogram::Summary Histogram::Summarize() const
+    {
+        Summary summary = {totalCount, 0.0, 0.0, 0.0};
+        if (sampleCount == 0) return summary;
+
+        // Ring buffer order does not matter for percentiles
+        std::vector<uint32_t> sorted(samples, samples + sampleCount);
+        std::sort(sorted.begin(), sorted.end());
+
+        double scale = 1.0 / CyclesPerMicrosecond();
+        summary.p50 = sorted[(sorted.size() - 1) * 50 / 100] * scale;
+        summary.p99 = sorted[(sorted.size() - 1) * 99 / 100] * scale;
+        summary.max = sorted.back() * scale;
+        return summary;
+    }
+
+    Histogram& CreateHistogram(const std::string& name)
+    {
+        histograms.emplace_back(name);
+        return histograms.back();
+    }
+
+    const std::list<Histogram>& Histograms()
+    {
+        return histograms;
+    }
+
+    void Dump()
+    {
+        Log(L"Profiler: %u histograms, last %u samples each (microseconds)", (unsigned) histograms.size(), (unsigned) SAMPLE_COUNT);
+
+        for (const auto& histogram : histograms)
+        {
+            auto summary = histogram.Summarize();
+            Log(L"%S: count=%llu p50=%.2f p99=%.2f max=%.2f",
+                histogram.Name().c_str(), summary.count, summary.p50, summary.p99, summary.max);
+        }
+    }
+
+#ifdef USE_NEWGFX
+    /// Every loaded texture, largest first, to see what the video memory on the HUD is spent on
+    void DumpTextures()
+    {
+        auto textures = TextureCache::Textures();
+        std::sort(textures.begin(), textures.end(), [](const auto& a, const auto& b) {
+            return a.bytes > b.bytes;
+        });
+
+        Log(L"Profiler: %u textures, %u KB", (unsigned) textures.size(), (unsigned) (TextureCache::TotalBytes() / 1024));
+        for (const auto& texture : textures)
+        {
+            Log(L"%S: %u KB, %u users", texture.label.c_str(), (unsigned) (texture.bytes / 1024), (unsigned) texture.users);
+        }
+    }
+#endif
+
+    /// The summaries of every histogram as report entries
+    std::vector<ProfileReport::Entry> ReportEntries()
+    {
+        std::vector<ProfileReport::Entry> entries;
+        for (const auto& histogram : histograms)
+        {
+            auto summary = histogram.Summarize();
+            entries.push_back(ProfileReport::Entry{histogram.Name(), summary.count, summary.p50, summary.p99, summary.max});
+        }
+
+        return entries;
+    }
+
+    void WriteReport(const char* path)
+    {
+        if (!ProfileReport::Write(path, ReportEntries()))
+        {
+            Log(L"Profiler: Could not open %S", path);
+        }
+    }
+
+    size_t CompareWithBaseline(const char* path)
+    {
+        std::map<std::string, ProfileReport::BaselineEntry> baseline;
+        if (!ProfileReport::ReadBaseline(path, baseline)) return 0;
+
+        auto regressions = ProfileReport::FindRegressions(ReportEntries(), baseline);
+        for (const auto& regression : regressions)
+        {
+            Log(L"Profiler: %S regressed, p50=%.2f baseline=%.2f limit=%.2f",
+                regression.name.c_str(), regression.p50, regression.baseline, regression.limit);
+        }
+
+        Log(L"Profiler: %u regressions against %S", (unsigned) regressions.size(), path);
+        return regressions.size();
+    }
+
+    void ApplyProfilerPatch()
+    {
+        Keyboard::onKeyDown({Keyboard::Keycode::Ctrl, Keyboard::Keycode::P}, []() {
+            Dump();
+#ifdef USE_NEWGFX
+            DumpTextures();
+#endif
+            WriteReport(REPORT_PATH);
+            CompareWithBaseline(BASELINE_PATH);
+        });
+    }
+};
+
+#endif // PATCH_PROFILER
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <intrin.h>
+#include "common.h"
+
+namespace Profiler
+{
+    /// How many of the most recent samples each histogram keeps
+    const size_t SAMPLE_COUNT = 512;
+
+    /// Rolling window of durations for one piece of code
+    class Histogram
+    {
+    private:
+        std::string name;
+        uint32_t samples[SAMPLE_COUNT];
+        size_t nextSample;
+        size_t sampleCount;
+        uint64_t totalCount;
+
+    public:
+        struct Summary
+        {
+            uint64_t count;
+            double p50;
+            double p99;
+            double max;
+        };
+
+        Histogram(const std::string& name);
+        void Record(uint64_t cycles);
+        const std::string& Name() const;
+        /// Durations are in microseconds
+        Summary Summarize() const;
+    };
+
+    /// The returned histogram lives for the entire lifetime of the program
+    Histogram& CreateHistogram(const std::string& name);
+    const std::list<Histogram>& Histograms();
+
+    inline uint64_t Timestamp()
+    {
+        return __rdtsc();
+    }
+
+    /// Records the time spent between construction and destruction
+    class ScopedTimer
+    {
+    private:
+        Histogram& histogram;
+        uint64_t start;
+
+    public:
+        ScopedTimer(Histogram& histogram) : histogram(histogram), start(Timestamp()) {}
+        ~ScopedTimer() { histogram.Record(Timestamp() - start); }
+    };
+
+    /// Writes a summary of every histogram into the log
+    void Dump();
+
+    /// Writes the summary of every histogram into a JSON file, see profile_report.h
+    void WriteReport(const char* path);
+
+    /**
+     * @brief Compares the median of every histogram with a report written earlier by WriteReport and logs the ones that got slower.
+     * Entries in the baseline can have a "tolerance" field that overrides ProfileReport::DEFAULT_TOLERANCE.
+     * Returns the number of regressions.
+     */
+    size_t CompareWithBaseline(const char* path);
+
+    void ApplyProfilerPatch();
+};
+
+/// Time the rest of the enclosing scope. Expands to nothing unless PATCH_PROFILER is enabled.
+#ifdef PATCH_PROFILER
+#define PROFILE_SCOPE(name) \
+    static Profiler::Histogram& CONCAT(_profilerHistogram, __LINE__) = Profiler::CreateHistogram(name); \
+    Profiler::ScopedTimer CONCAT(_profilerTimer, __LINE__)(CONCAT(_profilerHistogram, __LINE__))
+#else
+#define PROFILE_SCOPE(name)
+#endif
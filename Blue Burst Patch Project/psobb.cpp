@@ -1,6 +1,8 @@
 #include <cstring>
 #include <stdint.h>
 #include "globals.h"
+#include "helpers.h"
+#include "patching.h"
 
 // These should be specified in the project's preprocessor macros to enable.
 // Alternatively in the future, maybe they could go into pch.h or a file included there.
@@ -20,6 +22,17 @@
 #define PATCH_ENEMY_CONSTRUCTOR_LISTS
 #define PATCH_EDITORS
 #define PATCH_INITLISTS
+#define PATCH_PROFILER
+#define PATCH_TRACING
+#define PATCH_HUD
+#define PATCH_ENTITY_INDEX
+#define PATCH_ENTITY_SNAPSHOT
+#define PATCH_COLLISION_BROADPHASE
+#define PATCH_GROUND_CACHE
+#define PATCH_NAVIGATION
+#define PATCH_AI_SCHEDULER
+#define PATCH_ANIMATION_LOD
+#define PATCH_POSE_CACHE
 #endif
 
 #ifdef PATCH_IME
@@ -70,6 +83,46 @@
 #include "editors.h"
 #endif
 
+#ifdef PATCH_PROFILER
+#include "profiler.h"
+#endif
+
+#ifdef PATCH_TRACING
+#include "trace.h"
+#endif
+
+#ifdef PATCH_HUD
+#include "hud.h"
+#endif
+
+#ifdef PATCH_ENTITY_INDEX
+#include "entitylist.h"
+#endif
+
+#ifdef PATCH_ENTITY_SNAPSHOT
+#include "entity_snapshot.h"
+#endif
+
+#ifdef PATCH_COLLISION_BROADPHASE
+#include "collision.h"
+#endif
+
+#ifdef PATCH_GROUND_CACHE
+#include "ground_cache.h"
+#endif
+
+#ifdef PATCH_NAVIGATION
+#include "navigation.h"
+#endif
+
+#ifdef PATCH_AI_SCHEDULER
+#include "ai_scheduler.h"
+#endif
+
+#ifdef PATCH_POSE_CACHE
+#include "newgfx/pose_cache.h"
+#endif
+
 #ifdef PATCH_HOOKS
 #include "hooking.h"
 #endif
@@ -82,68 +135,115 @@ void PSOBB()
 {
     // By default, keep the game guard patch enabled
 #ifndef DO_NOT_PATCH_DISABLE_GAMEGUARD
-    memset((void*)addrMainGameGuardCall, 0x90, 0x05);
+    Patching::ApplyAs("disable gameguard", []() {
+        PatchNOP(addrMainGameGuardCall, 0x05);
+    });
 #endif
 
 #ifdef PATCH_EARLY_WALK_FIX
-    ApplyEarlyWalkFix();
+    Patching::ApplyAs("PATCH_EARLY_WALK_FIX", ApplyEarlyWalkFix);
 #endif
 
 #ifdef PATCH_KEYBOARD_ALTERNATE_PALETTE
-    PatchPalette();
+    Patching::ApplyAs("PATCH_KEYBOARD_ALTERNATE_PALETTE", PatchPalette);
 #endif
 
 #ifdef PATCH_SLOW_GIBBLES_FIX
-    ApplySlowGibblesFix();
+    Patching::ApplyAs("PATCH_SLOW_GIBBLES_FIX", ApplySlowGibblesFix);
 #endif
 
 #ifdef PATCH_CUSTOMIZE_MENU
-    CustomizeMenu::ApplyActionListPatch();
+    Patching::ApplyAs("PATCH_CUSTOMIZE_MENU", CustomizeMenu::ApplyActionListPatch);
 #endif
 
 #ifdef PATCH_UNSELLABLE_RARES
-    PatchShop();
+    Patching::ApplyAs("PATCH_UNSELLABLE_RARES", PatchShop);
 #endif
 
 #ifdef PATCH_IME
-    PatchIme();
+    Patching::ApplyAs("PATCH_IME", PatchIme);
 #endif
 
 #ifdef PATCH_FASTWARP
-    ApplyFastWarpPatch();
+    Patching::ApplyAs("PATCH_FASTWARP", ApplyFastWarpPatch);
 #endif
 
 #ifdef PATCH_SKIP_INTRO_CREDITS
-    *(uint8_t*)0x007a645e = 2;
+    Patching::ApplyAs("PATCH_SKIP_INTRO_CREDITS", []() {
+        Patching::Write<uint8_t>(0x007a645e, 2);
+    });
 #endif
 
 #ifdef PATCH_OMNISPAWN
-    Omnispawn::ApplyOmnispawnPatch();
+    Patching::ApplyAs("PATCH_OMNISPAWN", Omnispawn::ApplyOmnispawnPatch);
 #endif
 
 #ifdef PATCH_NEWENEMY
-    ApplyNewEnemyPatch();
+    Patching::ApplyAs("PATCH_NEWENEMY", ApplyNewEnemyPatch);
 #endif
 
 #ifdef PATCH_LARGE_ASSETS
-    ApplyLargeAssetsPatch();
+    Patching::ApplyAs("PATCH_LARGE_ASSETS", ApplyLargeAssetsPatch);
 #endif
 
 #ifdef PATCH_ENEMY_CONSTRUCTOR_LISTS
-    Enemy::PatchEnemyConstructorLists();
+    Patching::ApplyAs("PATCH_ENEMY_CONSTRUCTOR_LISTS", Enemy::PatchEnemyConstructorLists);
 #endif
 
 #ifdef PATCH_EDITORS
-    ApplyEditorPatch();
+    Patching::ApplyAs("PATCH_EDITORS", ApplyEditorPatch);
+#endif
+
+#ifdef PATCH_PROFILER
+    Patching::ApplyAs("PATCH_PROFILER", Profiler::ApplyProfilerPatch);
+#endif
+
+#ifdef PATCH_TRACING
+    Patching::ApplyAs("PATCH_TRACING", Tracing::ApplyTracingPatch);
+#endif
+
+#ifdef PATCH_HUD
+    Patching::ApplyAs("PATCH_HUD", Hud::ApplyHudPatch);
+#endif
+
+#ifdef PATCH_ENTITY_INDEX
+    Patching::ApplyAs("PATCH_ENTITY_INDEX", EntityList::ApplyEntityIndexPatch);
+#endif
+
+#ifdef PATCH_ENTITY_SNAPSHOT
+    Patching::ApplyAs("PATCH_ENTITY_SNAPSHOT", EntitySnapshot::ApplyEntitySnapshotPatch);
+#endif
+
+#ifdef PATCH_COLLISION_BROADPHASE
+    Patching::ApplyAs("PATCH_COLLISION_BROADPHASE", Collision::ApplyCollisionBroadphasePatch);
+#endif
+
+#ifdef PATCH_GROUND_CACHE
+    Patching::ApplyAs("PATCH_GROUND_CACHE", GroundCache::ApplyGroundCachePatch);
+#endif
+
+#ifdef PATCH_NAVIGATION
+    Patching::ApplyAs("PATCH_NAVIGATION", Navigation::ApplyNavigationPatch);
+#endif
+
+#ifdef PATCH_AI_SCHEDULER
+    Patching::ApplyAs("PATCH_AI_SCHEDULER", AiScheduler::ApplyAiSchedulerPatch);
+#endif
+
+#ifdef PATCH_POSE_CACHE
+    Patching::ApplyAs("PATCH_POSE_CACHE", PoseCache::ApplyPoseCachePatch);
 #endif
 
 #ifdef PATCH_HOOKS
     // Should be last so that other patches can create their hooks first
-    Hooking::InstallAllHooks();
+    Patching::ApplyAs("PATCH_HOOKS", Hooking::InstallAllHooks);
 #endif
 
 #ifdef PATCH_INITLISTS
     // Should be last so that other patches can apply their changes first
-    InitList::PatchAllInitLists();
+    Patching::ApplyAs("PATCH_INITLISTS", InitList::PatchAllInitLists);
 #endif
+
+    // Everything above only queued its writes, nothing is in effect before this
+    Patching::CommitPatches();
 }
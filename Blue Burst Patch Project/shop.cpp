@@ -1,5 +1,6 @@
 #ifdef PATCH_UNSELLABLE_RARES
 #include "helpers.h"
+#include "patching.h"
 #include "shop.h"
 
 void __declspec(naked) NoSellRareTool()
@@ -30,9 +31,9 @@ void PatchShop()
 
     if (reg_noRareSale == 1)
     {
-        *(int*)addrNoSellUntekkedWeapon = 0;
-        *(int*)addrNoSellRareWeapon = 0;
-        *(int*)addrNoSellRareArmor = 0;
+        Patching::Write<int>(addrNoSellUntekkedWeapon, 0);
+        Patching::Write<int>(addrNoSellRareWeapon, 0);
+        Patching::Write<int>(addrNoSellRareArmor, 0);
 
         PatchJMP(addrNoSellRareToolI, addrNoSellRareToolO, (int)&NoSellRareTool);
     }
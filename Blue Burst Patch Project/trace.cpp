@@ -0,0 +1,190 @@
+#ifdef PATCH_TRACING
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include "bounded_queue.h"
+#include "detour.h"
+#include "helpers.h"
+#include "hooking.h"
+#include "trace.h"
+
+namespace Tracing
+{
+    const size_t QUEUE_CAPACITY = 16384;
+    /// How long the writer thread sleeps when there is nothing to write
+    const DWORD WRITER_IDLE_MS = 100;
+
+    struct Event
+    {
+        const char* name;
+        /// QueryPerformanceCounter ticks
+        int64_t timestamp;
+        DWORD threadId;
+        /// Chrome trace event phase: B, E or i
+        char phase;
+    };
+
+    BoundedQueue<Event, QUEUE_CAPACITY> queue;
+    std::atomic<uint32_t> droppedCount(0);
+    uint32_t reportedDroppedCount = 0;
+    std::atomic<bool> writerStarted(false);
+
+    std::list<std::string> persistentNames;
+
+    DWORD WINAPI WriterThread(LPVOID);
+
+    void Record(const char* name, char phase)
+    {
+        if (!writerStarted.load(std::memory_order_relaxed) && !writerStarted.exchange(true))
+        {
+            HANDLE thread = CreateThread(nullptr, 0, WriterThread, nullptr, 0, nullptr);
+            if (thread != nullptr) CloseHandle(thread);
+        }
+
+        Event* event = queue.Reserve();
+        if (event == nullptr)
+        {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        event->name = name;
+        event->timestamp = now.QuadPart;
+        event->threadId = GetCurrentThreadId();
+        event->phase = phase;
+        queue.Publish(event);
+    }
+
+    void __cdecl BeginZone(const char* name)
+    {
+        Record(name, 'B');
+    }
+
+    void __cdecl EndZone(const char* name)
+    {
+        Record(name, 'E');
+    }
+
+    void Instant(const char* name)
+    {
+        Record(name, 'i');
+    }
+
+    const char* PersistentName(const std::string& name)
+    {
+        persistentNames.push_back(name);
+        return persistentNames.back().c_str();
+    }
+
+    void (__cdecl *WrapFunction(void (__cdecl *func)(), const char* name))()
+    {
+        uint8_t* thunk = Hooking::AllocateExecutableMemory(32);
+        uint8_t* p = thunk;
+
+        auto writeRel32 = [&p](size_t dest) {
+            int32_t rel = (int32_t) (dest - ((size_t) p + 4));
+            memcpy(p, &rel, sizeof(rel));
+            p += 4;
+        };
+
+        auto writeNameCall = [&](void (__cdecl *zoneFunc)(const char*)) {
+            *p++ = 0x68; // push name
+            memcpy(p, &name, sizeof(name));
+            p += 4;
+            *p++ = 0xe8; // call zoneFunc
+            writeRel32((size_t) zoneFunc);
+            *p++ = 0x83; // add esp, 4
+            *p++ = 0xc4;
+            *p++ = 0x04;
+        };
+
+        writeNameCall(BeginZone);
+        *p++ = 0xe8; // call func
+        writeRel32((size_t) func);
+        writeNameCall(EndZone);
+        *p++ = 0xc3; // ret
+
+        return reinterpret_cast<void (__cdecl *)()>(thunk);
+    }
+
+    void ApplyTracingPatch()
+    {
+        Hooking::afterSceneUpdate.AddCallback([](void*) {
+            Instant("Frame");
+        }, nullptr, "Tracing frame marker");
+    }
+
+    /// Writes a JSON string literal without the surrounding quotes
+    void WriteEscaped(FILE* file, const char* str)
+    {
+        for (; *str != 0; str++)
+        {
+            if (*str == '"' || *str == '\\') fputc('\\', file);
+            if ((unsigned char) *str >= 0x20) fputc(*str, file);
+        }
+    }
+
+    DWORD WINAPI WriterThread(LPVOID)
+    {
+        FILE* file = nullptr;
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        double microsecondsPerTick = 1000000.0 / double(frequency.QuadPart);
+
+        while (true)
+        {
+            if (file == nullptr)
+            {
+                if (fopen_s(&file, "log\\trace.json", "w") != 0 || file == nullptr)
+                {
+                    file = nullptr;
+                    Sleep(WRITER_IDLE_MS);
+                    continue;
+                }
+
+                // The closing bracket is optional in the trace event format, which means the file is valid even if the game crashes
+                fputs("[\n", file);
+            }
+
+            size_t count = 0;
+
+            uint32_t dropped = droppedCount.load(std::memory_order_relaxed);
+            if (dropped != reportedDroppedCount)
+            {
+                Log(L"Tracing: Dropped %u events because the queue was full", dropped - reportedDroppedCount);
+                reportedDroppedCount = dropped;
+            }
+
+            while (Event* event = queue.Peek())
+            {
+                fputs("{\"name\":\"", file);
+                WriteEscaped(file, event->name);
+                fprintf(file, "\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu%s},\n",
+                    event->phase,
+                    double(event->timestamp) * microsecondsPerTick,
+                    (unsigned long) event->threadId,
+                    event->phase == 'i' ? ",\"s\":\"t\"" : "");
+
+                queue.Pop();
+                count++;
+            }
+
+            if (count == 0)
+            {
+                Sleep(WRITER_IDLE_MS);
+            }
+            else
+            {
+                fflush(file);
+            }
+        }
+
+        return 0;
+    }
+};
+
+#endif // PATCH_TRACING
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "common.h"
+
+/**
+ * Timeline of what the game spends its time on, written into log\trace.json in the Chrome trace event format.
+ * Open the file in chrome://tracing or ui.perfetto.dev.
+ * Events are queued without locks and written by a background thread.
+ */
+namespace Tracing
+{
+    /// Event names must outlive the program, i.e. literals or strings from PersistentName
+    void __cdecl BeginZone(const char* name);
+    void __cdecl EndZone(const char* name);
+    void Instant(const char* name);
+
+    /// Returns a copy of the string that is never freed
+    const char* PersistentName(const std::string& name);
+
+    /**
+     * @brief Returns a function that calls the given function inside a trace zone.
+     * Only works for functions that take no arguments.
+     */
+    void (__cdecl *WrapFunction(void (__cdecl *func)(), const char* name))();
+
+    /// Marks every frame on the timeline
+    void ApplyTracingPatch();
+
+    /// Records a zone from construction to destruction
+    class ScopedZone
+    {
+    private:
+        const char* name;
+
+    public:
+        ScopedZone(const char* name) : name(name) { BeginZone(name); }
+        ~ScopedZone() { EndZone(name); }
+    };
+};
+
+/// Trace the rest of the enclosing scope. These expand to nothing unless PATCH_TRACING is enabled.
+#ifdef PATCH_TRACING
+#define TRACE_SCOPE(name) Tracing::ScopedZone CONCAT(_traceZone, __LINE__)(name)
+#define TRACE_INSTANT(name) Tracing::Instant(name)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_INSTANT(name)
+#endif
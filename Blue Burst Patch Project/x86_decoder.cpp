@@ -0,0 +1,302 @@
+#include <array>
+#include "x86_decoder.h"
+
+namespace X86
+{
+    // Opcode properties
+    enum OpFlag : uint16_t
+    {
+        /// Not a supported instruction
+        Invalid = 1 << 0,
+        /// Followed by a ModRM byte
+        ModRM = 1 << 1,
+        /// 8-bit immediate
+        Imm8 = 1 << 2,
+        /// 16-bit immediate
+        Imm16 = 1 << 3,
+        /// 32-bit immediate, or 16-bit with the operand size prefix
+        ImmZ = 1 << 4,
+        /// 32-bit memory offset, or 16-bit with the address size prefix
+        MemOffset = 1 << 5,
+        /// Far pointer (immZ + 16-bit segment)
+        FarPtr = 1 << 6,
+        /// Relative 8-bit branch
+        Rel8 = 1 << 7,
+        /// Relative 32-bit branch, or 16-bit with the operand size prefix
+        RelZ = 1 << 8,
+        /// Group 3: TEST r/m, imm is encoded as /0 and /1
+        Group3 = 1 << 9,
+        /// ModRM with mod == 3 would be a VEX/EVEX prefix, which we do not support
+        NoRegisterForm = 1 << 10,
+        /// Instruction prefix
+        Prefix = 1 << 11
+    };
+
+    typedef std::array<uint16_t, 256> OpcodeTable;
+
+    constexpr void SetRange(OpcodeTable& table, size_t first, size_t last, uint16_t flags)
+    {
+        for (size_t i = first; i <= last; i++) table[i] = flags;
+    }
+
+    constexpr OpcodeTable MakeOneByteTable()
+    {
+        OpcodeTable t = {};
+
+        // ALU operations (add, or, adc, sbb, and, sub, xor, cmp) share the same layout in each row
+        for (size_t row = 0x00; row <= 0x38; row += 8)
+        {
+            SetRange(t, row + 0, row + 3, ModRM);
+            t[row + 4] = Imm8;
+            t[row + 5] = ImmZ;
+        }
+
+        // Segment overrides
+        t[0x26] = t[0x2e] = t[0x36] = t[0x3e] = t[0x64] = t[0x65] = Prefix;
+        // Operand size, address size
+        t[0x66] = t[0x67] = Prefix;
+        // 0x0f is handled separately as an escape
+
+        t[0x62] = ModRM | NoRegisterForm; // bound
+        t[0x63] = ModRM; // arpl
+        t[0x68] = ImmZ;
+        t[0x69] = ModRM | ImmZ;
+        t[0x6a] = Imm8;
+        t[0x6b] = ModRM | Imm8;
+        SetRange(t, 0x70, 0x7f, Rel8);
+        t[0x80] = t[0x82] = t[0x83] = ModRM | Imm8;
+        t[0x81] = ModRM | ImmZ;
+        SetRange(t, 0x84, 0x8f, ModRM);
+        t[0x9a] = FarPtr;
+        SetRange(t, 0xa0, 0xa3, MemOffset);
+        t[0xa8] = Imm8;
+        t[0xa9] = ImmZ;
+        SetRange(t, 0xb0, 0xb7, Imm8);
+        SetRange(t, 0xb8, 0xbf, ImmZ);
+        t[0xc0] = t[0xc1] = ModRM | Imm8;
+        t[0xc2] = Imm16;
+        t[0xc4] = t[0xc5] = ModRM | NoRegisterForm; // les, lds
+        t[0xc6] = ModRM | Imm8;
+        t[0xc7] = ModRM | ImmZ;
+        t[0xc8] = Imm16 | Imm8; // enter
+        t[0xca] = Imm16;
+        t[0xcd] = Imm8;
+        SetRange(t, 0xd0, 0xd3, ModRM);
+        t[0xd4] = t[0xd5] = Imm8;
+        SetRange(t, 0xd8, 0xdf, ModRM); // x87
+        SetRange(t, 0xe0, 0xe3, Rel8);
+        SetRange(t, 0xe4, 0xe7, Imm8);
+        t[0xe8] = t[0xe9] = RelZ;
+        t[0xea] = FarPtr;
+        t[0xeb] = Rel8;
+        t[0xf0] = t[0xf2] = t[0xf3] = Prefix;
+        t[0xf6] = ModRM | Group3;
+        t[0xf7] = ModRM | Group3;
+        t[0xfe] = t[0xff] = ModRM;
+
+        return t;
+    }
+
+    constexpr OpcodeTable MakeTwoByteTable()
+    {
+        OpcodeTable t = {};
+
+        SetRange(t, 0x00, 0x03, ModRM);
+        t[0x04] = t[0x0a] = t[0x0c] = Invalid;
+        t[0x0d] = ModRM; // prefetch
+        t[0x0f] = ModRM | Imm8; // 3DNow!
+        SetRange(t, 0x10, 0x1f, ModRM);
+        SetRange(t, 0x20, 0x23, ModRM);
+        SetRange(t, 0x24, 0x27, Invalid);
+        SetRange(t, 0x28, 0x2f, ModRM);
+        // 0x38 and 0x3a are handled separately as escapes
+        t[0x36] = t[0x39] = Invalid;
+        SetRange(t, 0x3b, 0x3f, Invalid);
+        SetRange(t, 0x40, 0x6f, ModRM);
+        SetRange(t, 0x70, 0x73, ModRM | Imm8);
+        SetRange(t, 0x74, 0x76, ModRM);
+        SetRange(t, 0x78, 0x79, ModRM);
+        t[0x7a] = t[0x7b] = Invalid;
+        SetRange(t, 0x7c, 0x7f, ModRM);
+        SetRange(t, 0x80, 0x8f, RelZ);
+        SetRange(t, 0x90, 0x9f, ModRM);
+        t[0xa3] = t[0xa5] = t[0xab] = t[0xad] = t[0xae] = t[0xaf] = ModRM;
+        t[0xa4] = t[0xac] = ModRM | Imm8;
+        t[0xa6] = t[0xa7] = Invalid;
+        SetRange(t, 0xb0, 0xbf, ModRM);
+        t[0xba] = ModRM | Imm8;
+        t[0xc0] = t[0xc1] = t[0xc3] = t[0xc7] = ModRM;
+        t[0xc2] = t[0xc4] = t[0xc5] = t[0xc6] = ModRM | Imm8;
+        SetRange(t, 0xd0, 0xff, ModRM);
+
+        return t;
+    }
+
+    constexpr OpcodeTable oneByteOpcodes = MakeOneByteTable();
+    constexpr OpcodeTable twoByteOpcodes = MakeTwoByteTable();
+
+    /// Length of the ModRM byte and everything that follows it before the immediate
+    size_t ModRMLength(const uint8_t* modrmPtr, bool addressSize16)
+    {
+        uint8_t modrm = *modrmPtr;
+        uint8_t mod = modrm >> 6;
+        uint8_t rm = modrm & 7;
+
+        if (mod == 3) return 1;
+
+        if (addressSize16)
+        {
+            if (mod == 0) return rm == 6 ? 3 : 1;
+            return mod == 1 ? 2 : 3;
+        }
+
+        size_t length = 1;
+
+        if (rm == 4)
+        {
+            // SIB byte follows
+            uint8_t sib = modrmPtr[1];
+            length++;
+
+            if (mod == 0 && (sib & 7) == 5) return length + 4;
+        }
+        else if (mod == 0 && rm == 5)
+        {
+            // Absolute disp32
+            return length + 4;
+        }
+
+        if (mod == 1) return length + 1;
+        if (mod == 2) return length + 4;
+
+        return length;
+    }
+
+    Instruction Decode(const uint8_t* code)
+    {
+        Instruction insn = {};
+        const uint8_t* p = code;
+        bool operandSize16 = false;
+        bool addressSize16 = false;
+
+        // Prefixes
+        while (oneByteOpcodes[*p] & Prefix)
+        {
+            if (*p == 0x66) operandSize16 = true;
+            if (*p == 0x67) addressSize16 = true;
+            p++;
+            if (size_t(p - code) >= MAX_INSTRUCTION_LENGTH) return Instruction{};
+        }
+
+        insn.opcodeOffset = p - code;
+
+        uint16_t flags;
+        uint8_t opcode = *p++;
+
+        if (opcode == 0x0f)
+        {
+            uint8_t opcode2 = *p++;
+
+            if (opcode2 == 0x38)
+            {
+                p++;
+                flags = ModRM;
+            }
+            else if (opcode2 == 0x3a)
+            {
+                p++;
+                flags = ModRM | Imm8;
+            }
+            else
+            {
+                flags = twoByteOpcodes[opcode2];
+            }
+
+            if (flags & RelZ) insn.branchType = BranchType::ConditionalJump;
+        }
+        else
+        {
+            flags = oneByteOpcodes[opcode];
+
+            if (flags & (Rel8 | RelZ))
+            {
+                if (opcode == 0xe8) insn.branchType = BranchType::Call;
+                else if (opcode == 0xe9 || opcode == 0xeb) insn.branchType = BranchType::Jump;
+                else if (opcode >= 0xe0 && opcode <= 0xe3) insn.branchType = BranchType::Loop;
+                else insn.branchType = BranchType::ConditionalJump;
+            }
+        }
+
+        if (flags & Invalid) return Instruction{};
+
+        if (flags & ModRM)
+        {
+            if ((flags & NoRegisterForm) && (*p >> 6) == 3) return Instruction{};
+
+            uint8_t reg = (*p >> 3) & 7;
+            if ((flags & Group3) && reg <= 1)
+            {
+                // test r/m, imm
+                flags |= opcode == 0xf6 ? Imm8 : ImmZ;
+            }
+
+            p += ModRMLength(p, addressSize16);
+        }
+
+        size_t immZSize = operandSize16 ? 2 : 4;
+
+        if (flags & (Rel8 | RelZ))
+        {
+            insn.displacementOffset = p - code;
+            insn.displacementSize = (flags & Rel8) ? 1 : immZSize;
+            p += insn.displacementSize;
+        }
+
+        if (flags & Imm16) p += 2;
+        if (flags & Imm8) p += 1;
+        if (flags & ImmZ) p += immZSize;
+        if (flags & MemOffset) p += addressSize16 ? 2 : 4;
+        if (flags & FarPtr) p += immZSize + 2;
+
+        insn.length = p - code;
+        if (insn.length > MAX_INSTRUCTION_LENGTH) return Instruction{};
+
+        return insn;
+    }
+
+    int32_t Instruction::Displacement(const uint8_t* code) const
+    {
+        const uint8_t* disp = code + displacementOffset;
+
+        switch (displacementSize)
+        {
+            case 1:
+                return (int8_t) disp[0];
+            case 2:
+                return (int16_t) (disp[0] | (disp[1] << 8));
+            case 4:
+                return (int32_t) ((uint32_t) disp[0] | ((uint32_t) disp[1] << 8) | ((uint32_t) disp[2] << 16) | ((uint32_t) disp[3] << 24));
+        }
+
+        return 0;
+    }
+
+    size_t Instruction::BranchTarget(const uint8_t* code, size_t address) const
+    {
+        return address + length + Displacement(code);
+    }
+
+    size_t CoveringLength(const uint8_t* code, size_t minLength)
+    {
+        size_t total = 0;
+
+        while (total < minLength)
+        {
+            auto insn = Decode(code + total);
+            if (!insn.IsValid()) return 0;
+            total += insn.length;
+        }
+
+        return total;
+    }
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// Instruction length decoder for 32-bit x86 code.
+/// This file must not depend on Windows or the game so that it can be used anywhere.
+namespace X86
+{
+    enum class BranchType : uint8_t
+    {
+        None = 0,
+        /// jmp rel8/rel32
+        Jump,
+        /// jcc rel8/rel32
+        ConditionalJump,
+        /// call rel32
+        Call,
+        /// loop, loope, loopne, jecxz. These only exist as rel8.
+        Loop
+    };
+
+    struct Instruction
+    {
+        /// Total length in bytes including prefixes. Zero if the instruction could not be decoded.
+        size_t length;
+        /// Offset of the first byte after the prefixes
+        size_t opcodeOffset;
+        /// Offset of the relative branch displacement, only valid when branchType is not None
+        size_t displacementOffset;
+        /// Size of the relative branch displacement in bytes (1, 2 or 4)
+        size_t displacementSize;
+        BranchType branchType;
+
+        bool IsValid() const { return length != 0; }
+        bool IsRelativeBranch() const { return branchType != BranchType::None; }
+        /// Signed displacement of a relative branch
+        int32_t Displacement(const uint8_t* code) const;
+        /// Where a relative branch at address would go
+        size_t BranchTarget(const uint8_t* code, size_t address) const;
+    };
+
+    /// The longest possible x86 instruction
+    const size_t MAX_INSTRUCTION_LENGTH = 15;
+
+    /**
+     * @brief Decodes the instruction at code. At most MAX_INSTRUCTION_LENGTH bytes will be read.
+     * Returns an instruction whose length is zero if the bytes are not a supported instruction.
+     */
+    Instruction Decode(const uint8_t* code);
+
+    /**
+     * @brief Returns the number of bytes taken by whole instructions that cover at least minLength bytes.
+     * Returns zero if any of the instructions could not be decoded.
+     */
+    size_t CoveringLength(const uint8_t* code, size_t minLength);
+};
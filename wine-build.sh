@@ -3,11 +3,11 @@
 src_dir="Blue Burst Patch Project"
 libs="User32.lib"
 
-libs="$libs lib/assimp-vc142-mt.lib lib/zlibstatic.lib Advapi32.lib"
+libs="$libs Advapi32.lib"
 
 cmd="/opt/msvc/bin/x86/cl /nologo /LD /EHsc /MD /DCINTERFACE \
 /I'$src_dir' /I'$src_dir'/newgfx /Iinclude \
-'$src_dir'/*.cpp '$src_dir'/**/*.cpp $* \
+'$src_dir'/*.cpp '$src_dir'/editors/*.cpp '$src_dir'/newgfx/*.cpp $* \
 /link /OUT:bbpp.dll /subsystem:console $libs && \
 chown $(id -u $USER):$(id -g $USER) bbpp.dll"
 